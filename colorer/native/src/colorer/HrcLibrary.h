@@ -17,6 +17,9 @@ class HrcLibraryException : public Exception
 
 /** HrcLibrary class.
     Defines basic operations of loading and accessing HRC information.
+    Loaded types can be used by parsers in several threads. Load of sources and types
+    (including BaseEditor::setFileType with not loaded type) changes the library,
+    so it must not run at the same time with other use of the library.
 */
 class HrcLibrary
 {
@@ -41,8 +44,30 @@ class HrcLibrary
 
   void loadFileType(FileType* filetype);
 
+  /** Loads all file types, which are not loaded yet.
+      HRC files are read on several threads, types are built from them
+      sequentially in the order of #enumerateFileTypes(), so the result is
+      the same, as the result of #loadFileType() call for each type.
+      @param threads Number of threads. Zero means the number of CPU cores.
+  */
+  void loadAllFileTypes(unsigned int threads = 0);
+
   void loadHrcSettings(const XmlInputSource& is);
 
+  /** Sets directory for cache of parsed HRC files.
+      HRC files, loaded after this call, are read from the cache, if their
+      sources were not changed, and are stored in it otherwise.
+      @param cache_dir Directory of cache, empty string disables the cache.
+  */
+  void setCacheDir(const UnicodeString& cache_dir);
+
+  /** Sets the moment of compilation of schemes.
+      By default regexps and keyword lists of scheme are compiled, when parser
+      enters the scheme for the first time. In eager mode all schemes of type
+      are compiled, when type is loaded.
+  */
+  void setEagerCompile(bool eager);
+
   /** Enumerates sequentially all prototypes
       @param index index of type.
       @return Requested type, or null, if #index is too big
@@ -78,6 +103,20 @@ class HrcLibrary
   */
   const Region* getRegion(const UnicodeString* name);
 
+  /** Counters of regular expressions of loaded schemes.
+      Regexps with the same text, flags and back reference regexp
+      are compiled once and shared by all scheme nodes.
+  */
+  struct RegExpStats
+  {
+    /** Number of regexps, requested by scheme nodes */
+    size_t requested = 0;
+    /** Number of compiled regexps */
+    size_t compiled = 0;
+  };
+
+  [[nodiscard]] RegExpStats getRegExpStats() const;
+
  private:
   class Impl;
 
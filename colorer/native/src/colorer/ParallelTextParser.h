@@ -0,0 +1,80 @@
+#ifndef COLORER_PARALLELTEXTPARSER_H
+#define COLORER_PARALLELTEXTPARSER_H
+
+#include "colorer/FileType.h"
+#include "colorer/LineSource.h"
+#include "colorer/RegionHandler.h"
+#include "colorer/common/spimpl.h"
+
+/**
+ * Batch parser, which colorizes whole text on several threads.
+ *
+ * Text is divided into chunks of lines. Each chunk is parsed by its own
+ * TextParser on a thread pool, in assumption that the chunk starts
+ * outside of any block (at the level of file type base scheme).
+ * Results are passed into RegionHandler in the order of lines. If the
+ * previous chunk ends inside a block, the assumption is wrong: text from the
+ * previous chunk start is parsed sequentially up to the first chunk boundary,
+ * where text is again outside of any block.
+ *
+ * Chunks don't start from a saved state of the parser (ParseCache and
+ * virtual type list at the chunk start), as such state is known only
+ * after the sequential parse of the previous text. So text inside of one
+ * root block gets no speedup: it is parsed once sequentially from the first
+ * chunk, and chunks passed by this parse are skipped by the workers.
+ *
+ * RegionHandler gets the same sequence of events, as from
+ * TextParser::parse(from, num, TPM_CACHE_UPDATE) with the empty cache.
+ * All RegionHandler methods are called from the thread, that calls #parse.
+ *
+ * LineSource is used from several threads, so its #getLine method must be
+ * thread safe, and returned lines must be valid until the end of parse
+ * (TextLinesStore satisfies this).
+ *
+ * @ingroup colorer
+ */
+class ParallelTextParser
+{
+ public:
+  /**
+   * @param threads Number of worker threads. Zero means the number of CPU cores.
+   */
+  explicit ParallelTextParser(unsigned int threads = 0);
+
+  /**
+   * Sets root scheme (filetype) of the text to parse.
+   * File type must be already loaded.
+   */
+  void setFileType(FileType* type);
+
+  /**
+   * Installs LineSource, used as an input of text to parse
+   */
+  void setLineSource(LineSource* lh);
+
+  /**
+   * RegionHandler, used as output stream for parsed tree.
+   */
+  void setRegionHandler(RegionHandler* rh);
+
+  /**
+   * Number of lines in a chunk. Zero means automatic selection.
+   */
+  void setChunkSize(int lines);
+  void setMaxBlockSize(int max_block_size);
+
+  /**
+   * Parses lines from @c from to @c from+num.
+   * @return Last parsed line
+   */
+  int parse(int from, int num);
+
+  ~ParallelTextParser() = default;
+
+ private:
+  class Impl;
+
+  spimpl::unique_impl_ptr<Impl> pimpl;
+};
+
+#endif  // COLORER_PARALLELTEXTPARSER_H
@@ -2,6 +2,7 @@
 #define COLORER_REGION_H
 
 #include <utility>
+#include <vector>
 #include "colorer/Common.h"
 
 /**
@@ -44,17 +45,15 @@ class Region
       and use this information, as region type specification.
       For example, <code>def:Comment</code> has <code>def:Syntax</code> parent,
       so, some syntax checking can be made with its content.
+      Region is its own ancestor. Check takes constant time.
   */
   bool hasParent(const Region* region) const
   {
-    auto elem = this;
-    while (elem != nullptr) {
-      if (region == elem) {
-        return true;
-      }
-      elem = elem->getParent();
+    if (region == nullptr) {
+      return false;
     }
-    return false;
+    size_t depth = region->ancestors.size() - 1;
+    return depth < ancestors.size() && ancestors[depth] == region;
   }
 
   /**
@@ -67,6 +66,10 @@ class Region
     if (_description != nullptr) {
       description = std::make_unique<UnicodeString>(*_description);
     }
+    if (parent != nullptr) {
+      ancestors = parent->ancestors;
+    }
+    ancestors.push_back(this);
   }
 
   virtual ~Region() = default;
@@ -83,6 +86,13 @@ class Region
 
   /** unique id of Region */
   size_t id;
+
+ private:
+  /** Chain of ancestors from the top one up to this region,
+      position of region in the chain is its depth. Parent of region is never
+      changed, so the chain is built once at creation of region.
+  */
+  std::vector<const Region*> ancestors;
 };
 
 #endif  // COLORER_REGION_H
@@ -5,6 +5,7 @@
 #include "colorer/LineSource.h"
 #include "colorer/RegionHandler.h"
 #include "colorer/common/spimpl.h"
+#include "colorer/cregexp/cregexp.h"
 
 /**
  * Basic lexical/syntax parser interface.
@@ -77,6 +78,16 @@ class TextParser
    * @param mode  Parsing mode.
    */
   int parse(int from, int num, TextParseMode mode);
+  /**
+   * Parses single changed line with cache information, cache tree is not
+   * rebuilt. Regions of the line are passed into RegionHandler.
+   * Line must be in already cached part of text.
+   * @param lno Changed line.
+   * @return true, if blocks, opened at the end of the line, are the same,
+   *   as cached ones, so cache remains valid for the following lines.
+   *   Otherwise the text from this line must be parsed in TPM_CACHE_UPDATE mode.
+   */
+  bool tryParseLine(int lno);
 
   /**
    * Performs break of parsing process from external thread.
@@ -92,6 +103,12 @@ class TextParser
   void clearCache();
   void setMaxBlockSize(int max_block_size);
 
+  /**
+   * Counters of regexp match attempts, made by this parser.
+   * Shows, how many start positions were rejected by DFA of regexps.
+   */
+  const SRegStats& getRegExpStats() const;
+
   ~TextParser() = default;
 
  private:
@@ -1,8 +1,17 @@
 #include "colorer/cregexp/cregexp.h"
-#include <cstring>
+#include <algorithm>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/////////////////////////////////////////////////////////////////////////////
+//
+#ifdef COLORER_FEATURE_REGEXP_BYTECODE
+MatchContext::MatchContext() : frames(INIT_MEM_SIZE) {}
+#else
+MatchContext::MatchContext() : stack(INIT_MEM_SIZE) {}
+#endif
 
-StackElem* CRegExp::RegExpStack {nullptr};
-int CRegExp::RegExpStack_Size {0};
 /////////////////////////////////////////////////////////////////////////////
 //
 SRegInfo::SRegInfo()
@@ -43,18 +52,15 @@ void CRegExp::init()
   error = EError::EERROR;
   firstChar = 0;
   cMatch = 0;
-  global_pattern = nullptr;
+  nodesCount = 0;
 #ifdef COLORERMODE
   backRE = nullptr;
-  backStr = nullptr;
-  backTrace = nullptr;
 #endif
 #ifndef NAMED_MATCHES_IN_HASH
   cnMatch = 0;
 #else
   namedMatches = 0;
 #endif
-  count_elem = 0;
 }
 CRegExp::CRegExp()
 {
@@ -90,7 +96,10 @@ EError CRegExp::setRELow(const UnicodeString& expr)
 #ifndef NAMED_MATCHES_IN_HASH
   cnMatch = 0;
 #endif
-  endChange = startChange = false;
+#ifdef COLORERMODE
+  backTrace = false;
+#endif
+  nodesCount = 0;
   int start = 0;
   while (Character::isWhitespace(expr[start])) start++;
   if (expr[start] == '/')
@@ -132,10 +141,173 @@ EError CRegExp::setRELow(const UnicodeString& expr)
 
   if (err != EError::EOK)
     return err;
+  nodesCount = enumerateNodes(tree_root, 0);
   optimize();
+  extractLiterals();
+  startChars = SStartChars();
+  startCharsValid = !fillStartChars(tree_root, startChars);
+  compileDfa();
+#ifdef COLORER_FEATURE_REGEXP_BYTECODE
+  compileProgram();
+#endif
   return EError::EOK;
 }
 
+int CRegExp::enumerateNodes(SRegInfo* re, int id)
+{
+  for (; re; re = re->next) {
+    re->id = id++;
+    if (re->op > EOps::ReBlockOps && (re->op < EOps::ReSymbolOps || re->op == EOps::ReBrackets || re->op == EOps::ReNamedBrackets))
+      id = enumerateNodes(re->un.param, id);
+  }
+  return id;
+}
+
+// Adds to the set first chars of the sequence of nodes.
+// Returns true, if the sequence can match without consuming of chars.
+bool CRegExp::fillStartChars(const SRegInfo* re, SStartChars& set) const
+{
+  for (; re; re = re->next) {
+    if (re->op == EOps::ReOr) {
+      // left alternative is in param, right is the rest of the sequence
+      bool empty = fillStartChars(re->un.param, set);
+      return fillStartChars(re->next, set) || empty;
+    }
+    if (!fillStartCharsNode(re, set))
+      return false;
+  }
+  return true;
+}
+
+bool CRegExp::fillStartCharsNode(const SRegInfo* re, SStartChars& set) const
+{
+  if (fillAtomChars(re, 0, set))
+    return false;
+
+  switch (re->op) {
+    case EOps::ReBrackets:
+    case EOps::ReNamedBrackets:
+      return fillStartChars(re->un.param, set);
+    case EOps::ReMul:
+    case EOps::ReNGMul:
+    case EOps::ReQuest:
+    case EOps::ReNGQuest:
+      fillStartChars(re->un.param, set);
+      return true;
+    case EOps::RePlus:
+    case EOps::ReNGPlus:
+      return fillStartChars(re->un.param, set);
+    case EOps::ReRangeN:
+    case EOps::ReRangeNM:
+    case EOps::ReNGRangeN:
+    case EOps::ReNGRangeNM:
+      return fillStartChars(re->un.param, set) || re->s == 0;
+    case EOps::ReBkBrack:
+    case EOps::ReBkBrackName:
+#ifdef COLORERMODE
+    case EOps::ReBkTrace:
+    case EOps::ReBkTraceN:
+    case EOps::ReBkTraceName:
+    case EOps::ReBkTraceNName:
+#endif
+      // content is unknown, can be empty
+      set.chars.set();
+      set.high = true;
+      return true;
+    default:
+      // zero width assertions, look ahead/behind and empty nodes
+      return true;
+  }
+}
+
+// Adds to the set chars, which can be matched by the char number idx of node.
+// Returns false, if node doesn't match exactly one char by each of its chars.
+bool CRegExp::fillAtomChars(const SRegInfo* re, int idx, SStartChars& set) const
+{
+  auto fill = [&set](auto&& pred) {
+    for (int c = 0; c < 256; c++)
+      if (pred(static_cast<UChar>(c)))
+        set.chars.set(c);
+    set.high = true;
+  };
+
+  switch (re->op) {
+    case EOps::ReSymb: {
+      UChar symb = re->un.symbol;
+      if (!ignoreCase) {
+        if (symb < 256)
+          set.chars.set(symb);
+        else
+          set.high = true;
+        return true;
+      }
+      fill([symb](UChar c) {
+        return Character::toLowerCase(c) == Character::toLowerCase(symb) ||
+            Character::toUpperCase(c) == Character::toUpperCase(symb);
+      });
+      return true;
+    }
+    case EOps::ReWord: {
+      UChar symb = (*re->un.word)[idx];
+      if (!ignoreCase) {
+        if (symb < 256)
+          set.chars.set(symb);
+        else
+          set.high = true;
+        return true;
+      }
+      // full case folding of non ascii chars can change the length of word
+      fill([symb](UChar c) {
+        return c >= 0x80 || symb >= 0x80 || Character::toLowerCase(c) == Character::toLowerCase(symb) ||
+            Character::toUpperCase(c) == Character::toUpperCase(symb);
+      });
+      return true;
+    }
+    case EOps::ReEnum:
+      fill([re](UChar c) { return re->un.charclass->contains(c); });
+      return true;
+    case EOps::ReNEnum:
+      fill([re](UChar c) { return !re->un.charclass->contains(c); });
+      return true;
+    case EOps::ReMetaSymb:
+      switch (re->un.metaSymbol) {
+        case EMetaSymbols::ReAnyChr:
+          fill([this](UChar c) {
+            return singleLine || !(c == 0x0A || c == 0x0B || c == 0x0C || c == 0x0D || c == 0x85);
+          });
+          return true;
+        case EMetaSymbols::ReDigit:
+          fill([](UChar c) { return Character::isDigit(c); });
+          return true;
+        case EMetaSymbols::ReNDigit:
+          fill([](UChar c) { return !Character::isDigit(c); });
+          return true;
+        case EMetaSymbols::ReWordSymb:
+          fill([](UChar c) { return Character::isLetterOrDigit(c) || c == '_'; });
+          return true;
+        case EMetaSymbols::ReNWordSymb:
+          fill([](UChar c) { return !(Character::isLetterOrDigit(c) || c == '_'); });
+          return true;
+        case EMetaSymbols::ReWSpace:
+          fill([](UChar c) { return Character::isWhitespace(c); });
+          return true;
+        case EMetaSymbols::ReNWSpace:
+          fill([](UChar c) { return !Character::isWhitespace(c); });
+          return true;
+        case EMetaSymbols::ReUCase:
+          fill([](UChar c) { return Character::isUpperCase(c); });
+          return true;
+        case EMetaSymbols::ReNUCase:
+          fill([](UChar c) { return Character::isLowerCase(c); });
+          return true;
+        default:
+          return false;
+      }
+    default:
+      return false;
+  }
+}
+
 void CRegExp::optimize()
 {
   SRegInfo* next = tree_root;
@@ -168,6 +340,118 @@ void CRegExp::optimize()
   }
 }
 
+void CRegExp::extractLiterals()
+{
+  prefix = UnicodeString();
+  required = UnicodeString();
+  minLength = getMinLength(tree_root);
+  // case insensitive literals are not searched
+  if (ignoreCase)
+    return;
+  UnicodeString run;
+  bool atStart = true;
+  collectLiterals(tree_root, run, atStart);
+  closeLiteral(run, atStart);
+}
+
+// Adds chars of literals of the sequence to the current run. Nodes, which
+// are not chars or zero width assertions, close the run.
+void CRegExp::collectLiterals(const SRegInfo* re, UnicodeString& run, bool& atStart)
+{
+  for (const SRegInfo* node = re; node; node = node->next) {
+    if (node->op == EOps::ReOr) {
+      closeLiteral(run, atStart);
+      atStart = false;
+      return;
+    }
+  }
+  for (; re; re = re->next) {
+    switch (re->op) {
+      case EOps::ReSymb:
+        run.append(re->un.symbol);
+        break;
+      case EOps::ReWord:
+        run.append(*re->un.word);
+        break;
+      case EOps::ReBrackets:
+      case EOps::ReNamedBrackets:
+        collectLiterals(re->un.param, run, atStart);
+        break;
+      case EOps::ReEmpty:
+      case EOps::ReAhead:
+      case EOps::ReNAhead:
+      case EOps::ReBehind:
+      case EOps::ReNBehind:
+        break;
+      case EOps::ReMetaSymb: {
+        SStartChars chars;
+        if (!fillAtomChars(re, 0, chars))
+          break;
+      }
+        [[fallthrough]];
+      default:
+        closeLiteral(run, atStart);
+        atStart = false;
+        break;
+    }
+  }
+}
+
+void CRegExp::closeLiteral(UnicodeString& run, bool& atStart)
+{
+  if (atStart && run.length() > 0) {
+    prefix = run;
+  }
+  if (run.length() > required.length()) {
+    required = run;
+  }
+  run = UnicodeString();
+}
+
+// Returns minimal length of text, matched by the sequence.
+int CRegExp::getMinLength(const SRegInfo* re) const
+{
+  const int max_length = 0x10000;
+  int length = 0;
+  for (; re && length < max_length; re = re->next) {
+    switch (re->op) {
+      case EOps::ReOr:
+        return length + std::min(getMinLength(re->un.param), getMinLength(re->next));
+      case EOps::ReBrackets:
+      case EOps::ReNamedBrackets:
+      case EOps::RePlus:
+      case EOps::ReNGPlus:
+        length += getMinLength(re->un.param);
+        break;
+      case EOps::ReRangeN:
+      case EOps::ReRangeNM:
+      case EOps::ReNGRangeN:
+      case EOps::ReNGRangeNM:
+        if (re->s > 0)
+          length += static_cast<int>(std::min<long long>(max_length, 1LL * re->s * getMinLength(re->un.param)));
+        break;
+      case EOps::ReWord:
+        length += re->un.word->length();
+        break;
+      case EOps::ReSymb:
+      case EOps::ReEnum:
+      case EOps::ReNEnum:
+        length++;
+        break;
+      case EOps::ReMetaSymb: {
+        SStartChars chars;
+        if (fillAtomChars(re, 0, chars))
+          length++;
+        break;
+      }
+      default:
+        // zero width assertions and back references
+        break;
+    }
+  }
+  return std::min(length, max_length);
+}
+
 EError CRegExp::setStructs(SRegInfo*& re, const UnicodeString& expr, int& retPos)
 {
   SRegInfo *next, *temp;
@@ -266,6 +550,7 @@ EError CRegExp::setStructs(SRegInfo*& re, const UnicodeString& expr, int& retPos
 #ifndef NAMED_MATCHES_IN_HASH
         case 'y':
         case 'Y':
+          backTrace = true;
           next->op = (expr[i + 1] == 'y' ? EOps::ReBkTrace : EOps::ReBkTraceN);
           next->param0 = UnicodeTools::getHex(expr[i + 2]);
           if (next->param0 != -1) {
@@ -667,25 +952,27 @@ EError CRegExp::setStructs(SRegInfo*& re, const UnicodeString& expr, int& retPos
 // parsing
 ////////////////////////////////////////////////////////////////////////////
 
-bool CRegExp::isWordBoundary(int toParse)
+bool CRegExp::isWordBoundary(const MatchContext& ctx, int toParse) const
 {
+  const UnicodeString& pattern = *ctx.global_pattern;
   int before = 0;
   int after = 0;
-  if (toParse < end && (Character::isLetterOrDigit((*global_pattern)[toParse]) || (*global_pattern)[toParse] == '_'))
+  if (toParse < ctx.end && (Character::isLetterOrDigit(pattern[toParse]) || pattern[toParse] == '_'))
     after = 1;
   if (toParse > 0 &&
-      (Character::isLetterOrDigit((*global_pattern)[toParse - 1]) || (*global_pattern)[toParse - 1] == '_'))
+      (Character::isLetterOrDigit(pattern[toParse - 1]) || pattern[toParse - 1] == '_'))
     before = 1;
   return before + after == 1;
 }
-bool CRegExp::isNWordBoundary(int toParse)
+bool CRegExp::isNWordBoundary(const MatchContext& ctx, int toParse) const
 {
-  return !isWordBoundary(toParse);
+  return !isWordBoundary(ctx, toParse);
 }
 
-bool CRegExp::checkMetaSymbol(EMetaSymbols symb, int& toParse)
+bool CRegExp::checkMetaSymbol(MatchContext& ctx, EMetaSymbols symb, int& toParse) const
 {
-  const UnicodeString& pattern = *global_pattern;
+  const UnicodeString& pattern = *ctx.global_pattern;
+  const int end = ctx.end;
 
   switch (symb) {
     case EMetaSymbols::ReAnyChr:
@@ -712,7 +999,7 @@ bool CRegExp::checkMetaSymbol(EMetaSymbols symb, int& toParse)
     case EMetaSymbols::ReEoL:
       if (multiLine) {
         bool ok = false;  // ???check
-        if (toParse && toParse < end &&
+        if (toParse && toParse < ctx.end &&
             (pattern[toParse - 1] == 0x0A || pattern[toParse - 1] == 0x0B || pattern[toParse - 1] == 0x0C ||
              pattern[toParse - 1] == 0x0D || pattern[toParse - 1] == 0x85 || pattern[toParse - 1] == 0x2028 ||
              pattern[toParse - 1] == 0x2029))
@@ -761,23 +1048,23 @@ bool CRegExp::checkMetaSymbol(EMetaSymbols symb, int& toParse)
       toParse++;
       return true;
     case EMetaSymbols::ReWBound:
-      return isWordBoundary(toParse);
+      return isWordBoundary(ctx, toParse);
     case EMetaSymbols::ReNWBound:
-      return isNWordBoundary(toParse);
+      return isNWordBoundary(ctx, toParse);
     case EMetaSymbols::RePreNW:
       if (toParse >= end)
         return true;
       return toParse == 0 || !Character::isLetter(pattern[toParse - 1]);
 #ifdef COLORERMODE
     case EMetaSymbols::ReSoScheme:
-      return (schemeStart == toParse);
+      return (ctx.schemeStart == toParse);
     case EMetaSymbols::ReStart:
-      matches->s[0] = toParse;
-      startChange = true;
+      ctx.matches->s[0] = toParse;
+      ctx.startChange = true;
       return true;
     case EMetaSymbols::ReEnd:
-      matches->e[0] = toParse;
-      endChange = true;
+      ctx.matches->e[0] = toParse;
+      ctx.endChange = true;
       return true;
 #endif
     default:
@@ -785,14 +1072,16 @@ bool CRegExp::checkMetaSymbol(EMetaSymbols symb, int& toParse)
   }
 }
 
-void CRegExp::check_stack(bool res, SRegInfo** re, SRegInfo** prev, int* toParse, bool* leftenter, int* action)
+#ifndef COLORER_FEATURE_REGEXP_BYTECODE
+void CRegExp::check_stack(MatchContext& ctx, bool res, SRegInfo** re, SRegInfo** prev, int* toParse, bool* leftenter,
+                          int* action)
 {
-  if (count_elem == 0) {
+  if (ctx.count_elem == 0) {
     *action = res;
     return;
   }
 
-  StackElem& ne = CRegExp::RegExpStack[--count_elem];
+  StackElem& ne = ctx.stack[--ctx.count_elem];
   if (res) {
     *action = ne.ifTrueReturn;
   }
@@ -805,21 +1094,13 @@ void CRegExp::check_stack(bool res, SRegInfo** re, SRegInfo** prev, int* toParse
   *leftenter = ne.leftenter;
 }
 
-void CRegExp::insert_stack(SRegInfo** re, SRegInfo** prev, int* toParse, bool* leftenter, int ifTrueReturn,
-                           int ifFalseReturn, SRegInfo** re2, SRegInfo** prev2, int toParse2)
+void CRegExp::insert_stack(MatchContext& ctx, SRegInfo** re, SRegInfo** prev, int* toParse, bool* leftenter,
+                           int ifTrueReturn, int ifFalseReturn, SRegInfo** re2, SRegInfo** prev2, int toParse2)
 {
-  if (RegExpStack_Size == 0) {
-    CRegExp::RegExpStack = new StackElem[INIT_MEM_SIZE];
-    RegExpStack_Size = INIT_MEM_SIZE;
-  }
-  if (RegExpStack_Size == count_elem) {
-    RegExpStack_Size += MEM_INC;
-    StackElem* s = new StackElem[RegExpStack_Size];
-    memcpy(s, CRegExp::RegExpStack, count_elem * sizeof(StackElem));
-    delete[] CRegExp::RegExpStack;
-    CRegExp::RegExpStack = s;
+  if (ctx.stack.size() == static_cast<size_t>(ctx.count_elem)) {
+    ctx.stack.resize(ctx.stack.size() + MEM_INC);
   }
-  StackElem& ne = CRegExp::RegExpStack[count_elem++];
+  StackElem& ne = ctx.stack[ctx.count_elem++];
   ne.re = *re;
   ne.prev = *prev;
   ne.toParse = *toParse;
@@ -841,12 +1122,19 @@ void CRegExp::insert_stack(SRegInfo** re, SRegInfo** prev, int* toParse, bool* l
   }
 }
 
-bool CRegExp::lowParse(SRegInfo* re, SRegInfo* prev, int toParse)
+bool CRegExp::lowParse(MatchContext& ctx, SRegInfo* re, SRegInfo* prev, int toParse) const
 {
   int i, sv, wlen;
   bool leftenter = true;
   bool br = false;
-  const UnicodeString& pattern = *global_pattern;
+  const UnicodeString& pattern = *ctx.global_pattern;
+  const int end = ctx.end;
+  SMatches* const matches = ctx.matches;
+#ifdef COLORERMODE
+  const UnicodeString* const backStr = ctx.backStr;
+  const SMatches* const backTrace = ctx.backTrace;
+#endif
+  SRegState* const state = ctx.nodes.data();
   int action = -1;
 
   if (!re) {
@@ -862,66 +1150,66 @@ bool CRegExp::lowParse(SRegInfo* re, SRegInfo* prev, int toParse)
           case EOps::ReBrackets:
           case EOps::ReNamedBrackets:
             if (leftenter) {
-              re->s = toParse;
+              state[re->id].s = toParse;
               re = re->un.param;
               continue;
             }
             if (re->param0 == -1)
               break;
             if (re->op == EOps::ReBrackets) {
-              if (re->param0 || !startChange)
-                matches->s[re->param0] = re->s;
-              if (re->param0 || !endChange)
+              if (re->param0 || !ctx.startChange)
+                matches->s[re->param0] = state[re->id].s;
+              if (re->param0 || !ctx.endChange)
                 matches->e[re->param0] = toParse;
               if (matches->e[re->param0] < matches->s[re->param0])
                 matches->s[re->param0] = matches->e[re->param0];
             }
             else {
 #ifndef NAMED_MATCHES_IN_HASH
-              matches->ns[re->param0] = re->s;
+              matches->ns[re->param0] = state[re->id].s;
               matches->ne[re->param0] = toParse;
               if (matches->ne[re->param0] < matches->ns[re->param0])
                 matches->ns[re->param0] = matches->ne[re->param0];
 #else
-              SMatch mt = {re->s, toParse};
-              namedMatches->setItem(re->namedata, mt);
+              SMatch mt = {state[re->id].s, toParse};
+              ctx.namedMatches->setItem(re->namedata, mt);
 #endif
             }
             break;
           case EOps::ReSymb:
             if (toParse >= end) {
-              check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(ctx, false, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
             if (ignoreCase) {
               if (Character::toLowerCase(pattern[toParse]) != Character::toLowerCase(re->un.symbol) &&
                   Character::toUpperCase(pattern[toParse]) != Character::toUpperCase(re->un.symbol))
               {
-                check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+                check_stack(ctx, false, &re, &prev, &toParse, &leftenter, &action);
                 continue;
               }
             }
             else if (pattern[toParse] != re->un.symbol) {
-              check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(ctx, false, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
             toParse++;
             break;
           case EOps::ReMetaSymb:
-            if (!checkMetaSymbol(re->un.metaSymbol, toParse)) {
-              check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+            if (!checkMetaSymbol(ctx, re->un.metaSymbol, toParse)) {
+              check_stack(ctx, false, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
             break;
           case EOps::ReWord:
             wlen = re->un.word->length();
             if (toParse + wlen > end) {
-              check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(ctx, false, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
             if (ignoreCase) {
               if (UStr::caseCompare(UnicodeString(pattern, toParse, wlen), *re->un.word) != 0) {
-                check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+                check_stack(ctx, false, &re, &prev, &toParse, &leftenter, &action);
                 continue;
               }
               toParse += wlen;
@@ -930,7 +1218,7 @@ bool CRegExp::lowParse(SRegInfo* re, SRegInfo* prev, int toParse)
               br = false;
               for (i = 0; i < wlen; i++) {
                 if (pattern[toParse + i] != (*re->un.word)[i]) {
-                  check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+                  check_stack(ctx, false, &re, &prev, &toParse, &leftenter, &action);
                   br = true;
                   break;
                 }
@@ -942,22 +1230,22 @@ bool CRegExp::lowParse(SRegInfo* re, SRegInfo* prev, int toParse)
             break;
           case EOps::ReEnum:
             if (toParse >= end) {
-              check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(ctx, false, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
             if (!re->un.charclass->contains(pattern[toParse])) {
-              check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(ctx, false, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
             toParse++;
             break;
           case EOps::ReNEnum:
             if (toParse >= end) {
-              check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(ctx, false, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
             if (re->un.charclass->contains(pattern[toParse])) {
-              check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(ctx, false, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
             toParse++;
@@ -966,13 +1254,13 @@ bool CRegExp::lowParse(SRegInfo* re, SRegInfo* prev, int toParse)
           case EOps::ReBkTrace:
             sv = re->param0;
             if (!backStr || !backTrace || sv == -1) {
-              check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(ctx, false, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
             br = false;
             for (i = backTrace->s[sv]; i < backTrace->e[sv]; i++) {
               if (toParse >= end || pattern[toParse] != (*backStr)[i]) {
-                check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+                check_stack(ctx, false, &re, &prev, &toParse, &leftenter, &action);
                 br = true;
                 break;
               }
@@ -984,13 +1272,13 @@ bool CRegExp::lowParse(SRegInfo* re, SRegInfo* prev, int toParse)
           case EOps::ReBkTraceN:
             sv = re->param0;
             if (!backStr || !backTrace || sv == -1) {
-              check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(ctx, false, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
             br = false;
             for (i = backTrace->s[sv]; i < backTrace->e[sv]; i++) {
               if (toParse >= end || Character::toLowerCase(pattern[toParse]) != Character::toLowerCase((*backStr)[i])) {
-                check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+                check_stack(ctx, false, &re, &prev, &toParse, &leftenter, &action);
                 br = true;
                 break;
               }
@@ -1003,13 +1291,13 @@ bool CRegExp::lowParse(SRegInfo* re, SRegInfo* prev, int toParse)
 #ifndef NAMED_MATCHES_IN_HASH
             sv = re->param0;
             if (!backStr || !backTrace || sv == -1) {
-              check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(ctx, false, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
             br = false;
             for (i = backTrace->ns[sv]; i < backTrace->ne[sv]; i++) {
               if (toParse >= end || pattern[toParse] != (*backStr)[i]) {
-                check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+                check_stack(ctx, false, &re, &prev, &toParse, &leftenter, &action);
                 br = true;
                 break;
               }
@@ -1021,7 +1309,7 @@ bool CRegExp::lowParse(SRegInfo* re, SRegInfo* prev, int toParse)
 #else
             // !!!;
             {
-              check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(ctx, false, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
 #endif  // NAMED_MATCHES_IN_HASH
@@ -1029,13 +1317,13 @@ bool CRegExp::lowParse(SRegInfo* re, SRegInfo* prev, int toParse)
 #ifndef NAMED_MATCHES_IN_HASH
             sv = re->param0;
             if (!backStr || !backTrace || sv == -1) {
-              check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(ctx, false, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
             br = false;
             for (i = backTrace->s[sv]; i < backTrace->e[sv]; i++) {
               if (toParse >= end || Character::toLowerCase(pattern[toParse]) != Character::toLowerCase((*backStr)[i])) {
-                check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+                check_stack(ctx, false, &re, &prev, &toParse, &leftenter, &action);
                 br = true;
                 break;
               }
@@ -1047,7 +1335,7 @@ bool CRegExp::lowParse(SRegInfo* re, SRegInfo* prev, int toParse)
 #else
             // !!;
             {
-              check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(ctx, false, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
 #endif  // NAMED_MATCHES_IN_HASH
@@ -1057,17 +1345,17 @@ bool CRegExp::lowParse(SRegInfo* re, SRegInfo* prev, int toParse)
 #ifndef NAMED_MATCHES_IN_HASH
             sv = re->param0;
             if (sv == -1 || cnMatch <= sv) {
-              check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(ctx, false, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
             if (matches->ns[sv] == -1 || matches->ne[sv] == -1) {
-              check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(ctx, false, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
             br = false;
             for (i = matches->ns[sv]; i < matches->ne[sv]; i++) {
               if (toParse >= end || pattern[toParse] != pattern[i]) {
-                check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+                check_stack(ctx, false, &re, &prev, &toParse, &leftenter, &action);
                 br = true;
                 break;
               }
@@ -1078,19 +1366,19 @@ bool CRegExp::lowParse(SRegInfo* re, SRegInfo* prev, int toParse)
             break;
 #else
           {
-            SMatch* mt = namedMatches->getItem(re->namedata);
+            SMatch* mt = ctx.namedMatches->getItem(re->namedata);
             if (!mt) {
-              check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(ctx, false, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
             if (mt->s == -1 || mt->e == -1) {
-              check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(ctx, false, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
             br = false;
             for (i = mt->s; i < mt->e; i++) {
               if (toParse >= end || pattern[toParse] != pattern[i]) {
-                check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+                check_stack(ctx, false, &re, &prev, &toParse, &leftenter, &action);
                 br = true;
                 break;
               }
@@ -1104,17 +1392,17 @@ bool CRegExp::lowParse(SRegInfo* re, SRegInfo* prev, int toParse)
           case EOps::ReBkBrack:
             sv = re->param0;
             if (sv == -1 || cMatch <= sv) {
-              check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(ctx, false, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
             if (matches->s[sv] == -1 || matches->e[sv] == -1) {
-              check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(ctx, false, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
             br = false;
             for (i = matches->s[sv]; i < matches->e[sv]; i++) {
               if (toParse >= end || pattern[toParse] != pattern[i]) {
-                check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+                check_stack(ctx, false, &re, &prev, &toParse, &leftenter, &action);
                 br = true;
                 break;
               }
@@ -1125,46 +1413,46 @@ bool CRegExp::lowParse(SRegInfo* re, SRegInfo* prev, int toParse)
             break;
           case EOps::ReAhead:
             if (!leftenter) {
-              check_stack(true, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(ctx, true, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
             {
-              insert_stack(&re, &prev, &toParse, &leftenter, rea_Break, rea_False, &re->un.param, nullptr, toParse);
+              insert_stack(ctx, &re, &prev, &toParse, &leftenter, rea_Break, rea_False, &re->un.param, nullptr, toParse);
               continue;
             }
             break;
           case EOps::ReNAhead:
             if (!leftenter) {
-              check_stack(true, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(ctx, true, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
             {
-              insert_stack(&re, &prev, &toParse, &leftenter, rea_False, rea_Break, &re->un.param, nullptr, toParse);
+              insert_stack(ctx, &re, &prev, &toParse, &leftenter, rea_False, rea_Break, &re->un.param, nullptr, toParse);
               continue;
             }
             break;
           case EOps::ReBehind:
             if (!leftenter) {
-              check_stack(true, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(ctx, true, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
             if (toParse - re->param0 < 0) {
-              check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(ctx, false, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
             else {
-              insert_stack(&re, &prev, &toParse, &leftenter, rea_Break, rea_False, &re->un.param, nullptr,
+              insert_stack(ctx, &re, &prev, &toParse, &leftenter, rea_Break, rea_False, &re->un.param, nullptr,
                            toParse - re->param0);
               continue;
             }
             break;
           case EOps::ReNBehind:
             if (!leftenter) {
-              check_stack(true, &re, &prev, &toParse, &leftenter, &action);
+              check_stack(ctx, true, &re, &prev, &toParse, &leftenter, &action);
               continue;
             }
             if (toParse - re->param0 >= 0) {
-              insert_stack(&re, &prev, &toParse, &leftenter, rea_False, rea_Break, &re->un.param, nullptr,
+              insert_stack(ctx, &re, &prev, &toParse, &leftenter, rea_False, rea_Break, &re->un.param, nullptr,
                            toParse - re->param0);
               continue;
             }
@@ -1176,93 +1464,93 @@ bool CRegExp::lowParse(SRegInfo* re, SRegInfo* prev, int toParse)
               break;
             }
             {
-              insert_stack(&re, &prev, &toParse, &leftenter, rea_True, rea_Break, &re->un.param, nullptr, toParse);
+              insert_stack(ctx, &re, &prev, &toParse, &leftenter, rea_True, rea_Break, &re->un.param, nullptr, toParse);
               continue;
             }
             break;
           case EOps::ReRangeN:
             // first enter into op
             if (leftenter) {
-              re->param0 = re->s;
-              re->oldParse = -1;
+              state[re->id].param0 = re->s;
+              state[re->id].oldParse = -1;
             }
-            if (!re->param0 && re->oldParse == toParse)
+            if (!state[re->id].param0 && state[re->id].oldParse == toParse)
               break;
-            re->oldParse = toParse;
+            state[re->id].oldParse = toParse;
             // making branch
-            if (!re->param0) {
-              insert_stack(&re, &prev, &toParse, &leftenter, rea_True, rea_RangeN_step2, &re->un.param, nullptr,
+            if (!state[re->id].param0) {
+              insert_stack(ctx, &re, &prev, &toParse, &leftenter, rea_True, rea_RangeN_step2, &re->un.param, nullptr,
                            toParse);
               continue;
             }
             else {
               // go into
-              re->param0--;
+              state[re->id].param0--;
             }
             re = re->un.param;
             leftenter = true;
             continue;
           case EOps::ReRangeNM:
             if (leftenter) {
-              re->param0 = re->s;
-              re->param1 = re->e - re->s;
-              re->oldParse = -1;
+              state[re->id].param0 = re->s;
+              state[re->id].param1 = re->e - re->s;
+              state[re->id].oldParse = -1;
             }
-            if (!re->param0) {
-              if (re->param1)
-                re->param1--;
+            if (!state[re->id].param0) {
+              if (state[re->id].param1)
+                state[re->id].param1--;
               else {
-                insert_stack(&re, &prev, &toParse, &leftenter, rea_True, rea_False, &re->next, &re, toParse);
+                insert_stack(ctx, &re, &prev, &toParse, &leftenter, rea_True, rea_False, &re->next, &re, toParse);
                 continue;
               }
               {
-                insert_stack(&re, &prev, &toParse, &leftenter, rea_True, rea_RangeNM_step2, &re->un.param, nullptr,
+                insert_stack(ctx, &re, &prev, &toParse, &leftenter, rea_True, rea_RangeNM_step2, &re->un.param, nullptr,
                              toParse);
                 continue;
               }
             }
             else
-              re->param0--;
+              state[re->id].param0--;
             re = re->un.param;
             leftenter = true;
             continue;
           case EOps::ReNGRangeN:
             if (leftenter) {
-              re->param0 = re->s;
-              re->oldParse = -1;
+              state[re->id].param0 = re->s;
+              state[re->id].oldParse = -1;
             }
-            if (!re->param0 && re->oldParse == toParse)
+            if (!state[re->id].param0 && state[re->id].oldParse == toParse)
               break;
-            re->oldParse = toParse;
-            if (!re->param0) {
-              insert_stack(&re, &prev, &toParse, &leftenter, rea_True, rea_NGRangeN_step2, &re->next, &re, toParse);
+            state[re->id].oldParse = toParse;
+            if (!state[re->id].param0) {
+              insert_stack(ctx, &re, &prev, &toParse, &leftenter, rea_True, rea_NGRangeN_step2, &re->next, &re, toParse);
               continue;
             }
             else
-              re->param0--;
+              state[re->id].param0--;
             re = re->un.param;
             leftenter = true;
             continue;
           case EOps::ReNGRangeNM:
             if (leftenter) {
-              re->param0 = re->s;
-              re->param1 = re->e - re->s;
-              re->oldParse = -1;
+              state[re->id].param0 = re->s;
+              state[re->id].param1 = re->e - re->s;
+              state[re->id].oldParse = -1;
             }
-            if (!re->param0) {
-              if (re->param1)
-                re->param1--;
+            if (!state[re->id].param0) {
+              if (state[re->id].param1)
+                state[re->id].param1--;
               else {
-                insert_stack(&re, &prev, &toParse, &leftenter, rea_True, rea_False, &re->next, &re, toParse);
+                insert_stack(ctx, &re, &prev, &toParse, &leftenter, rea_True, rea_False, &re->next, &re, toParse);
                 continue;
               }
               {
-                insert_stack(&re, &prev, &toParse, &leftenter, rea_True, rea_NGRangeNM_step2, &re->next, &re, toParse);
+                insert_stack(ctx, &re, &prev, &toParse, &leftenter, rea_True, rea_NGRangeNM_step2, &re->next, &re, toParse);
                 continue;
               }
             }
             else
-              re->param0--;
+              state[re->id].param0--;
             re = re->un.param;
             leftenter = true;
             continue;
@@ -1279,16 +1567,16 @@ bool CRegExp::lowParse(SRegInfo* re, SRegInfo* prev, int toParse)
 
       switch (action) {
         case rea_False:
-          if (count_elem) {
-            check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+          if (ctx.count_elem) {
+            check_stack(ctx, false, &re, &prev, &toParse, &leftenter, &action);
             continue;
           }
           else
             return false;
           break;
         case rea_True:
-          if (count_elem) {
-            check_stack(true, &re, &prev, &toParse, &leftenter, &action);
+          if (ctx.count_elem) {
+            check_stack(ctx, true, &re, &prev, &toParse, &leftenter, &action);
             continue;
           }
           else
@@ -1299,38 +1587,38 @@ bool CRegExp::lowParse(SRegInfo* re, SRegInfo* prev, int toParse)
           break;
         case rea_RangeN_step2:
           action = -1;
-          insert_stack(&re, &prev, &toParse, &leftenter, rea_True, rea_False, &re->next, &re, toParse);
+          insert_stack(ctx, &re, &prev, &toParse, &leftenter, rea_True, rea_False, &re->next, &re, toParse);
           continue;
           break;
         case rea_RangeNM_step2:
           action = -1;
-          insert_stack(&re, &prev, &toParse, &leftenter, rea_True, rea_RangeNM_step3, &re->next, &re, toParse);
+          insert_stack(ctx, &re, &prev, &toParse, &leftenter, rea_True, rea_RangeNM_step3, &re->next, &re, toParse);
           continue;
           break;
         case rea_RangeNM_step3:
           action = -1;  //-V1037
-          re->param1++;
-          check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+          state[re->id].param1++;
+          check_stack(ctx, false, &re, &prev, &toParse, &leftenter, &action);
           continue;
           break;
         case rea_NGRangeN_step2:
           action = -1;
-          if (re->param0)
-            re->param0--;
+          if (state[re->id].param0)
+            state[re->id].param0--;
           re = re->un.param;
           leftenter = true;
           continue;
           break;
         case rea_NGRangeNM_step2:
           action = -1;
-          insert_stack(&re, &prev, &toParse, &leftenter, rea_True, rea_NGRangeNM_step3, &re->un.param, nullptr,
+          insert_stack(ctx, &re, &prev, &toParse, &leftenter, rea_True, rea_NGRangeNM_step3, &re->un.param, nullptr,
                        toParse);
           continue;
           break;
         case rea_NGRangeNM_step3:
           action = -1;
-          re->param1++;
-          check_stack(false, &re, &prev, &toParse, &leftenter, &action);
+          state[re->id].param1++;
+          check_stack(ctx, false, &re, &prev, &toParse, &leftenter, &action);
           continue;
           break;
       }
@@ -1343,20 +1631,21 @@ bool CRegExp::lowParse(SRegInfo* re, SRegInfo* prev, int toParse)
         leftenter = true;
       }
     }
-    check_stack(true, &re, &prev, &toParse, &leftenter, &action);
+    check_stack(ctx, true, &re, &prev, &toParse, &leftenter, &action);
   }
 }
+#endif  // COLORER_FEATURE_REGEXP_BYTECODE
 
-inline bool CRegExp::quickCheck(int toParse)
+inline bool CRegExp::quickCheck(MatchContext& ctx, int toParse) const
 {
   if (firstChar != BAD_WCHAR) {
-    if (toParse >= end)
+    if (toParse >= ctx.end)
       return false;
     if (ignoreCase) {
-      if (Character::toLowerCase((*global_pattern)[toParse]) != Character::toLowerCase(firstChar))
+      if (Character::toLowerCase((*ctx.global_pattern)[toParse]) != Character::toLowerCase(firstChar))
         return false;
     }
-    else if ((*global_pattern)[toParse] != firstChar)
+    else if ((*ctx.global_pattern)[toParse] != firstChar)
       return false;
     return true;
   }
@@ -1368,7 +1657,7 @@ inline bool CRegExp::quickCheck(int toParse)
         return true;
 #ifdef COLORERMODE
       case EMetaSymbols::ReSoScheme:
-        if (toParse != schemeStart)
+        if (toParse != ctx.schemeStart)
           return false;
         return true;
 #endif
@@ -1397,16 +1686,65 @@ inline bool CRegExp::quickCheck(int toParse)
   return true;
 }
 
-inline bool CRegExp::parseRE(int pos)
+static bool hasLiteral(const UnicodeString& str, int pos, const UnicodeString& literal)
+{
+  for (int i = 0; i < literal.length(); i++) {
+    if (str[pos + i] != literal[i])
+      return false;
+  }
+  return true;
+}
+
+// Returns position of the literal in the text between pos and end, or -1.
+static int findLiteral(const UnicodeString& str, int pos, int end, const UnicodeString& literal)
+{
+  const int last = end - literal.length();
+  const UChar first = literal[0];
+#if defined(COLORER_FEATURE_ICU) && defined(__SSE2__) && (defined(__GNUC__) || defined(__clang__))
+  // compares 8 chars at once with the first char of literal
+  const UChar* text = str.getBuffer();
+  const __m128i needle = _mm_set1_epi16(static_cast<short>(first));
+  for (; pos + 8 <= last + 1; pos += 8) {
+    __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + pos));
+    auto mask = static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi16(chars, needle)));
+    while (mask) {
+      int found = pos + (__builtin_ctz(mask) >> 1);
+      if (hasLiteral(str, found, literal))
+        return found;
+      // two bits for each char
+      mask &= mask - 1;
+      mask &= mask - 1;
+    }
+  }
+#endif
+  for (; pos <= last; pos++) {
+    if (str[pos] == first && hasLiteral(str, pos, literal))
+      return pos;
+  }
+  return -1;
+}
+
+inline bool CRegExp::parseRE(MatchContext& ctx, int pos, bool moves) const
 {
   if (error != EError::EOK)
     return false;
 
   int toParse = pos;
 
-  if (!positionMoves && (firstChar != BAD_WCHAR || firstMetaChar != EMetaSymbols::ReBadMeta) && !quickCheck(toParse))
+  if (!moves && (firstChar != BAD_WCHAR || firstMetaChar != EMetaSymbols::ReBadMeta) && !quickCheck(ctx, toParse))
     return false;
+  if (!moves && (ctx.end - toParse < minLength ||
+                 (prefix.length() > 1 && !hasLiteral(*ctx.global_pattern, toParse, prefix))))
+    return false;
+
+  if (ctx.nodes.size() < static_cast<size_t>(nodesCount))
+    ctx.nodes.resize(nodesCount);
+  ctx.count_elem = 0;
+  // \m and \M of the previous parse must not fix bounds of this match,
+  // before the move of state into context they were reset only by setRE
+  ctx.startChange = ctx.endChange = false;
 
+  SMatches* matches = ctx.matches;
   int i;
   for (i = 0; i < cMatch; i++) matches->s[i] = matches->e[i] = -1;
   matches->cMatch = cMatch;
@@ -1414,40 +1752,98 @@ inline bool CRegExp::parseRE(int pos)
   for (i = 0; i < cnMatch; i++) matches->ns[i] = matches->ne[i] = -1;
   matches->cnMatch = cnMatch;
 #endif
+  const SRegDfa* const fast = dfa.get();
+  // match can't start after this position
+  const int last = ctx.end - minLength;
+  int required_pos = -1;
+  if (toParse > last)
+    return false;
   do {
+    if (moves && prefix.length() > 0) {
+      toParse = pos = findLiteral(*ctx.global_pattern, toParse, ctx.end, prefix);
+      if (toParse == -1)
+        return false;
+    }
+    else if (moves && required.length() > 0 && required_pos < toParse) {
+      required_pos = findLiteral(*ctx.global_pattern, toParse, ctx.end, required);
+      if (required_pos == -1)
+        return false;
+    }
+    ctx.stats.attempts++;
+    if (!fast) {
+      ctx.stats.noDfa++;
+    }
+    else if (!fast->canMatch(*ctx.global_pattern, toParse, ctx.end)) {
+      ctx.stats.dfaRejected++;
+      if (!moves)
+        return false;
+      toParse = ++pos;
+      continue;
+    }
     // stack=null;
-    if (lowParse(tree_root, nullptr, toParse))
+#ifdef COLORER_FEATURE_REGEXP_BYTECODE
+    if (runProgram(ctx, toParse))
       return true;
-    if (!positionMoves)
+#else
+    if (lowParse(ctx, tree_root, nullptr, toParse))
+      return true;
+#endif
+    if (!moves)
       return false;
     toParse = ++pos;
-  } while (toParse <= end);
+  } while (toParse <= last);
   return false;
 }
 
-bool CRegExp::parse(const UnicodeString* str, int pos, int eol, SMatches* mtch
+MatchContext& CRegExp::threadContext()
+{
+  static thread_local MatchContext context;
+  return context;
+}
+
+bool CRegExp::parse(MatchContext& ctx, const UnicodeString* str, int pos, int eol, SMatches* mtch
 #ifdef NAMED_MATCHES_IN_HASH
                     ,
                     PMatchHash nmtch
 #endif
                     ,
-                    int soScheme, int posMoves)
+                    int soScheme, int posMoves
+#ifdef COLORERMODE
+                    ,
+                    const UnicodeString* backStr, const SMatches* backTrace
+#endif
+) const
 {
-  bool nms = positionMoves;
+  bool moves = positionMoves;
   if (posMoves != -1)
-    positionMoves = (posMoves != 0);
+    moves = (posMoves != 0);
 #ifdef COLORERMODE
-  schemeStart = soScheme;
+  ctx.schemeStart = soScheme;
+  ctx.backStr = backStr;
+  ctx.backTrace = backTrace;
 #endif
-  global_pattern = str;
-  end = eol;
-  matches = mtch;
+  ctx.global_pattern = str;
+  ctx.end = eol;
+  ctx.matches = mtch;
 #ifdef NAMED_MATCHES_IN_HASH
-  namedMatches = nmtch;
+  ctx.namedMatches = nmtch;
+#endif
+  return parseRE(ctx, pos, moves);
+}
+
+bool CRegExp::parse(const UnicodeString* str, int pos, int eol, SMatches* mtch
+#ifdef NAMED_MATCHES_IN_HASH
+                    ,
+                    PMatchHash nmtch
+#endif
+                    ,
+                    int soScheme, int posMoves) const
+{
+#ifdef NAMED_MATCHES_IN_HASH
+  return parse(threadContext(), str, pos, eol, mtch, nmtch, soScheme, posMoves);
+#else
+  return parse(threadContext(), str, pos, eol, mtch, soScheme, posMoves);
 #endif
-  bool result = parseRE(pos);
-  positionMoves = nms;
-  return result;
 }
 
 bool CRegExp::parse(const UnicodeString* str, SMatches* mtch
@@ -1455,18 +1851,21 @@ bool CRegExp::parse(const UnicodeString* str, SMatches* mtch
                     ,
                     PMatchHash nmtch
 #endif
-)
+) const
 {
-  end = str->length();
-  global_pattern = str;
+  MatchContext& ctx = threadContext();
+  ctx.end = str->length();
+  ctx.global_pattern = str;
 #ifdef COLORERMODE
-  schemeStart = 0;
+  ctx.schemeStart = 0;
+  ctx.backStr = nullptr;
+  ctx.backTrace = nullptr;
 #endif
-  matches = mtch;
+  ctx.matches = mtch;
 #ifdef NAMED_MATCHES_IN_HASH
-  namedMatches = nmtch;
+  ctx.namedMatches = nmtch;
 #endif
-  return parseRE(0);
+  return parseRE(ctx, 0, positionMoves);
 }
 
 /////////////////////////////////////////////////////////////////
@@ -1495,17 +1894,17 @@ EError CRegExp::getError()
   return error;
 }
 
-bool CRegExp::setPositionMoves(bool moves)
+const SStartChars* CRegExp::getStartChars() const
 {
-  positionMoves = moves;
-  return true;
+  if (error != EError::EOK || positionMoves || !startCharsValid)
+    return nullptr;
+  return &startChars;
 }
 
-void CRegExp::clearRegExpStack()
+bool CRegExp::setPositionMoves(bool moves)
 {
-  CRegExp::RegExpStack_Size = 0;
-  delete[] CRegExp::RegExpStack;
-  CRegExp::RegExpStack = nullptr;
+  positionMoves = moves;
+  return true;
 }
 
 #ifndef NAMED_MATCHES_IN_HASH
@@ -1530,17 +1929,10 @@ bool CRegExp::setBackRE(CRegExp* bkre)
   this->backRE = bkre;
   return true;
 }
-bool CRegExp::setBackTrace(const UnicodeString* str, SMatches* trace)
-{
-  backTrace = trace;
-  backStr = str;
-  return true;
-}
-bool CRegExp::getBackTrace(const UnicodeString** str, SMatches** trace)
+
+bool CRegExp::hasBackTrace() const
 {
-  *str = backStr;
-  *trace = backTrace;
-  return true;
+  return backTrace;
 }
 
 #endif
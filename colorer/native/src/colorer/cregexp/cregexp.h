@@ -1,6 +1,10 @@
 #ifndef COLORER_CREGEXP_H
 #define COLORER_CREGEXP_H
 
+#include <bitset>
+#include <cstdint>
+#include <memory>
+#include <vector>
 #include "colorer/Common.h"
 
 /**
@@ -153,15 +157,90 @@ class SRegInfo
   SRegInfo* parent = nullptr;
   SRegInfo* next = nullptr;
   SRegInfo* prev = nullptr;
-  int oldParse = 0;
   int param0 = 0;
-  int param1 = 0;
   int s = 0;
   int e = 0;
+  // index of the node state in MatchContext
+  int id = 0;
 
   EOps op = EOps::ReEmpty;
 };
 
+/** Match-time data of a single tree node.
+    @ingroup cregexp
+*/
+struct SRegState
+{
+  // start position of bracket
+  int s;
+  // repeat counters of range operators
+  int param0;
+  int param1;
+  int oldParse;
+};
+
+/** Set of chars, which can be the first char of RE match.
+    @ingroup cregexp
+*/
+struct SStartChars
+{
+  // chars 0x00-0xFF
+  std::bitset<256> chars;
+  // RE can start with some char greater than 0xFF
+  bool high = false;
+
+  bool contains(UChar c) const
+  {
+    return c < 256 ? chars[c] : high;
+  }
+};
+
+/** DFA of the RE, which accepts all strings the RE can match, and maybe some more.
+    Zero width assertions and look ahead are treated as empty strings,
+    counted repetitions as unlimited ones. DFA is built for REs without
+    back references and look behind and is used to reject start positions
+    without backtracking.
+    @ingroup cregexp
+*/
+struct SRegDfa
+{
+  // transition is the next state, or one of these values
+  static constexpr int16_t DEAD = -1;
+  static constexpr int16_t MATCH = -2;
+
+  // class of chars 0x00-0xFF, last is the class of chars greater than 0xFF
+  uint8_t classes[257] = {};
+  int classCount = 0;
+  // transitions, state * classCount + class, state 0 is start
+  std::vector<int16_t> next;
+
+  /** Returns false, if RE can't match at position @c pos.
+   */
+  bool canMatch(const UnicodeString& str, int pos, int end) const
+  {
+    int state = 0;
+    for (; pos < end; pos++) {
+      UChar c = str[pos];
+      state = next[state * classCount + classes[c < 256 ? c : 256]];
+      if (state < 0)
+        return state == MATCH;
+    }
+    return false;
+  }
+};
+
+/** Counters of RE match attempts, one attempt for each start position.
+    @ingroup cregexp
+*/
+struct SRegStats
+{
+  uint64_t attempts = 0;
+  // attempts, rejected by DFA
+  uint64_t dfaRejected = 0;
+  // attempts of REs, which have no DFA
+  uint64_t noDfa = 0;
+};
+
 struct StackElem
 {
   // local variable
@@ -178,6 +257,139 @@ struct StackElem
 #define INIT_MEM_SIZE 512
 #define MEM_INC 128
 
+#ifdef COLORER_FEATURE_REGEXP_BYTECODE
+#ifdef NAMED_MATCHES_IN_HASH
+#error COLORER_FEATURE_REGEXP_BYTECODE && NAMED_MATCHES_IN_HASH not realyzed yet
+#endif
+
+/** Instruction codes of the compiled RE program.
+    @ingroup cregexp
+*/
+enum class ReCode : unsigned char {
+  End,
+  Nop,
+  Brackets,
+  NamedBrackets,
+  Symb,
+  SymbIgnoreCase,
+  Word,
+  WordIgnoreCase,
+  Enum,
+  NEnum,
+  AnyChr,
+  Digit,
+  WordSymb,
+  WSpace,
+  MetaSymb,
+#ifdef COLORERMODE
+  BkTrace,
+  BkTraceN,
+  BkTraceName,
+  BkTraceNName,
+#endif
+  BkBrack,
+  BkBrackName,
+  Ahead,
+  NAhead,
+  Behind,
+  NBehind,
+  Or,
+  RangeN,
+  RangeNM,
+  NGRangeN,
+  NGRangeNM,
+  Count
+};
+
+/** Instruction of the compiled RE program.
+    Program has one instruction for each tree node with the same index as
+    node id, and the last instruction ReCode::End. Links between nodes are
+    replaced by indexes of instructions.
+    @ingroup cregexp
+*/
+struct ReInstr
+{
+  ReCode code = ReCode::Nop;
+  // instruction after this one: next node of sequence (entered)
+  // or parent node (left)
+  bool nextEnter = false;
+  int next = 0;
+  // first node of operand
+  int param = 0;
+  // ReOr: instruction after the end of sequence
+  int exit = 0;
+  int param0 = 0;
+  int s = 0;
+  int e = 0;
+  union {
+    EMetaSymbols metaSymbol;
+    UChar symbol;
+    const UnicodeString* word;
+    const CharacterClass* charclass;
+  } un = {};
+};
+
+struct ProgramFrame
+{
+  int pc;
+  int toParse;
+  bool leftenter;
+  int ifTrueReturn;
+  int ifFalseReturn;
+};
+#endif  // COLORER_FEATURE_REGEXP_BYTECODE
+
+/** Match-time state of the regular expression parser.
+    All data, changed during matching, lives here: backtracking stack,
+    state of tree nodes and current match parameters. So the compiled CRegExp
+    is not changed by parse and can be used from several threads at once,
+    if each thread uses its own context. Context can be reused for any
+    number of CRegExp objects and parse calls.
+    @ingroup cregexp
+*/
+class MatchContext
+{
+ public:
+  MatchContext();
+
+  /** Counters of match attempts, made with this context.
+   */
+  const SRegStats& getStats() const
+  {
+    return stats;
+  }
+  void resetStats()
+  {
+    stats = SRegStats();
+  }
+
+ private:
+  friend class CRegExp;
+
+#ifdef COLORER_FEATURE_REGEXP_BYTECODE
+  std::vector<ProgramFrame> frames;
+#else
+  std::vector<StackElem> stack;
+#endif
+  int count_elem = 0;
+  std::vector<SRegState> nodes;
+
+  const UnicodeString* global_pattern = nullptr;
+  int end = 0;
+  SMatches* matches = nullptr;
+#ifdef NAMED_MATCHES_IN_HASH
+  SMatchHash* namedMatches = nullptr;
+#endif
+#ifdef COLORERMODE
+  const UnicodeString* backStr = nullptr;
+  const SMatches* backTrace = nullptr;
+  int schemeStart = 0;
+#endif
+  bool startChange = false;
+  bool endChange = false;
+  SRegStats stats;
+};
+
 enum ReAction {
   rea_False = 0,
   rea_True = 1,
@@ -243,6 +455,10 @@ enum ReAction {
 \par 2.2. Algorithmic problems:
    - Stack recursion implementation.
 
+\par 3. Threading.
+   Compiled RE is not changed by #parse, all match-time data is kept in
+   MatchContext. One CRegExp object can be used from several threads.
+
     @ingroup cregexp
 */
 class CRegExp
@@ -282,37 +498,64 @@ class CRegExp
   */
   UnicodeString* getBracketName(int no);
 #ifdef COLORERMODE
-  bool setBackRE(CRegExp* bkre);
   /**
     Changes RE object, used for backreferences with named \y{} \Y{} operators.
+    Must be called before #setRE.
   */
-  bool setBackTrace(const UnicodeString* str, SMatches* trace);
+  bool setBackRE(CRegExp* bkre);
   /**
-    Returns current RE object, used for backreferences with \y \Y operators.
+    Returns true, if RE refers to the matches of the back RE by \y \Y operators.
   */
-  bool getBackTrace(const UnicodeString** str, SMatches** trace);
+  bool hasBackTrace() const;
 #endif
   /**
     Compiles specified regular expression and drops all
     previous structures.
   */
   bool setRE(const UnicodeString* re);
+  /**
+    Returns set of chars, which can be the first char of RE match,
+    when RE is matched without position moves.
+    Returns nullptr, if RE can match any char at start position,
+    or can match without consuming of this char.
+  */
+  const SStartChars* getStartChars() const;
+  /**
+    Returns true, if match positions are checked by DFA before backtracking.
+  */
+  bool hasDfa() const;
 #ifdef NAMED_MATCHES_IN_HASH
   /** Runs RE parser against input string @c str
    */
-  bool parse(const UnicodeString* str, SMatches* mtch, SMatchHash* nmtch = nullptr);
+  bool parse(const UnicodeString* str, SMatches* mtch, SMatchHash* nmtch = nullptr) const;
   /** Runs RE parser against input string @c str
    */
   bool parse(const UnicodeString* str, int pos, int eol, SMatches* mtch,
-             SMatchHash* nmtch = nullptr, int soscheme = 0, int moves = -1);
+             SMatchHash* nmtch = nullptr, int soscheme = 0, int moves = -1) const;
+  /** Runs RE parser against input string @c str with caller's match context.
+   */
+  bool parse(MatchContext& ctx, const UnicodeString* str, int pos, int eol, SMatches* mtch,
+             SMatchHash* nmtch = nullptr, int soscheme = 0, int moves = -1) const;
 #else
   /** Runs RE parser against input string @c str
    */
-  bool parse(const UnicodeString* str, SMatches* mtch);
+  bool parse(const UnicodeString* str, SMatches* mtch) const;
   /** Runs RE parser against input string @c str
    */
   bool parse(const UnicodeString* str, int pos, int eol, SMatches* mtch, int soscheme = 0,
-             int moves = -1);
+             int moves = -1) const;
+  /** Runs RE parser against input string @c str with caller's match context.
+      Methods without context use the context of the calling thread.
+      @param backStr, backTrace string and matches of the back RE, used by
+             \y \Y operators.
+   */
+  bool parse(MatchContext& ctx, const UnicodeString* str, int pos, int eol, SMatches* mtch,
+             int soscheme = 0, int moves = -1
+#ifdef COLORERMODE
+             ,
+             const UnicodeString* backStr = nullptr, const SMatches* backTrace = nullptr
+#endif
+  ) const;
 #endif
 
  private:
@@ -325,18 +568,17 @@ class CRegExp
   EError error = EError::EOK;
   UChar firstChar = 0;
   EMetaSymbols firstMetaChar = EMetaSymbols::ReBadMeta;
+  // literal, which starts each match
+  UnicodeString prefix;
+  // the longest literal, which is contained in each match
+  UnicodeString required;
+  // minimal number of chars, consumed by match
+  int minLength = 0;
 #ifdef COLORERMODE
   CRegExp* backRE = nullptr;
-  const UnicodeString* backStr = nullptr;
-  SMatches* backTrace = nullptr;
-  int schemeStart = 0;
+  bool backTrace = false;
 #endif
-  bool startChange = false;
-  bool endChange = false;
-  const UnicodeString* global_pattern = nullptr;
-  int end = 0;
 
-  SMatches* matches = nullptr;
   int cMatch = 0;
 #if !defined NAMED_MATCHES_IN_HASH
   UnicodeString* brnames[NAMED_MATCHES_NUM] = {};
@@ -344,30 +586,52 @@ class CRegExp
 #else
   SMatchHash* namedMatches = nullptr;
 #endif
+  // number of tree nodes, size of MatchContext::nodes
+  int nodesCount = 0;
+  SStartChars startChars;
+  bool startCharsValid = false;
+  std::unique_ptr<SRegDfa> dfa;
+#ifdef COLORER_FEATURE_REGEXP_BYTECODE
+  std::vector<ReInstr> program;
+#endif
+
+  friend class DfaBuilder;
 
   void init();
   EError setRELow(const UnicodeString& re);
   EError setStructs(SRegInfo*&, const UnicodeString& expr, int& endPos);
 
   void optimize();
-  bool quickCheck(int toParse);
-  bool isWordBoundary(int toParse);
-  bool isNWordBoundary(int toParse);
-  bool checkMetaSymbol(EMetaSymbols metaSymbol, int& toParse);
-  bool lowParse(SRegInfo* re, SRegInfo* prev, int toParse);
-  bool parseRE(int toParse);
-
-  int count_elem;
-  void check_stack(bool res, SRegInfo** re, SRegInfo** prev, int* toParse, bool* leftenter,
-                   int* action);
-  void insert_stack(SRegInfo** re, SRegInfo** prev, int* toParse, bool* leftenter, int ifTrueReturn,
-                    int ifFalseReturn, SRegInfo** re2, SRegInfo** prev2, int toParse2);
-
-  static StackElem* RegExpStack;
-  static int RegExpStack_Size;
+  void extractLiterals();
+  void collectLiterals(const SRegInfo* re, UnicodeString& run, bool& atStart);
+  void closeLiteral(UnicodeString& run, bool& atStart);
+  int getMinLength(const SRegInfo* re) const;
+  int enumerateNodes(SRegInfo* re, int id);
+  bool fillStartChars(const SRegInfo* re, SStartChars& set) const;
+  bool fillStartCharsNode(const SRegInfo* re, SStartChars& set) const;
+  bool fillAtomChars(const SRegInfo* re, int idx, SStartChars& set) const;
+  void compileDfa();
+  bool quickCheck(MatchContext& ctx, int toParse) const;
+  bool isWordBoundary(const MatchContext& ctx, int toParse) const;
+  bool isNWordBoundary(const MatchContext& ctx, int toParse) const;
+  bool checkMetaSymbol(MatchContext& ctx, EMetaSymbols metaSymbol, int& toParse) const;
+#ifdef COLORER_FEATURE_REGEXP_BYTECODE
+  void compileProgram();
+  int compileNodes(SRegInfo* re);
+  bool runProgram(MatchContext& ctx, int toParse) const;
+#else
+  bool lowParse(MatchContext& ctx, SRegInfo* re, SRegInfo* prev, int toParse) const;
+#endif
+  bool parseRE(MatchContext& ctx, int toParse, bool moves) const;
 
- public:
-  static void clearRegExpStack();
+#ifndef COLORER_FEATURE_REGEXP_BYTECODE
+  static void check_stack(MatchContext& ctx, bool res, SRegInfo** re, SRegInfo** prev, int* toParse,
+                          bool* leftenter, int* action);
+  static void insert_stack(MatchContext& ctx, SRegInfo** re, SRegInfo** prev, int* toParse, bool* leftenter,
+                           int ifTrueReturn, int ifFalseReturn, SRegInfo** re2, SRegInfo** prev2, int toParse2);
+#endif
+
+  static MatchContext& threadContext();
 };
 
 #endif  // COLORER_CREGEXP_H
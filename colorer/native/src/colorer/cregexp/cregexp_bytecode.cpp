@@ -0,0 +1,608 @@
+#include "colorer/cregexp/cregexp.h"
+
+#ifdef COLORER_FEATURE_REGEXP_BYTECODE
+
+/*
+  Bytecode backend of CRegExp.
+
+  Program is the flat form of SRegInfo tree: instruction has the index of
+  node id, links between nodes are indexes of instructions. Interpreter makes
+  exactly the same steps, as the tree walker does: instruction is entered
+  from the previous node of sequence (leftenter) or left after the end of its
+  operand, backtracking stack and match-time state of nodes are the same.
+  So match results are equal, including Colorer extensions.
+
+  With GCC and Clang instructions are dispatched by computed goto.
+*/
+
+#if defined(__GNUC__) || defined(__clang__)
+#define RE_THREADED_DISPATCH
+#endif
+
+void CRegExp::compileProgram()
+{
+  program.assign(nodesCount + 1, ReInstr());
+  program[nodesCount].code = ReCode::End;
+  compileNodes(tree_root);
+}
+
+// Compiles sequence of nodes and their operands.
+// Returns index of the last instruction of sequence.
+int CRegExp::compileNodes(SRegInfo* re)
+{
+  SRegInfo* first = re;
+  int last = nodesCount;
+  for (; re; re = re->next) {
+    ReInstr& ins = program[re->id];
+    last = re->id;
+    if (re->next) {
+      ins.next = re->next->id;
+      ins.nextEnter = true;
+    }
+    else {
+      ins.next = re->parent ? re->parent->id : nodesCount;
+      ins.nextEnter = false;
+    }
+    ins.param0 = re->param0;
+    ins.s = re->s;
+    ins.e = re->e;
+
+    switch (re->op) {
+      case EOps::ReBrackets:
+        ins.code = ReCode::Brackets;
+        break;
+      case EOps::ReNamedBrackets:
+        ins.code = ReCode::NamedBrackets;
+        break;
+      case EOps::ReSymb:
+        ins.code = ignoreCase ? ReCode::SymbIgnoreCase : ReCode::Symb;
+        ins.un.symbol = re->un.symbol;
+        break;
+      case EOps::ReWord:
+        ins.code = ignoreCase ? ReCode::WordIgnoreCase : ReCode::Word;
+        ins.un.word = re->un.word;
+        break;
+      case EOps::ReEnum:
+        ins.code = ReCode::Enum;
+        ins.un.charclass = re->un.charclass;
+        break;
+      case EOps::ReNEnum:
+        ins.code = ReCode::NEnum;
+        ins.un.charclass = re->un.charclass;
+        break;
+      case EOps::ReMetaSymb:
+        switch (re->un.metaSymbol) {
+          case EMetaSymbols::ReAnyChr:
+            ins.code = ReCode::AnyChr;
+            break;
+          case EMetaSymbols::ReDigit:
+            ins.code = ReCode::Digit;
+            break;
+          case EMetaSymbols::ReWordSymb:
+            ins.code = ReCode::WordSymb;
+            break;
+          case EMetaSymbols::ReWSpace:
+            ins.code = ReCode::WSpace;
+            break;
+          default:
+            ins.code = ReCode::MetaSymb;
+            break;
+        }
+        ins.un.metaSymbol = re->un.metaSymbol;
+        break;
+#ifdef COLORERMODE
+      case EOps::ReBkTrace:
+        ins.code = ReCode::BkTrace;
+        break;
+      case EOps::ReBkTraceN:
+        ins.code = ReCode::BkTraceN;
+        break;
+      case EOps::ReBkTraceName:
+        ins.code = ReCode::BkTraceName;
+        break;
+      case EOps::ReBkTraceNName:
+        ins.code = ReCode::BkTraceNName;
+        break;
+#endif
+      case EOps::ReBkBrack:
+        ins.code = ReCode::BkBrack;
+        break;
+      case EOps::ReBkBrackName:
+        ins.code = ReCode::BkBrackName;
+        break;
+      case EOps::ReAhead:
+        ins.code = ReCode::Ahead;
+        break;
+      case EOps::ReNAhead:
+        ins.code = ReCode::NAhead;
+        break;
+      case EOps::ReBehind:
+        ins.code = ReCode::Behind;
+        break;
+      case EOps::ReNBehind:
+        ins.code = ReCode::NBehind;
+        break;
+      case EOps::ReOr:
+        ins.code = ReCode::Or;
+        break;
+      case EOps::ReRangeN:
+        ins.code = ReCode::RangeN;
+        break;
+      case EOps::ReRangeNM:
+        ins.code = ReCode::RangeNM;
+        break;
+      case EOps::ReNGRangeN:
+        ins.code = ReCode::NGRangeN;
+        break;
+      case EOps::ReNGRangeNM:
+        ins.code = ReCode::NGRangeNM;
+        break;
+      default:
+        ins.code = ReCode::Nop;
+        break;
+    }
+    if (re->op > EOps::ReBlockOps && (re->op < EOps::ReSymbolOps || re->op == EOps::ReBrackets || re->op == EOps::ReNamedBrackets))
+    {
+      ins.param = re->un.param->id;
+      compileNodes(re->un.param);
+    }
+  }
+  // alternative, left after the end of its operand, goes after the last node of sequence
+  for (re = first; re; re = re->next) {
+    if (re->op == EOps::ReOr)
+      program[re->id].exit = last;
+  }
+  return last;
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+#pragma GCC diagnostic push
+// labels as values
+#pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+
+#ifdef RE_THREADED_DISPATCH
+#define RE_DISPATCH() goto* labels[static_cast<int>(code[pc].code)]
+#define RE_CASE(op) L_##op:
+#else
+#define RE_DISPATCH() goto dispatch
+#define RE_CASE(op) case ReCode::op:
+#endif
+
+bool CRegExp::runProgram(MatchContext& ctx, int toParse) const
+{
+  const ReInstr* const code = program.data();
+  const UnicodeString& pattern = *ctx.global_pattern;
+  const int end = ctx.end;
+  SMatches* const matches = ctx.matches;
+#ifdef COLORERMODE
+  const UnicodeString* const backStr = ctx.backStr;
+  const SMatches* const backTrace = ctx.backTrace;
+#endif
+  SRegState* const state = ctx.nodes.data();
+  int pc = tree_root->id;
+  bool leftenter = true;
+  bool res = false;
+  int action = -1;
+  int i, sv, wlen;
+
+  auto push = [&](int ifTrueReturn, int ifFalseReturn, int pc2, bool leftenter2, int toParse2) {
+    if (ctx.frames.size() == static_cast<size_t>(ctx.count_elem)) {
+      ctx.frames.resize(ctx.frames.size() + MEM_INC);
+    }
+    ctx.frames[ctx.count_elem++] = {pc, toParse, leftenter, ifTrueReturn, ifFalseReturn};
+    pc = pc2;
+    leftenter = leftenter2;
+    toParse = toParse2;
+  };
+
+#ifdef RE_THREADED_DISPATCH
+  // in order of ReCode
+  static const void* const labels[] = {&&L_End,
+                                       &&L_Nop,
+                                       &&L_Brackets,
+                                       &&L_NamedBrackets,
+                                       &&L_Symb,
+                                       &&L_SymbIgnoreCase,
+                                       &&L_Word,
+                                       &&L_WordIgnoreCase,
+                                       &&L_Enum,
+                                       &&L_NEnum,
+                                       &&L_AnyChr,
+                                       &&L_Digit,
+                                       &&L_WordSymb,
+                                       &&L_WSpace,
+                                       &&L_MetaSymb,
+#ifdef COLORERMODE
+                                       &&L_BkTrace,
+                                       &&L_BkTraceN,
+                                       &&L_BkTraceName,
+                                       &&L_BkTraceNName,
+#endif
+                                       &&L_BkBrack,
+                                       &&L_BkBrackName,
+                                       &&L_Ahead,
+                                       &&L_NAhead,
+                                       &&L_Behind,
+                                       &&L_NBehind,
+                                       &&L_Or,
+                                       &&L_RangeN,
+                                       &&L_RangeNM,
+                                       &&L_NGRangeN,
+                                       &&L_NGRangeNM,
+                                       &&L_Count};
+  static_assert(sizeof(labels) / sizeof(labels[0]) == static_cast<size_t>(ReCode::Count) + 1,
+                "labels must follow ReCode");
+  RE_DISPATCH();
+  {
+#else
+dispatch:
+  switch (code[pc].code) {
+#endif
+    RE_CASE(End)
+    goto succeed;
+
+    RE_CASE(Nop)
+    goto advance;
+
+    RE_CASE(Brackets)
+    if (leftenter) {
+      state[pc].s = toParse;
+      pc = code[pc].param;
+      RE_DISPATCH();
+    }
+    sv = code[pc].param0;
+    if (sv == -1)
+      goto advance;
+    if (sv || !ctx.startChange)
+      matches->s[sv] = state[pc].s;
+    if (sv || !ctx.endChange)
+      matches->e[sv] = toParse;
+    if (matches->e[sv] < matches->s[sv])
+      matches->s[sv] = matches->e[sv];
+    goto advance;
+
+    RE_CASE(NamedBrackets)
+    if (leftenter) {
+      state[pc].s = toParse;
+      pc = code[pc].param;
+      RE_DISPATCH();
+    }
+    sv = code[pc].param0;
+    if (sv == -1)
+      goto advance;
+    matches->ns[sv] = state[pc].s;
+    matches->ne[sv] = toParse;
+    if (matches->ne[sv] < matches->ns[sv])
+      matches->ns[sv] = matches->ne[sv];
+    goto advance;
+
+    RE_CASE(Symb)
+    if (toParse >= end || pattern[toParse] != code[pc].un.symbol)
+      goto fail;
+    toParse++;
+    goto advance;
+
+    RE_CASE(SymbIgnoreCase)
+    if (toParse >= end)
+      goto fail;
+    if (Character::toLowerCase(pattern[toParse]) != Character::toLowerCase(code[pc].un.symbol) &&
+        Character::toUpperCase(pattern[toParse]) != Character::toUpperCase(code[pc].un.symbol))
+      goto fail;
+    toParse++;
+    goto advance;
+
+    RE_CASE(Word)
+    wlen = code[pc].un.word->length();
+    if (toParse + wlen > end)
+      goto fail;
+    for (i = 0; i < wlen; i++) {
+      if (pattern[toParse + i] != (*code[pc].un.word)[i])
+        goto fail;
+    }
+    toParse += wlen;
+    goto advance;
+
+    RE_CASE(WordIgnoreCase)
+    wlen = code[pc].un.word->length();
+    if (toParse + wlen > end)
+      goto fail;
+    if (UStr::caseCompare(UnicodeString(pattern, toParse, wlen), *code[pc].un.word) != 0)
+      goto fail;
+    toParse += wlen;
+    goto advance;
+
+    RE_CASE(Enum)
+    if (toParse >= end || !code[pc].un.charclass->contains(pattern[toParse]))
+      goto fail;
+    toParse++;
+    goto advance;
+
+    RE_CASE(NEnum)
+    if (toParse >= end || code[pc].un.charclass->contains(pattern[toParse]))
+      goto fail;
+    toParse++;
+    goto advance;
+
+    RE_CASE(AnyChr)
+    if (toParse >= end)
+      goto fail;
+    if (!singleLine &&
+        (pattern[toParse] == 0x0A || pattern[toParse] == 0x0B || pattern[toParse] == 0x0C ||
+         pattern[toParse] == 0x0D || pattern[toParse] == 0x85 || pattern[toParse] == 0x2028 ||
+         pattern[toParse] == 0x2029))
+      goto fail;
+    toParse++;
+    goto advance;
+
+    RE_CASE(Digit)
+    if (toParse >= end || !Character::isDigit(pattern[toParse]))
+      goto fail;
+    toParse++;
+    goto advance;
+
+    RE_CASE(WordSymb)
+    if (toParse >= end || !(Character::isLetterOrDigit(pattern[toParse]) || pattern[toParse] == '_'))
+      goto fail;
+    toParse++;
+    goto advance;
+
+    RE_CASE(WSpace)
+    if (toParse >= end || !Character::isWhitespace(pattern[toParse]))
+      goto fail;
+    toParse++;
+    goto advance;
+
+    RE_CASE(MetaSymb)
+    if (!checkMetaSymbol(ctx, code[pc].un.metaSymbol, toParse))
+      goto fail;
+    goto advance;
+
+#ifdef COLORERMODE
+    RE_CASE(BkTrace)
+    sv = code[pc].param0;
+    if (!backStr || !backTrace || sv == -1)
+      goto fail;
+    for (i = backTrace->s[sv]; i < backTrace->e[sv]; i++) {
+      if (toParse >= end || pattern[toParse] != (*backStr)[i])
+        goto fail;
+      toParse++;
+    }
+    goto advance;
+
+    RE_CASE(BkTraceN)
+    sv = code[pc].param0;
+    if (!backStr || !backTrace || sv == -1)
+      goto fail;
+    for (i = backTrace->s[sv]; i < backTrace->e[sv]; i++) {
+      if (toParse >= end || Character::toLowerCase(pattern[toParse]) != Character::toLowerCase((*backStr)[i]))
+        goto fail;
+      toParse++;
+    }
+    goto advance;
+
+    RE_CASE(BkTraceName)
+    sv = code[pc].param0;
+    if (!backStr || !backTrace || sv == -1)
+      goto fail;
+    for (i = backTrace->ns[sv]; i < backTrace->ne[sv]; i++) {
+      if (toParse >= end || pattern[toParse] != (*backStr)[i])
+        goto fail;
+      toParse++;
+    }
+    goto advance;
+
+    RE_CASE(BkTraceNName)
+    // the same as in the tree walker: positions are taken from numbered matches
+    sv = code[pc].param0;
+    if (!backStr || !backTrace || sv == -1)
+      goto fail;
+    for (i = backTrace->s[sv]; i < backTrace->e[sv]; i++) {
+      if (toParse >= end || Character::toLowerCase(pattern[toParse]) != Character::toLowerCase((*backStr)[i]))
+        goto fail;
+      toParse++;
+    }
+    goto advance;
+#endif  // COLORERMODE
+
+    RE_CASE(BkBrack)
+    sv = code[pc].param0;
+    if (sv == -1 || cMatch <= sv)
+      goto fail;
+    if (matches->s[sv] == -1 || matches->e[sv] == -1)
+      goto fail;
+    for (i = matches->s[sv]; i < matches->e[sv]; i++) {
+      if (toParse >= end || pattern[toParse] != pattern[i])
+        goto fail;
+      toParse++;
+    }
+    goto advance;
+
+    RE_CASE(BkBrackName)
+    sv = code[pc].param0;
+    if (sv == -1 || cnMatch <= sv)
+      goto fail;
+    if (matches->ns[sv] == -1 || matches->ne[sv] == -1)
+      goto fail;
+    for (i = matches->ns[sv]; i < matches->ne[sv]; i++) {
+      if (toParse >= end || pattern[toParse] != pattern[i])
+        goto fail;
+      toParse++;
+    }
+    goto advance;
+
+    RE_CASE(Ahead)
+    if (!leftenter)
+      goto succeed;
+    push(rea_Break, rea_False, code[pc].param, true, toParse);
+    RE_DISPATCH();
+
+    RE_CASE(NAhead)
+    if (!leftenter)
+      goto succeed;
+    push(rea_False, rea_Break, code[pc].param, true, toParse);
+    RE_DISPATCH();
+
+    RE_CASE(Behind)
+    if (!leftenter)
+      goto succeed;
+    if (toParse - code[pc].param0 < 0)
+      goto fail;
+    push(rea_Break, rea_False, code[pc].param, true, toParse - code[pc].param0);
+    RE_DISPATCH();
+
+    RE_CASE(NBehind)
+    if (!leftenter)
+      goto succeed;
+    if (toParse - code[pc].param0 < 0)
+      goto advance;
+    push(rea_False, rea_Break, code[pc].param, true, toParse - code[pc].param0);
+    RE_DISPATCH();
+
+    RE_CASE(Or)
+    if (!leftenter) {
+      pc = code[pc].exit;
+      goto advance;
+    }
+    push(rea_True, rea_Break, code[pc].param, true, toParse);
+    RE_DISPATCH();
+
+    RE_CASE(RangeN)
+    if (leftenter) {
+      state[pc].param0 = code[pc].s;
+      state[pc].oldParse = -1;
+    }
+    if (!state[pc].param0 && state[pc].oldParse == toParse)
+      goto advance;
+    state[pc].oldParse = toParse;
+    if (!state[pc].param0) {
+      push(rea_True, rea_RangeN_step2, code[pc].param, true, toParse);
+      RE_DISPATCH();
+    }
+    state[pc].param0--;
+    pc = code[pc].param;
+    leftenter = true;
+    RE_DISPATCH();
+
+    RE_CASE(RangeNM)
+    if (leftenter) {
+      state[pc].param0 = code[pc].s;
+      state[pc].param1 = code[pc].e - code[pc].s;
+      state[pc].oldParse = -1;
+    }
+    if (!state[pc].param0) {
+      if (!state[pc].param1) {
+        push(rea_True, rea_False, code[pc].next, code[pc].nextEnter, toParse);
+        RE_DISPATCH();
+      }
+      state[pc].param1--;
+      push(rea_True, rea_RangeNM_step2, code[pc].param, true, toParse);
+      RE_DISPATCH();
+    }
+    state[pc].param0--;
+    pc = code[pc].param;
+    leftenter = true;
+    RE_DISPATCH();
+
+    RE_CASE(NGRangeN)
+    if (leftenter) {
+      state[pc].param0 = code[pc].s;
+      state[pc].oldParse = -1;
+    }
+    if (!state[pc].param0 && state[pc].oldParse == toParse)
+      goto advance;
+    state[pc].oldParse = toParse;
+    if (!state[pc].param0) {
+      push(rea_True, rea_NGRangeN_step2, code[pc].next, code[pc].nextEnter, toParse);
+      RE_DISPATCH();
+    }
+    state[pc].param0--;
+    pc = code[pc].param;
+    leftenter = true;
+    RE_DISPATCH();
+
+    RE_CASE(NGRangeNM)
+    if (leftenter) {
+      state[pc].param0 = code[pc].s;
+      state[pc].param1 = code[pc].e - code[pc].s;
+      state[pc].oldParse = -1;
+    }
+    if (!state[pc].param0) {
+      if (!state[pc].param1) {
+        push(rea_True, rea_False, code[pc].next, code[pc].nextEnter, toParse);
+        RE_DISPATCH();
+      }
+      state[pc].param1--;
+      push(rea_True, rea_NGRangeNM_step2, code[pc].next, code[pc].nextEnter, toParse);
+      RE_DISPATCH();
+    }
+    state[pc].param0--;
+    pc = code[pc].param;
+    leftenter = true;
+    RE_DISPATCH();
+
+    RE_CASE(Count)
+    return false;
+  }
+
+advance:
+  leftenter = code[pc].nextEnter;
+  pc = code[pc].next;
+  RE_DISPATCH();
+
+fail:
+  res = false;
+  goto pop;
+succeed:
+  res = true;
+pop:
+  if (ctx.count_elem == 0)
+    return res;
+  {
+    const ProgramFrame& frame = ctx.frames[--ctx.count_elem];
+    pc = frame.pc;
+    toParse = frame.toParse;
+    leftenter = frame.leftenter;
+    action = res ? frame.ifTrueReturn : frame.ifFalseReturn;
+  }
+
+  switch (action) {
+    case rea_False:
+      goto fail;
+    case rea_True:
+      goto succeed;
+    case rea_Break:
+      goto advance;
+    case rea_RangeN_step2:
+      push(rea_True, rea_False, code[pc].next, code[pc].nextEnter, toParse);
+      break;
+    case rea_RangeNM_step2:
+      push(rea_True, rea_RangeNM_step3, code[pc].next, code[pc].nextEnter, toParse);
+      break;
+    case rea_NGRangeN_step2:
+      if (state[pc].param0)
+        state[pc].param0--;
+      pc = code[pc].param;
+      leftenter = true;
+      break;
+    case rea_NGRangeNM_step2:
+      push(rea_True, rea_NGRangeNM_step3, code[pc].param, true, toParse);
+      break;
+    case rea_RangeNM_step3:
+    case rea_NGRangeNM_step3:
+      state[pc].param1++;
+      goto fail;
+    default:
+      break;
+  }
+  RE_DISPATCH();
+}
+
+#undef RE_CASE
+#undef RE_DISPATCH
+
+#if defined(__GNUC__) || defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif  // COLORER_FEATURE_REGEXP_BYTECODE
@@ -0,0 +1,288 @@
+#include <algorithm>
+#include <map>
+#include "colorer/cregexp/cregexp.h"
+
+/*
+  DFA is built from the RE tree by Glushkov construction: each char of RE
+  is a position, DFA state is a set of positions. Chars 0x00-0xFF with the
+  same set of positions, which can match them, are joined into one class,
+  chars greater than 0xFF make one more class.
+  Construction stops, if RE is too big, and RE is matched by backtracking only.
+*/
+
+// limits of DFA size
+static const int MAX_DFA_POSITIONS = 512;
+static const int MAX_DFA_STATES = 256;
+
+class DfaBuilder
+{
+ public:
+  explicit DfaBuilder(const CRegExp& re_) : re(re_) {}
+
+  std::unique_ptr<SRegDfa> build();
+
+ private:
+  // set of positions, which can be first/last in the text, matched by subexpression
+  struct Fragment
+  {
+    bool nullable = true;
+    std::vector<int> first;
+    std::vector<int> last;
+  };
+
+  const CRegExp& re;
+  bool failed = false;
+  std::vector<SStartChars> positions;
+  std::vector<std::vector<int>> follow;
+
+  Fragment sequence(const SRegInfo* node);
+  Fragment atom(const SRegInfo* node);
+  int addPosition(const SRegInfo* node, int idx);
+  void concat(Fragment& left, const Fragment& right);
+  void loop(const Fragment& frag);
+};
+
+int DfaBuilder::addPosition(const SRegInfo* node, int idx)
+{
+  if (static_cast<int>(positions.size()) == MAX_DFA_POSITIONS) {
+    failed = true;
+    return -1;
+  }
+  positions.emplace_back();
+  re.fillAtomChars(node, idx, positions.back());
+  follow.emplace_back();
+  return static_cast<int>(positions.size()) - 1;
+}
+
+void DfaBuilder::concat(Fragment& left, const Fragment& right)
+{
+  for (int p : left.last) {
+    follow[p].insert(follow[p].end(), right.first.begin(), right.first.end());
+  }
+  if (left.nullable) {
+    left.first.insert(left.first.end(), right.first.begin(), right.first.end());
+  }
+  if (right.nullable) {
+    left.last.insert(left.last.end(), right.last.begin(), right.last.end());
+  }
+  else {
+    left.last = right.last;
+  }
+  left.nullable = left.nullable && right.nullable;
+}
+
+void DfaBuilder::loop(const Fragment& frag)
+{
+  for (int p : frag.last) {
+    follow[p].insert(follow[p].end(), frag.first.begin(), frag.first.end());
+  }
+}
+
+DfaBuilder::Fragment DfaBuilder::sequence(const SRegInfo* node)
+{
+  Fragment frag;
+  for (; node && !failed; node = node->next) {
+    if (node->op == EOps::ReOr) {
+      // left alternative is in param, right is the rest of the sequence
+      Fragment alt = sequence(node->un.param);
+      Fragment right = sequence(node->next);
+      alt.nullable = alt.nullable || right.nullable;
+      alt.first.insert(alt.first.end(), right.first.begin(), right.first.end());
+      alt.last.insert(alt.last.end(), right.last.begin(), right.last.end());
+      concat(frag, alt);
+      break;
+    }
+    concat(frag, atom(node));
+  }
+  return frag;
+}
+
+DfaBuilder::Fragment DfaBuilder::atom(const SRegInfo* node)
+{
+  Fragment frag;
+  switch (node->op) {
+    case EOps::ReBrackets:
+    case EOps::ReNamedBrackets:
+      return sequence(node->un.param);
+    case EOps::ReMul:
+    case EOps::ReNGMul:
+      frag = sequence(node->un.param);
+      loop(frag);
+      frag.nullable = true;
+      return frag;
+    case EOps::RePlus:
+    case EOps::ReNGPlus:
+      frag = sequence(node->un.param);
+      loop(frag);
+      return frag;
+    case EOps::ReQuest:
+    case EOps::ReNGQuest:
+      frag = sequence(node->un.param);
+      frag.nullable = true;
+      return frag;
+    case EOps::ReRangeN:
+    case EOps::ReNGRangeN:
+      frag = sequence(node->un.param);
+      loop(frag);
+      frag.nullable = frag.nullable || node->s == 0;
+      return frag;
+    case EOps::ReRangeNM:
+    case EOps::ReNGRangeNM:
+      frag = sequence(node->un.param);
+      if (node->e > 1)
+        loop(frag);
+      frag.nullable = frag.nullable || node->s == 0;
+      return frag;
+    case EOps::ReWord: {
+      int len = node->un.word->length();
+      if (re.ignoreCase) {
+        for (int i = 0; i < len; i++) {
+          // case folding can change the length of non ascii text
+          if ((*node->un.word)[i] >= 0x80) {
+            failed = true;
+            return frag;
+          }
+        }
+      }
+      for (int i = 0; i < len && !failed; i++) {
+        Fragment chr;
+        int p = addPosition(node, i);
+        if (p == -1)
+          break;
+        chr.nullable = false;
+        chr.first.push_back(p);
+        chr.last.push_back(p);
+        concat(frag, chr);
+      }
+      return frag;
+    }
+    case EOps::ReSymb:
+    case EOps::ReEnum:
+    case EOps::ReNEnum:
+    case EOps::ReMetaSymb: {
+      SStartChars test;
+      if (!re.fillAtomChars(node, 0, test)) {
+        // zero width assertion
+        return frag;
+      }
+      int p = addPosition(node, 0);
+      if (p == -1)
+        return frag;
+      frag.nullable = false;
+      frag.first.push_back(p);
+      frag.last.push_back(p);
+      return frag;
+    }
+    case EOps::ReBehind:
+    case EOps::ReNBehind:
+    case EOps::ReBkBrack:
+    case EOps::ReBkBrackName:
+#ifdef COLORERMODE
+    case EOps::ReBkTrace:
+    case EOps::ReBkTraceN:
+    case EOps::ReBkTraceName:
+    case EOps::ReBkTraceNName:
+#endif
+      failed = true;
+      return frag;
+    default:
+      // look ahead and empty nodes
+      return frag;
+  }
+}
+
+std::unique_ptr<SRegDfa> DfaBuilder::build()
+{
+  Fragment root = sequence(re.tree_root);
+  // DFA of RE, which can match empty string, never rejects position
+  if (failed || root.nullable) {
+    return nullptr;
+  }
+  auto npos = static_cast<int>(positions.size());
+  for (auto& f : follow) {
+    std::sort(f.begin(), f.end());
+    f.erase(std::unique(f.begin(), f.end()), f.end());
+  }
+  std::vector<bool> is_last(npos);
+  for (int p : root.last) {
+    is_last[p] = true;
+  }
+
+  // classes of chars by the set of positions, which match them
+  auto dfa = std::make_unique<SRegDfa>();
+  std::map<std::vector<bool>, int> class_index;
+  std::vector<std::vector<bool>> class_positions;
+  for (int c = 0; c < 257; c++) {
+    std::vector<bool> matched(npos);
+    for (int p = 0; p < npos; p++) {
+      matched[p] = c < 256 ? positions[p].chars[c] : positions[p].high;
+    }
+    auto it = class_index.find(matched);
+    if (it == class_index.end()) {
+      it = class_index.emplace(matched, static_cast<int>(class_positions.size())).first;
+      class_positions.push_back(matched);
+    }
+    dfa->classes[c] = static_cast<uint8_t>(it->second);
+  }
+  if (class_positions.size() > 255) {
+    return nullptr;
+  }
+  dfa->classCount = static_cast<int>(class_positions.size());
+
+  // states are built by subset construction, start state has no positions,
+  // its transitions are made by the first positions of RE
+  std::map<std::vector<int>, int> state_index;
+  std::vector<std::vector<int>> states(1);
+  for (size_t st = 0; st < states.size(); st++) {
+    dfa->next.resize((st + 1) * dfa->classCount, SRegDfa::DEAD);
+    for (int cls = 0; cls < dfa->classCount; cls++) {
+      std::vector<int> target;
+      bool match = false;
+      auto add_follow = [&](const std::vector<int>& list) {
+        for (int p : list) {
+          if (class_positions[cls][p]) {
+            target.push_back(p);
+            match = match || is_last[p];
+          }
+        }
+      };
+      if (st == 0) {
+        add_follow(root.first);
+      }
+      else {
+        for (int p : states[st]) {
+          add_follow(follow[p]);
+        }
+      }
+      if (match) {
+        dfa->next[st * dfa->classCount + cls] = SRegDfa::MATCH;
+        continue;
+      }
+      if (target.empty()) {
+        continue;
+      }
+      std::sort(target.begin(), target.end());
+      target.erase(std::unique(target.begin(), target.end()), target.end());
+      auto it = state_index.find(target);
+      if (it == state_index.end()) {
+        if (static_cast<int>(states.size()) == MAX_DFA_STATES) {
+          return nullptr;
+        }
+        it = state_index.emplace(target, static_cast<int>(states.size())).first;
+        states.push_back(std::move(target));
+      }
+      dfa->next[st * dfa->classCount + cls] = static_cast<int16_t>(it->second);
+    }
+  }
+  return dfa;
+}
+
+void CRegExp::compileDfa()
+{
+  dfa = DfaBuilder(*this).build();
+}
+
+bool CRegExp::hasDfa() const
+{
+  return error == EError::EOK && dfa != nullptr;
+}
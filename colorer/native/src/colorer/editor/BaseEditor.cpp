@@ -1,7 +1,12 @@
 #include "colorer/editor/BaseEditor.h"
+#include <algorithm>
 #include "colorer/parsers/TextParserImpl.h"
 
 #define IDLE_PARSE(time) (100 + (time) * 4)
+// number of lines, indexed at first while pair is searched after the indexed text
+#define PAIR_INDEX_STEP 1000
+// number of lines, parsed by the worker thread between checks of its state
+#define BACKGROUND_PARSE_STEP 500
 
 const int CHOOSE_STR = 4;
 const int CHOOSE_LEN = 200 * CHOOSE_STR;
@@ -44,14 +49,30 @@ BaseEditor::BaseEditor(ParserFactory* parserFactory_, LineSource* lineSource_)
   def_Special = hrcLibrary.getRegion(&def_special);
   def_PairStart = hrcLibrary.getRegion(&def_pstart);
   def_PairEnd = hrcLibrary.getRegion(&def_pend);
+  pairIndex = std::make_unique<PairIndex>(def_PairStart, def_PairEnd);
 
   setRegionCompact(regionCompact);
 
   rd_def_Text = rd_def_HorzCross = rd_def_VertCross = nullptr;
 }
 
+BaseEditor::ParseLock::ParseLock(const BaseEditor* editor_) : editor(editor_)
+{
+  // worker breaks its parse, when it sees the request
+  ++editor->pauseRequests;
+  editor->parseMutex.lock();
+}
+
+BaseEditor::ParseLock::~ParseLock()
+{
+  --editor->pauseRequests;
+  editor->parseMutex.unlock();
+  editor->workerCondition.notify_all();
+}
+
 BaseEditor::~BaseEditor()
 {
+  setBackgroundParsing(false);
   textParser->breakParse();
   if (internalRM) {
     delete regionMapper;
@@ -61,14 +82,34 @@ BaseEditor::~BaseEditor()
 
 void BaseEditor::setRegionCompact(bool compact)
 {
+  ParseLock lock(this);
   if (!lrSupport || regionCompact != compact) {
     regionCompact = compact;
     remapLRS(true);
   }
 }
 
+void BaseEditor::setDocumentRegions(bool enable, size_t regionLimit)
+{
+  ParseLock lock(this);
+  if (documentRegions && lrSupport) {
+    // regions copied from the store keep their defines, new store can reuse addresses of its defines
+    lrSupport->setRegionMapper(regionMapper);
+  }
+  documentRegions.reset();
+  documentRegionLimit = regionLimit;
+  if (enable) {
+    documentRegions = std::make_unique<LineRegionsFlatSupport>(regionCompact);
+    documentRegions->resize(lineCount);
+    documentRegions->setRegionLimit(regionLimit);
+    documentRegions->setRegionMapper(regionMapper);
+    documentRegions->setSpecialRegion(def_Special);
+  }
+}
+
 void BaseEditor::setRegionMapper(RegionMapper* rs)
 {
+  ParseLock lock(this);
   if (internalRM) {
     delete regionMapper;
   }
@@ -79,6 +120,7 @@ void BaseEditor::setRegionMapper(RegionMapper* rs)
 
 void BaseEditor::setRegionMapper(const UnicodeString* hrdClass, const UnicodeString* hrdName)
 {
+  ParseLock lock(this);
   if (internalRM) {
     delete regionMapper;
   }
@@ -102,6 +144,10 @@ void BaseEditor::remapLRS(bool recreate)
   }
   lrSupport->setRegionMapper(regionMapper);
   lrSupport->setSpecialRegion(def_Special);
+  if (documentRegions) {
+    // stored regions have defines of the old mapper
+    setDocumentRegions(true, documentRegionLimit);
+  }
   invalidLine = 0;
   rd_def_Text = rd_def_HorzCross = rd_def_VertCross = nullptr;
   if (regionMapper != nullptr) {
@@ -113,15 +159,18 @@ void BaseEditor::remapLRS(bool recreate)
 
 void BaseEditor::setFileType(FileType* ftype)
 {
+  ParseLock lock(this);
   COLORER_LOG_DEBUG("[BaseEditor] setFileType: %", ftype->getName());
   currentFileType = ftype;
   parserFactory->getHrcLibrary().loadFileType(ftype);
   textParser->setFileType(currentFileType);
   invalidLine = 0;
+  pairIndex->modifyEvent(0);
 }
 
 FileType* BaseEditor::setFileType(const UnicodeString& fileType)
 {
+  ParseLock lock(this);
   currentFileType = parserFactory->getHrcLibrary().getFileType(&fileType);
   setFileType(currentFileType);
   return currentFileType;
@@ -160,6 +209,7 @@ FileType* BaseEditor::chooseFileTypeCh(const UnicodeString* fileName, int choose
 
 FileType* BaseEditor::chooseFileType(const UnicodeString* fileName)
 {
+  ParseLock lock(this);
   if (lineSource == nullptr) {
     currentFileType = parserFactory->getHrcLibrary().chooseFileType(fileName, nullptr);
   }
@@ -184,18 +234,26 @@ FileType* BaseEditor::getFileType()
   return currentFileType;
 }
 
+LineSource* BaseEditor::getLineSource()
+{
+  return lineSource;
+}
+
 void BaseEditor::setBackParse(int _backParse)
 {
+  ParseLock lock(this);
   backParse = _backParse;
 }
 
 void BaseEditor::addRegionHandler(RegionHandler* rh)
 {
+  ParseLock lock(this);
   regionHandlers.push_back(rh);
 }
 
 void BaseEditor::removeRegionHandler(RegionHandler* rh)
 {
+  ParseLock lock(this);
   for (auto ft = regionHandlers.begin(); ft != regionHandlers.end(); ++ft) {
     if (*ft == rh) {
       regionHandlers.erase(ft);
@@ -206,11 +264,13 @@ void BaseEditor::removeRegionHandler(RegionHandler* rh)
 
 void BaseEditor::addEditorListener(EditorListener* el)
 {
+  ParseLock lock(this);
   editorListeners.push_back(el);
 }
 
 void BaseEditor::removeEditorListener(EditorListener* el)
 {
+  ParseLock lock(this);
   for (auto ft = editorListeners.begin(); ft != editorListeners.end(); ++ft) {
     if (*ft == el) {
       editorListeners.erase(ft);
@@ -221,6 +281,7 @@ void BaseEditor::removeEditorListener(EditorListener* el)
 
 PairMatch* BaseEditor::getPairMatch(int lineNo, int linePos, LineRegion** lineRegion)
 {
+  ParseLock lock(this);
   *lineRegion = nullptr;
   LineRegion* lrStart = getLineRegions(lineNo);
   if (lrStart == nullptr) {
@@ -255,6 +316,7 @@ void BaseEditor::releasePairMatch(PairMatch* pm)
 
 PairMatch* BaseEditor::searchPair(int lineNo, int pos, int start_line, int end_line)
 {
+  ParseLock lock(this);
   LineRegion* slr = nullptr;
   PairMatch* pm = getPairMatch(lineNo, pos, &slr);
   if (pm == nullptr) {
@@ -309,17 +371,93 @@ PairMatch* BaseEditor::searchPair(int lineNo, int pos, int start_line, int end_l
 
 PairMatch* BaseEditor::searchLocalPair(int lineNo, int pos)
 {
+  ParseLock lock(this);
   int end_line = getLastVisibleLine();
   return searchPair(lineNo, pos, wStart, end_line);
 }
 
 PairMatch* BaseEditor::searchGlobalPair(int lineNo, int pos)
 {
-  return searchPair(lineNo, pos, 0, lineCount);
+  ParseLock lock(this);
+  LineRegion* slr = nullptr;
+  PairMatch* pm = getPairMatch(lineNo, pos, &slr);
+  if (pm == nullptr) {
+    return nullptr;
+  }
+  indexPairs(lineNo);
+  size_t idx = pairIndex->findToken(lineNo, pos);
+  if (idx == PairIndex::NO_TOKEN) {
+    releasePairMatch(pm);
+    return searchPair(lineNo, pos, 0, lineCount);
+  }
+  // pair of the start region can be in the text after indexed lines
+  for (int step = PAIR_INDEX_STEP; pairIndex->getToken(idx).pair == PairIndex::NO_TOKEN &&
+       pairIndex->getToken(idx).pairStart && static_cast<int>(pairIndex->getIndexedLine()) < lineCount;
+       step *= 2)
+  {
+    size_t indexed = pairIndex->getIndexedLine();
+    indexPairs(static_cast<int>(indexed) + step);
+    // parser stopped before the end of text
+    if (pairIndex->getIndexedLine() == indexed) {
+      break;
+    }
+  }
+  size_t pair_idx = pairIndex->getToken(idx).pair;
+  if (pair_idx == PairIndex::NO_TOKEN) {
+    return pm;
+  }
+
+  const auto& pair = pairIndex->getToken(pair_idx);
+  pm->eline = static_cast<int>(pair.lno);
+  pm->pairBalance = 0;
+  // region of the pair in line regions has mapping of this editor
+  LineRegion* end = nullptr;
+  for (LineRegion* lr = getLineRegions(pm->eline); lr; lr = lr->next) {
+    if (lr->region == pair.region && lr->start <= pair.end && lr->end >= pair.start) {
+      end = lr;
+      if (lr->start == pair.start) {
+        break;
+      }
+    }
+  }
+  if (end != nullptr) {
+    pm->setEnd(end);
+  }
+  else {
+    LineRegion token;
+    token.region = pair.region;
+    token.start = pair.start;
+    token.end = pair.end;
+    pm->setEnd(&token);
+  }
+  return pm;
+}
+
+void BaseEditor::indexPairs(int lno)
+{
+  if (lno >= lineCount) {
+    lno = lineCount - 1;
+  }
+  int from = static_cast<int>(pairIndex->getIndexedLine());
+  if (from > lno) {
+    return;
+  }
+  // cache of the parser is valid only before invalidLine
+  TextParser::TextParseMode tpmode = TextParser::TextParseMode::TPM_CACHE_READ;
+  if (lno >= invalidLine) {
+    from = std::min(from, invalidLine);
+    tpmode = TextParser::TextParseMode::TPM_CACHE_UPDATE;
+  }
+  COLORER_LOG_DEBUG("[BaseEditor] indexPairs:parse:%-%", from, lno);
+  int stopLine = textParser->parse(from, lno + 1 - from, tpmode);
+  if (tpmode == TextParser::TextParseMode::TPM_CACHE_UPDATE) {
+    invalidLine = stopLine + 1;
+  }
 }
 
 LineRegion* BaseEditor::getLineRegions(int lno)
 {
+  ParseLock lock(this);
   /*
    * Backparse value check
    */
@@ -332,24 +470,43 @@ LineRegion* BaseEditor::getLineRegions(int lno)
 
 void BaseEditor::modifyEvent(int topLine)
 {
+  ParseLock lock(this);
   COLORER_LOG_DEBUG("[BaseEditor] modifyEvent: %", topLine);
+  // index can be ahead of invalidLine
+  pairIndex->modifyEvent(topLine);
   if (invalidLine > topLine) {
     invalidLine = topLine;
     for (auto& editorListener : editorListeners) {
       editorListener->modifyEvent(topLine);
     }
   }
+  workerCondition.notify_all();
 }
 
 void BaseEditor::modifyLineEvent(int line)
 {
-  if (invalidLine > line) {
-    invalidLine = line;
+  ParseLock lock(this);
+  COLORER_LOG_DEBUG("[BaseEditor] modifyLineEvent: %", line);
+  if (invalidLine <= line) {
+    pairIndex->modifyEvent(line);
+    return;
+  }
+  bool lineUpdate = line < lineCount;
+  for (auto& editorListener : editorListeners) {
+    lineUpdate = lineUpdate && editorListener->modifyLineEvent(line);
+  }
+  if (lineUpdate) {
+    pairIndex->modifyLineEvent(line);
+    if (textParser->tryParseLine(line)) {
+      return;
+    }
   }
+  modifyEvent(line);
 }
 
 void BaseEditor::visibleTextEvent(int wStart_, int wSize_)
 {
+  ParseLock lock(this);
   COLORER_LOG_DEBUG("[BaseEditor] visibleTextEvent: %-%", wStart_, wSize_);
   wStart = wStart_;
   wSize = wSize_;
@@ -357,8 +514,13 @@ void BaseEditor::visibleTextEvent(int wStart_, int wSize_)
 
 void BaseEditor::lineCountEvent(int newLineCount)
 {
+  ParseLock lock(this);
   COLORER_LOG_DEBUG("[BaseEditor] lineCountEvent: %", newLineCount);
   lineCount = newLineCount;
+  if (documentRegions) {
+    documentRegions->resize(lineCount);
+  }
+  workerCondition.notify_all();
 }
 
 inline int BaseEditor::getLastVisibleLine() const
@@ -370,6 +532,7 @@ inline int BaseEditor::getLastVisibleLine() const
 
 void BaseEditor::validate(int lno, bool rebuildRegions)
 {
+  ParseLock lock(this);
   int parseFrom;
   int parseTo;
   bool layoutChanged = false;
@@ -444,7 +607,10 @@ void BaseEditor::validate(int lno, bool rebuildRegions)
   }
 
   /* Runs parser */
-  if (parseTo - parseFrom > 0) {
+  if (parseTo - parseFrom > 0 && documentRegions && tpmode == TextParser::TextParseMode::TPM_CACHE_READ) {
+    readDocumentRegions(parseFrom, parseTo);
+  }
+  else if (parseTo - parseFrom > 0) {
     COLORER_LOG_DEBUG("[BaseEditor] validate:parse:%-%, %", parseFrom, parseTo,
                       tpmode == TextParser::TextParseMode::TPM_CACHE_READ ? "READ" : "UPDATE");
     int stopLine = textParser->parse(parseFrom, parseTo - parseFrom, tpmode);
@@ -456,8 +622,90 @@ void BaseEditor::validate(int lno, bool rebuildRegions)
   }
 }
 
+void BaseEditor::readDocumentRegions(int from, int to)
+{
+  // regions of lines after invalidLine are out of date
+  auto stored = [this](int lno) { return lno < invalidLine && documentRegions->hasLine(lno); };
+  int lno = from;
+  while (lno < to) {
+    if (stored(lno)) {
+      lrSupport->setLineRegions(lno, documentRegions->getLineRegions(lno));
+      lno++;
+      continue;
+    }
+    int parseFrom = lno;
+    while (lno < to && !stored(lno)) {
+      lno++;
+    }
+    COLORER_LOG_DEBUG("[BaseEditor] readDocumentRegions:parse:%-%", parseFrom, lno);
+    textParser->parse(parseFrom, lno - parseFrom, TextParser::TextParseMode::TPM_CACHE_READ);
+  }
+}
+
+void BaseEditor::setBackgroundParsing(bool enable)
+{
+  if (enable) {
+    ParseLock lock(this);
+    if (!worker.joinable()) {
+      stopWorker = false;
+      worker = std::thread(&BaseEditor::backgroundParse, this);
+    }
+    return;
+  }
+  std::thread stopped;
+  {
+    ParseLock lock(this);
+    stopWorker = true;
+    stopped.swap(worker);
+  }
+  workerCondition.notify_all();
+  if (stopped.joinable()) {
+    stopped.join();
+  }
+}
+
+void BaseEditor::backgroundParse()
+{
+  std::unique_lock<std::recursive_mutex> lock(parseMutex);
+  while (!stopWorker) {
+    if (pauseRequests > 0 || invalidLine >= lineCount || currentFileType == nullptr) {
+      workerCondition.wait(lock);
+      continue;
+    }
+    int parseFrom = invalidLine;
+    int parseNum = std::min(BACKGROUND_PARSE_STEP, lineCount - invalidLine);
+    COLORER_LOG_DEBUG("[BaseEditor] backgroundParse:parse:%-%", parseFrom, parseFrom + parseNum);
+    workerParsing = true;
+    workerBroken = false;
+    int stopLine = textParser->parse(parseFrom, parseNum, TextParser::TextParseMode::TPM_CACHE_UPDATE);
+    workerParsing = false;
+    if (workerBroken) {
+      // line, where parse was broken, is not completed
+      invalidLine = stopLine;
+      pairIndex->modifyEvent(stopLine);
+      for (auto& editorListener : editorListeners) {
+        editorListener->modifyEvent(stopLine);
+      }
+      continue;
+    }
+    invalidLine = stopLine + 1;
+    for (auto& editorListener : editorListeners) {
+      editorListener->parseProgressEvent(invalidLine, lineCount);
+    }
+  }
+}
+
+void BaseEditor::checkBreak()
+{
+  if (workerParsing && !workerBroken && (pauseRequests > 0 || stopWorker)) {
+    workerBroken = true;
+    textParser->breakParse();
+  }
+}
+
 void BaseEditor::idleJob(int time)
 {
+  ParseLock lock(this);
   if (invalidLine < lineCount) {
     if (time < 0) {
       time = 0;
@@ -472,6 +720,10 @@ void BaseEditor::idleJob(int time)
 void BaseEditor::startParsing(size_t lno)
 {
   lrSupport->startParsing(lno);
+  if (documentRegions) {
+    documentRegions->startParsing(lno);
+  }
+  pairIndex->startParsing(lno);
   for (auto& regionHandler : regionHandlers) {
     regionHandler->startParsing(lno);
   }
@@ -480,6 +732,10 @@ void BaseEditor::startParsing(size_t lno)
 void BaseEditor::endParsing(size_t lno)
 {
   lrSupport->endParsing(lno);
+  if (documentRegions) {
+    documentRegions->endParsing(lno);
+  }
+  pairIndex->endParsing(lno);
   for (auto& regionHandler : regionHandlers) {
     regionHandler->endParsing(lno);
   }
@@ -487,7 +743,12 @@ void BaseEditor::endParsing(size_t lno)
 
 void BaseEditor::clearLine(size_t lno, UnicodeString* line)
 {
+  checkBreak();
   lrSupport->clearLine(lno, line);
+  if (documentRegions) {
+    documentRegions->clearLine(lno, line);
+  }
+  pairIndex->clearLine(lno, line);
   for (auto& regionHandler : regionHandlers) {
     regionHandler->clearLine(lno, line);
   }
@@ -495,7 +756,12 @@ void BaseEditor::clearLine(size_t lno, UnicodeString* line)
 
 void BaseEditor::addRegion(size_t lno, UnicodeString* line, int sx, int ex, const Region* region)
 {
+  checkBreak();
   lrSupport->addRegion(lno, line, sx, ex, region);
+  if (documentRegions) {
+    documentRegions->addRegion(lno, line, sx, ex, region);
+  }
+  pairIndex->addRegion(lno, line, sx, ex, region);
   for (auto& regionHandler : regionHandlers) {
     regionHandler->addRegion(lno, line, sx, ex, region);
   }
@@ -504,7 +770,11 @@ void BaseEditor::addRegion(size_t lno, UnicodeString* line, int sx, int ex, cons
 void BaseEditor::enterScheme(size_t lno, UnicodeString* line, int sx, int ex, const Region* region,
                              const Scheme* scheme)
 {
+  checkBreak();
   lrSupport->enterScheme(lno, line, sx, ex, region, scheme);
+  if (documentRegions) {
+    documentRegions->enterScheme(lno, line, sx, ex, region, scheme);
+  }
   for (auto& regionHandler : regionHandlers) {
     regionHandler->enterScheme(lno, line, sx, ex, region, scheme);
   }
@@ -514,6 +784,9 @@ void BaseEditor::leaveScheme(size_t lno, UnicodeString* line, int sx, int ex, co
                              const Scheme* scheme)
 {
   lrSupport->leaveScheme(lno, line, sx, ex, region, scheme);
+  if (documentRegions) {
+    documentRegions->leaveScheme(lno, line, sx, ex, region, scheme);
+  }
   for (auto& regionHandler : regionHandlers) {
     regionHandler->leaveScheme(lno, line, sx, ex, region, scheme);
   }
@@ -521,15 +794,18 @@ void BaseEditor::leaveScheme(size_t lno, UnicodeString* line, int sx, int ex, co
 
 bool BaseEditor::haveInvalidLine() const
 {
+  ParseLock lock(this);
   return invalidLine < lineCount;
 }
 
 int BaseEditor::getInvalidLine() const
 {
+  ParseLock lock(this);
   return invalidLine;
 }
 
 void BaseEditor::setMaxBlockSize(int max_block_size)
 {
+  ParseLock lock(this);
   textParser->setMaxBlockSize(max_block_size);
 }
\ No newline at end of file
@@ -1,10 +1,15 @@
 #ifndef COLORER_BASEEDITOR_H
 #define COLORER_BASEEDITOR_H
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include "colorer/LineSource.h"
 #include "colorer/ParserFactory.h"
 #include "colorer/TextParser.h"
 #include "colorer/editor/EditorListener.h"
+#include "colorer/editor/PairIndex.h"
 #include "colorer/editor/PairMatch.h"
 #include "colorer/handlers/LineRegionsCompactSupport.h"
 #include "colorer/handlers/LineRegionsSupport.h"
@@ -17,11 +22,37 @@
  * state, outline structure creation, pair constructions search.
  * This class has event-oriented structure. Each editor event
  * is passed into this object and gets internal processing.
+ * In background mode the text after the last valid line is parsed
+ * by the worker thread of the editor. Each editor method stops it, while
+ * the method works, region handlers and editor listeners are called from
+ * the worker thread.
  * @ingroup colorer_editor
  */
 class BaseEditor : public RegionHandler
 {
  public:
+  /**
+   * Stops background parsing for the lifetime of this object.
+   * Parse of the text is broken at the nearest line or region and is continued
+   * later from the first not parsed line. Methods of the editor can be
+   * called while lock is held, data of region handlers and editor listeners
+   * can be read under this lock only.
+   */
+  class ParseLock
+  {
+   public:
+    explicit ParseLock(const BaseEditor* editor);
+    ~ParseLock();
+
+    ParseLock(ParseLock&&) = delete;
+    ParseLock(const ParseLock&) = delete;
+    ParseLock& operator=(const ParseLock&) = delete;
+    ParseLock& operator=(ParseLock&&) = delete;
+
+   private:
+    const BaseEditor* editor;
+  };
+
   /**
    * Initial constructor.
    * Creates uninitialized base editor functionality support.
@@ -46,6 +77,17 @@ class BaseEditor : public RegionHandler
    */
   void setRegionCompact(bool compact);
 
+  /**
+   * Keeps regions of all parsed lines in compact store (LineRegionsFlatSupport).
+   * Regions of already parsed lines are copied from this store, when visible
+   * area is moved, instead of the parse of text. Only lines, dropped from
+   * the store by its limit, are parsed again.
+   * @param enable Creates (true) or drops (false) the store.
+   * @param regionLimit Maximum number of stored regions, regions of the least
+   *        recently used lines are dropped over it. 0 - no limit.
+   */
+  void setDocumentRegions(bool enable, size_t regionLimit = 0);
+
   /**
    * Installs specified RegionMapper, which
    * maps HRC Regions into color data.
@@ -94,6 +136,11 @@ class BaseEditor : public RegionHandler
    */
   FileType* getFileType();
 
+  /**
+   * Returns source of the text lines of this editor
+   */
+  LineSource* getLineSource();
+
   /**
    * Adds specified RegionHandler object
    * into parse process.
@@ -127,6 +174,8 @@ class BaseEditor : public RegionHandler
   /**
    * Searches pair match in all available text, possibly,
    * making additional processing.
+   * Pair is found by the index of paired regions of the text,
+   * only not indexed part of the text is parsed.
    * @param pos Position in line, where paired region to be searched.
    *        Paired Region is found, if it includes specified position
    *        or ends directly at one char before line position.
@@ -159,6 +208,8 @@ class BaseEditor : public RegionHandler
    * about visible text range and modification events.
    * @todo If number of lines, to be reparsed is more, than backParse parameter,
    * then method will return null, until validate() method is called.
+   * In background mode regions are changed by the worker thread, so they
+   * are read under ParseLock.
    */
   LineRegion* getLineRegions(int lno);
 
@@ -179,6 +230,16 @@ class BaseEditor : public RegionHandler
    */
   void validate(int lno, bool rebuildRegions);
 
+  /**
+   * Starts or stops background parsing.
+   * Worker thread parses the text from the first invalid line up to the end
+   * by parts and informs editor listeners about the progress. Parse is restarted
+   * after each modification of the text. Line source is read by the worker
+   * thread, so the text is changed under ParseLock.
+   * @param enable Creates worker thread (true) or stops and joins it (false).
+   */
+  void setBackgroundParsing(bool enable);
+
   /**
    * Tries to do some parsing job while user is doing nothing.
    * @param time integer between 0 and 100, shows an abount of time,
@@ -189,6 +250,8 @@ class BaseEditor : public RegionHandler
   /**
    * Informs BaseEditor object about text modification event.
    * All the text becomes invalid after the specified line.
+   * Outline items of these lines are removed and are added again by their parse,
+   * so outline is complete and text of items can be read only after #validate.
    * @param topLine Topmost modified line of text.
    */
   void modifyEvent(int topLine);
@@ -198,8 +261,10 @@ class BaseEditor : public RegionHandler
    * Generally, this type of event can be processed much faster
    * because of pre-checking line's changed structure and
    * cancelling further parsing in case of unmodified text structure.
+   * The line is parsed at once, if blocks, opened at its end, are the same
+   * as before the change, the text after it stays valid.
+   * Otherwise this is the same as #modifyEvent.
    * @param line Modified line of text.
-   * @todo Not used yet! This must include special 'try' parse method.
    */
   void modifyLineEvent(int line);
 
@@ -248,12 +313,24 @@ class BaseEditor : public RegionHandler
  private:
   FileType* chooseFileTypeCh(const UnicodeString* fileName, int chooseStr, int chooseLen);
   PairMatch* searchPair(int lineNo, int pos, int start_line, int end_line);
+  /**
+   * Parses the text, which is not indexed yet, up to the line @c lno.
+   */
+  void indexPairs(int lno);
+  /**
+   * Fills line regions of lines from @c from to @c to (exclusive) by the regions of
+   * document store, lines, which are not valid in the store, are parsed.
+   */
+  void readDocumentRegions(int from, int to);
 
   std::unique_ptr<TextParser> textParser;
   ParserFactory* parserFactory;
   LineSource* lineSource;
   RegionMapper* regionMapper;
   LineRegionsSupport* lrSupport;
+  std::unique_ptr<LineRegionsFlatSupport> documentRegions;
+  size_t documentRegionLimit = 0;
+  std::unique_ptr<PairIndex> pairIndex;
 
   FileType* currentFileType;
   std::vector<RegionHandler*> regionHandlers;
@@ -276,6 +353,21 @@ class BaseEditor : public RegionHandler
   bool internalRM;
   bool regionCompact;
 
+  // state of parser is changed only under this lock
+  mutable std::recursive_mutex parseMutex;
+  mutable std::condition_variable_any workerCondition;
+  // number of ParseLock objects, which wait or hold the lock
+  mutable std::atomic<int> pauseRequests {0};
+  std::thread worker;
+  bool stopWorker = false;
+  // true, while parser is run by the worker thread
+  bool workerParsing = false;
+  bool workerBroken = false;
+
+  void backgroundParse();
+  /** Breaks parse of the worker thread, if some thread waits for the lock. */
+  void checkBreak();
+
   inline int getLastVisibleLine() const;
   void remapLRS(bool recreate);
   /**
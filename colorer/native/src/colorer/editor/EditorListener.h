@@ -3,7 +3,12 @@
 
 #include <memory>
 /**
- * Listener of BaseEditor events
+ * Listener of BaseEditor events.
+ * Listeners drop data of modified lines on these events and get it again
+ * only from the next parse of the lines. E.g. Outliner removes items of
+ * modified lines and reads item text from the current text of line, so host
+ * must report the change of text before any use of items and parse the text
+ * again (BaseEditor::validate) before Outliner::getItemText is called.
  */
 class EditorListener
 {
@@ -15,6 +20,27 @@ class EditorListener
    */
   virtual void modifyEvent(size_t topLine) = 0;
 
+  /**
+   * Informs EditorListener object about modification of single line.
+   * If the line does not change the structure of text after it,
+   * only this line is parsed again, otherwise #modifyEvent is called.
+   * @param line Modified line of text.
+   * @return false, if listener can't update its state for the single line,
+   *   then all the text after the line is parsed again.
+   */
+  virtual bool modifyLineEvent(size_t /*line*/)
+  {
+    return false;
+  }
+
+  /**
+   * Informs EditorListener object about progress of background parsing.
+   * Called from the worker thread of the editor.
+   * @param validLine Lines before this one are parsed.
+   * @param lineCount Number of lines in the text.
+   */
+  virtual void parseProgressEvent(size_t /*validLine*/, size_t /*lineCount*/) {}
+
   EditorListener() = default;
   virtual ~EditorListener() = default;
   EditorListener(EditorListener&&) = delete;
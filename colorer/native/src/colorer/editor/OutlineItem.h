@@ -1,13 +1,15 @@
 #ifndef _COLORER_OUTLINEITEM_H_
 #define _COLORER_OUTLINEITEM_H_
 
-#include <memory>
+#include <cstddef>
 #include "colorer/Region.h"
 
 /**
  * Item in outliner's list.
  * Contans all the information about single
  * structured token with specified type (region reference).
+ * Text of item is not copied, it is read from the line of item
+ * by Outliner::getItemText.
  * @ingroup colorer_editor
  */
 class OutlineItem
@@ -19,29 +21,22 @@ public:
   int pos;
   /** Level of enclosure */
   int level;
-  /** Item text */
-  std::unique_ptr<UnicodeString> token;
   /** This item's region */
   const Region* region;
+  /** Parts of item text in the line, index of the first one in outliner and their number */
+  size_t textOffset;
+  size_t textCount;
 
   /** Default constructor */
-  OutlineItem() : lno(0), pos(0), level(0), token(nullptr), region(nullptr)
+  OutlineItem() : lno(0), pos(0), level(0), region(nullptr), textOffset(0), textCount(0)
   {
   }
 
   /** Initializing constructor */
-  OutlineItem(size_t lno_, int pos_, int level_, UnicodeString* token_, const Region* region_):
-    lno(lno_), pos(pos_), level(level_), token(nullptr), region(region_)
+  OutlineItem(size_t lno_, int pos_, int level_, const Region* region_, size_t textOffset_):
+    lno(lno_), pos(pos_), level(level_), region(region_), textOffset(textOffset_), textCount(0)
   {
-    if (token_ != nullptr) {
-      token = std::make_unique<UnicodeString>(*token_);
-    }
   }
-
-  ~OutlineItem()
-  = default;
 };
 
 #endif
-
-
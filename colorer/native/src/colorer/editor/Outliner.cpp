@@ -1,4 +1,22 @@
 #include "colorer/editor/Outliner.h"
+#include <algorithm>
+
+// text parts are repacked, if there are more than this number of parts of removed items
+static const size_t REPACK_MIN_GARBAGE = 1024;
+
+namespace {
+
+bool itemBeforeLine(const OutlineItem& item, size_t lno)
+{
+  return item.lno < lno;
+}
+
+bool lineBeforeItem(size_t lno, const OutlineItem& item)
+{
+  return lno < item.lno;
+}
+
+}  // namespace
 
 Outliner::Outliner(BaseEditor* baseEditor, const Region* searchRegion)
 {
@@ -12,16 +30,25 @@ Outliner::~Outliner()
 {
   baseEditor->removeRegionHandler(this);
   baseEditor->removeEditorListener(this);
-
-  for (auto it : outline) {
-    delete it;
-  }
-  outline.clear();
 }
 
 OutlineItem* Outliner::getItem(size_t idx)
 {
-  return outline.at(idx);
+  return &outline.at(idx);
+}
+
+UnicodeString Outliner::getItemText(size_t idx)
+{
+  const OutlineItem& item = outline.at(idx);
+  UnicodeString text;
+  const UnicodeString* line = baseEditor->getLineSource()->getLine(item.lno);
+  if (line == nullptr) {
+    return text;
+  }
+  for (size_t i = item.textOffset; i < item.textOffset + item.textCount; i++) {
+    text.append(*line, textParts[i].start, textParts[i].end - textParts[i].start);
+  }
+  return text;
 }
 
 size_t Outliner::itemCount() const
@@ -49,16 +76,49 @@ bool Outliner::isOutlined(const Region* region) const
   return region->hasParent(searchRegion);
 }
 
-void Outliner::modifyEvent(size_t topLine)
+size_t Outliner::eraseItems(size_t first, size_t last)
 {
-  for (size_t i = 0; i < outline.size(); ++i) {
-    if (outline[i]->lno >= topLine) {
-      outline.resize(i);
-      break;
-    }
+  for (size_t i = first; i < last; i++) {
+    liveParts -= outline[i].textCount;
+  }
+  outline.erase(outline.begin() + static_cast<std::ptrdiff_t>(first),
+                outline.begin() + static_cast<std::ptrdiff_t>(last));
+  if (textParts.size() - liveParts > REPACK_MIN_GARBAGE && textParts.size() > 2 * liveParts) {
+    repackText();
   }
+  return first;
+}
 
-  modifiedLine = topLine;
+size_t Outliner::eraseLines(size_t firstLine, size_t lastLine)
+{
+  auto first = std::lower_bound(outline.begin(), outline.end(), firstLine, itemBeforeLine);
+  auto last = std::upper_bound(first, outline.end(), lastLine, lineBeforeItem);
+  return eraseItems(static_cast<size_t>(first - outline.begin()), static_cast<size_t>(last - outline.begin()));
+}
+
+void Outliner::repackText()
+{
+  std::vector<TextPart> packed;
+  packed.reserve(liveParts);
+  for (auto& item : outline) {
+    size_t offset = packed.size();
+    packed.insert(packed.end(), textParts.begin() + static_cast<std::ptrdiff_t>(item.textOffset),
+                  textParts.begin() + static_cast<std::ptrdiff_t>(item.textOffset + item.textCount));
+    item.textOffset = offset;
+  }
+  textParts = std::move(packed);
+}
+
+void Outliner::modifyEvent(size_t topLine)
+{
+  eraseLines(topLine, NO_LINE);
+}
+
+bool Outliner::modifyLineEvent(size_t line)
+{
+  // items of the line are added again, when it is parsed
+  eraseLines(line, line);
+  return true;
 }
 
 void Outliner::startParsing(size_t /*lno*/)
@@ -66,40 +126,40 @@ void Outliner::startParsing(size_t /*lno*/)
   curLevel = 0;
 }
 
-void Outliner::endParsing(size_t lno)
+void Outliner::endParsing(size_t /*lno*/)
 {
-  if (modifiedLine < lno) {
-    modifiedLine = lno + 1;
-  }
   curLevel = 0;
 }
 
-void Outliner::clearLine(size_t /*lno*/, UnicodeString* /*line*/)
+void Outliner::clearLine(size_t lno, UnicodeString* /*line*/)
 {
+  // items of the parsed line are replaced by the new ones
+  insertItem = eraseLines(lno, lno);
   lineIsEmpty = true;
 }
 
-void Outliner::addRegion(size_t lno, UnicodeString* line, int sx, int ex, const Region* region)
+void Outliner::addRegion(size_t lno, UnicodeString* /*line*/, int sx, int ex, const Region* region)
 {
-  if (lno < modifiedLine) {
-    return;
-  }
   if (!isOutlined(region)) {
     return;
   }
 
-  auto itemLabel = UnicodeString(*line, sx, ex - sx);
-
   if (lineIsEmpty) {
-    outline.push_back(new OutlineItem(lno, sx, curLevel, &itemLabel, region));
-  }
-  else {
-    OutlineItem* thisItem = outline.back();
-    if (thisItem->token != nullptr && thisItem->lno == lno) {
-      thisItem->token->append(itemLabel);
-    }
+    outline.insert(outline.begin() + static_cast<std::ptrdiff_t>(insertItem),
+                   OutlineItem(lno, sx, curLevel, region, textParts.size()));
+    lastItem = insertItem;
   }
   lineIsEmpty = false;
+  // the following regions of line continue text of the item, its parts are the last ones
+  if (lastItem >= outline.size()) {
+    return;
+  }
+  OutlineItem& item = outline[lastItem];
+  if (item.lno == lno && item.textOffset + item.textCount == textParts.size()) {
+    textParts.push_back({sx, ex});
+    item.textCount++;
+    liveParts++;
+  }
 }
 
 void Outliner::enterScheme(size_t /*lno*/, UnicodeString* /*line*/, int /*sx*/, int /*ex*/, const Region* /*region*/,
@@ -10,6 +10,8 @@
  * Used to create, store and maintain list or tree of different special regions.
  * These can include functions, methods, fields, classes, errors and so on.
  * Works as a filter on input editor stream.
+ * Items are kept in the order of lines. Each parse of a line replaces
+ * items of this line in place, so modification costs time of reparsed lines only.
  *
  * @ingroup colorer_editor
  */
@@ -35,6 +37,13 @@ class Outliner : public RegionHandler, public EditorListener
    */
   OutlineItem* getItem(size_t idx);
 
+  /**
+   * Returns text of item with specified ordinal index.
+   * Text is read from the current line of item, so the line
+   * must not be changed after the last parse of it.
+   */
+  UnicodeString getItemText(size_t idx);
+
   /**
    * Static service method to make easy tree reconstruction
    * from created list of outline items. This list contains
@@ -62,16 +71,40 @@ class Outliner : public RegionHandler, public EditorListener
   void enterScheme(size_t lno, UnicodeString* line, int sx, int ex, const Region* region, const Scheme* scheme) override;
   void leaveScheme(size_t lno, UnicodeString* line, int sx, int ex, const Region* region, const Scheme* scheme) override;
   void modifyEvent(size_t topLine) override;
+  bool modifyLineEvent(size_t line) override;
 
  protected:
   bool isOutlined(const Region* region) const;
 
+  /** Part of item text in the line */
+  struct TextPart
+  {
+    int start;
+    int end;
+  };
+
   BaseEditor* baseEditor;
   const Region* searchRegion;
-  std::vector<OutlineItem*> outline;
+  std::vector<OutlineItem> outline;
+  // parts of text of all items, parts of each item follow each other
+  std::vector<TextPart> textParts;
+  // number of parts, used by items
+  size_t liveParts = 0;
   bool lineIsEmpty = false;
   int curLevel = 0;
-  size_t modifiedLine = 0;
+
+ private:
+  static constexpr size_t NO_LINE = static_cast<size_t>(-1);
+  // position of item of the parsed line
+  size_t insertItem = 0;
+  // index of the last added item
+  size_t lastItem = NO_LINE;
+
+  /** Removes items from @c first to @c last (exclusive), returns @c first */
+  size_t eraseItems(size_t first, size_t last);
+  /** Removes items of lines from @c firstLine to @c lastLine, returns index of the first removed item */
+  size_t eraseLines(size_t firstLine, size_t lastLine);
+  void repackText();
 };
 
 #endif
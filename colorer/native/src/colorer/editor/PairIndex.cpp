@@ -0,0 +1,176 @@
+#include "colorer/editor/PairIndex.h"
+#include <algorithm>
+
+namespace {
+
+bool tokenBeforeLine(const PairIndex::PairToken& token, size_t lno)
+{
+  return token.lno < lno;
+}
+
+bool lineBeforeToken(size_t lno, const PairIndex::PairToken& token)
+{
+  return lno < token.lno;
+}
+
+}  // namespace
+
+PairIndex::PairIndex(const Region* pairStart_, const Region* pairEnd_) : pairStart(pairStart_), pairEnd(pairEnd_) {}
+
+size_t PairIndex::getIndexedLine() const
+{
+  return indexedLine;
+}
+
+size_t PairIndex::findToken(size_t lno, int pos) const
+{
+  auto first = std::lower_bound(tokens.begin(), tokens.end(), lno, tokenBeforeLine);
+  auto last = std::upper_bound(first, tokens.end(), lno, lineBeforeToken);
+  size_t found = NO_TOKEN;
+  for (auto it = first; it != last; ++it) {
+    if (pos >= it->start && pos <= it->end) {
+      found = static_cast<size_t>(it - tokens.begin());
+    }
+  }
+  return found;
+}
+
+const PairIndex::PairToken& PairIndex::getToken(size_t idx) const
+{
+  return tokens[idx];
+}
+
+void PairIndex::modifyEvent(size_t topLine)
+{
+  truncate(topLine);
+  changedLine = NO_LINE;
+}
+
+void PairIndex::modifyLineEvent(size_t line)
+{
+  if (line < indexedLine) {
+    changedLine = line;
+  }
+  else {
+    truncate(line);
+  }
+}
+
+void PairIndex::truncate(size_t topLine)
+{
+  indexedLine = std::min(indexedLine, topLine);
+  if (currentLine != NO_LINE && currentLine >= topLine && currentLine != changedLine) {
+    currentLine = NO_LINE;
+  }
+  auto size = static_cast<size_t>(std::lower_bound(tokens.begin(), tokens.end(), topLine, tokenBeforeLine) -
+                                  tokens.begin());
+  if (size == tokens.size()) {
+    return;
+  }
+  // starts, closed by dropped tokens, are open again, they follow all starts, which are still open
+  while (!openStarts.empty() && openStarts.back() >= size) {
+    openStarts.pop_back();
+  }
+  size_t open_count = openStarts.size();
+  for (size_t i = size; i < tokens.size(); i++) {
+    size_t pair = tokens[i].pair;
+    if (pair != NO_TOKEN && pair < size) {
+      tokens[pair].pair = NO_TOKEN;
+      openStarts.push_back(pair);
+    }
+  }
+  std::sort(openStarts.begin() + static_cast<std::ptrdiff_t>(open_count), openStarts.end());
+  tokens.resize(size);
+}
+
+void PairIndex::replaceLine()
+{
+  auto first = std::lower_bound(tokens.begin(), tokens.end(), changedLine, tokenBeforeLine);
+  auto last = std::upper_bound(first, tokens.end(), changedLine, lineBeforeToken);
+  // the same sequence of starts and ends is paired in the same way
+  bool same = static_cast<size_t>(last - first) == changedTokens.size() &&
+      std::equal(first, last, changedTokens.begin(),
+                 [](const PairToken& t1, const PairToken& t2) { return t1.pairStart == t2.pairStart; });
+  if (!same) {
+    truncate(changedLine);
+    return;
+  }
+  for (const auto& token : changedTokens) {
+    first->start = token.start;
+    first->end = token.end;
+    first->region = token.region;
+    ++first;
+  }
+}
+
+void PairIndex::startParsing(size_t /*lno*/)
+{
+  currentLine = NO_LINE;
+}
+
+void PairIndex::endParsing(size_t /*lno*/)
+{
+  if (currentLine != NO_LINE) {
+    if (currentLine == changedLine) {
+      replaceLine();
+    }
+    else {
+      indexedLine = currentLine + 1;
+    }
+  }
+  currentLine = NO_LINE;
+  changedLine = NO_LINE;
+}
+
+void PairIndex::clearLine(size_t lno, UnicodeString* /*line*/)
+{
+  if (currentLine != NO_LINE && currentLine != changedLine) {
+    indexedLine = currentLine + 1;
+  }
+  currentLine = NO_LINE;
+  if (lno == changedLine) {
+    changedTokens.clear();
+    currentLine = lno;
+  }
+  else if (lno == indexedLine) {
+    // tokens of not completed line
+    truncate(lno);
+    currentLine = lno;
+  }
+}
+
+void PairIndex::addRegion(size_t lno, UnicodeString* /*line*/, int sx, int ex, const Region* region)
+{
+  if (lno != currentLine || region == nullptr) {
+    return;
+  }
+  bool is_start = region->hasParent(pairStart);
+  if (!is_start && !region->hasParent(pairEnd)) {
+    return;
+  }
+  PairToken token {lno, sx, ex, region, is_start, NO_TOKEN};
+  if (lno == changedLine) {
+    changedTokens.push_back(token);
+    return;
+  }
+  size_t idx = tokens.size();
+  if (is_start) {
+    openStarts.push_back(idx);
+  }
+  else if (!openStarts.empty()) {
+    token.pair = openStarts.back();
+    tokens[token.pair].pair = idx;
+    openStarts.pop_back();
+  }
+  tokens.push_back(token);
+}
+
+void PairIndex::enterScheme(size_t /*lno*/, UnicodeString* /*line*/, int /*sx*/, int /*ex*/, const Region* /*region*/,
+                            const Scheme* /*scheme*/)
+{
+}
+
+void PairIndex::leaveScheme(size_t /*lno*/, UnicodeString* /*line*/, int /*sx*/, int /*ex*/, const Region* /*region*/,
+                            const Scheme* /*scheme*/)
+{
+}
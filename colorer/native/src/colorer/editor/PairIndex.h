@@ -0,0 +1,89 @@
+#ifndef COLORER_PAIRINDEX_H
+#define COLORER_PAIRINDEX_H
+
+#include <vector>
+#include "colorer/RegionHandler.h"
+
+/**
+ * Index of paired regions of the whole text.
+ * Collects PairStart and PairEnd regions of lines, parsed in sequence
+ * from the start of the text, and links each start region with its end
+ * by the stack of not closed starts. Pair of indexed region is found without
+ * parsing of the text between them.
+ * Lines are indexed by any parse, which passes the first not indexed line,
+ * index is truncated by modification of the text.
+ * @ingroup colorer_editor
+ */
+class PairIndex : public RegionHandler
+{
+ public:
+  static constexpr size_t NO_TOKEN = static_cast<size_t>(-1);
+
+  /** Paired region in the text. */
+  struct PairToken
+  {
+    size_t lno;
+    int start;
+    int end;
+    const Region* region;
+    bool pairStart;
+    /** Index of paired token, NO_TOKEN if pair is not found in indexed lines */
+    size_t pair;
+  };
+
+  PairIndex(const Region* pairStart, const Region* pairEnd);
+
+  /**
+   * Returns the number of lines from the start of the text, which regions are indexed.
+   */
+  [[nodiscard]] size_t getIndexedLine() const;
+
+  /**
+   * Returns index of the last token of line @c lno, which includes position @c pos
+   * or ends directly at it, NO_TOKEN if there is no such token.
+   */
+  [[nodiscard]] size_t findToken(size_t lno, int pos) const;
+
+  [[nodiscard]] const PairToken& getToken(size_t idx) const;
+
+  /**
+   * Drops tokens of lines from @c topLine.
+   */
+  void modifyEvent(size_t topLine);
+
+  /**
+   * Tokens of line @c line are replaced by the next parse of this line.
+   * If they are paired in other way, than old ones, index is truncated from this line.
+   */
+  void modifyLineEvent(size_t line);
+
+  void startParsing(size_t lno) override;
+  void endParsing(size_t lno) override;
+  void clearLine(size_t lno, UnicodeString* line) override;
+  void addRegion(size_t lno, UnicodeString* line, int sx, int ex, const Region* region) override;
+  void enterScheme(size_t lno, UnicodeString* line, int sx, int ex, const Region* region, const Scheme* scheme) override;
+  void leaveScheme(size_t lno, UnicodeString* line, int sx, int ex, const Region* region, const Scheme* scheme) override;
+
+ private:
+  static constexpr size_t NO_LINE = static_cast<size_t>(-1);
+
+  const Region* pairStart;
+  const Region* pairEnd;
+
+  std::vector<PairToken> tokens;
+  // starts without pair, in the order of text
+  std::vector<size_t> openStarts;
+  // lines before this one are indexed
+  size_t indexedLine = 0;
+  // line, which tokens are collected now
+  size_t currentLine = NO_LINE;
+
+  // line, changed by modifyLineEvent, and its new tokens
+  size_t changedLine = NO_LINE;
+  std::vector<PairToken> changedTokens;
+
+  void truncate(size_t topLine);
+  void replaceLine();
+};
+
+#endif  // COLORER_PAIRINDEX_H
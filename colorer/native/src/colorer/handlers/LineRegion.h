@@ -23,6 +23,8 @@ class LineRegion
       This reference can contain concrete information about region
       extended properties.
       Can be null, if no region mapping were defined.
+      Regions of LineRegionsSupport share defines, owned by the handler,
+      copy of region owns the clone of define.
   */
   RegionDefine* rdef;
 
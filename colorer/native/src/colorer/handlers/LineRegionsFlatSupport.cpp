@@ -0,0 +1,464 @@
+#include "colorer/handlers/LineRegionsFlatSupport.h"
+#include <algorithm>
+#include <utility>
+
+// buffer is repacked, if it has more than this number of replaced regions
+static const size_t REPACK_MIN_GARBAGE = 4096;
+
+void FlatRegionArrays::clear()
+{
+  start.clear();
+  end.clear();
+  region.clear();
+  scheme.clear();
+  rdef.clear();
+  flags.clear();
+}
+
+void FlatRegionArrays::reserve(size_t count)
+{
+  start.reserve(count);
+  end.reserve(count);
+  region.reserve(count);
+  scheme.reserve(count);
+  rdef.reserve(count);
+  flags.reserve(count);
+}
+
+void FlatRegionArrays::push_back(int start_, int end_, const Region* region_, const Scheme* scheme_, int rdef_,
+                                 uint8_t flags_)
+{
+  start.push_back(start_);
+  end.push_back(end_);
+  region.push_back(region_);
+  scheme.push_back(scheme_);
+  rdef.push_back(rdef_);
+  flags.push_back(flags_);
+}
+
+void FlatRegionArrays::append(const FlatRegionArrays& src, size_t from, size_t count)
+{
+  start.insert(start.end(), src.start.begin() + from, src.start.begin() + from + count);
+  end.insert(end.end(), src.end.begin() + from, src.end.begin() + from + count);
+  region.insert(region.end(), src.region.begin() + from, src.region.begin() + from + count);
+  scheme.insert(scheme.end(), src.scheme.begin() + from, src.scheme.begin() + from + count);
+  rdef.insert(rdef.end(), src.rdef.begin() + from, src.rdef.begin() + from + count);
+  flags.insert(flags.end(), src.flags.begin() + from, src.flags.begin() + from + count);
+}
+
+LineRegionsFlatSupport::LineRegionsFlatSupport(bool compact_) : compact(compact_) {}
+
+void LineRegionsFlatSupport::resize(size_t lineCount_)
+{
+  flushLine();
+  for (size_t i = lineCount_; i < lineSpans.size(); i++) {
+    liveRegions -= lineSpans[i].count;
+    unuseLine(i);
+  }
+  lineSpans.resize(lineCount_);
+  usePrev.resize(lineCount_, NO_LINE);
+  useNext.resize(lineCount_, NO_LINE);
+  lineCount = lineCount_;
+}
+
+size_t LineRegionsFlatSupport::size() const
+{
+  return lineCount;
+}
+
+void LineRegionsFlatSupport::clear()
+{
+  currentLine = NO_LINE;
+  current.clear();
+  flowBackground = -1;
+  regions.clear();
+  for (auto& span : lineSpans) {
+    span = LineSpan();
+  }
+  liveRegions = 0;
+  std::fill(usePrev.begin(), usePrev.end(), NO_LINE);
+  std::fill(useNext.begin(), useNext.end(), NO_LINE);
+  useFirst = useLast = NO_LINE;
+}
+
+void LineRegionsFlatSupport::setRegionLimit(size_t maxRegions)
+{
+  flushLine();
+  bool was_limited = regionLimit != 0;
+  regionLimit = maxRegions;
+  if (regionLimit == 0) {
+    std::fill(usePrev.begin(), usePrev.end(), NO_LINE);
+    std::fill(useNext.begin(), useNext.end(), NO_LINE);
+    useFirst = useLast = NO_LINE;
+    return;
+  }
+  if (!was_limited) {
+    // lines, stored without limit, are used in the order of lines
+    for (size_t i = 0; i < lineSpans.size(); i++) {
+      if (lineSpans[i].count != 0) {
+        useLine(i);
+      }
+    }
+  }
+  dropUnused(NO_LINE);
+}
+
+void LineRegionsFlatSupport::setFirstLine(size_t first)
+{
+  flushLine();
+  firstLineNo = first;
+}
+
+size_t LineRegionsFlatSupport::getFirstLine() const
+{
+  return firstLineNo;
+}
+
+void LineRegionsFlatSupport::setBackground(const RegionDefine* back)
+{
+  background = back;
+  definesIndex.clear();
+}
+
+void LineRegionsFlatSupport::setSpecialRegion(const Region* _special)
+{
+  special = _special;
+}
+
+void LineRegionsFlatSupport::setRegionMapper(const RegionMapper* rs)
+{
+  regionMapper = rs;
+  // already stored regions keep their defines, new ones are resolved again
+  definesIndex.clear();
+}
+
+FlatLineRegions LineRegionsFlatSupport::getLineRegions(size_t lno) const
+{
+  if (!checkLine(lno)) {
+    return FlatLineRegions();
+  }
+  if (lno == currentLine) {
+    return FlatLineRegions(this, &current, 0, current.size());
+  }
+  size_t idx = getLineIndex(lno);
+  const LineSpan& span = lineSpans[idx];
+  if (span.count != 0) {
+    useLine(idx);
+  }
+  return FlatLineRegions(this, &regions, span.offset, span.count);
+}
+
+bool LineRegionsFlatSupport::hasLine(size_t lno) const
+{
+  return checkLine(lno) && (lno == currentLine || lineSpans[getLineIndex(lno)].count != 0);
+}
+
+const RegionDefine* LineRegionsFlatSupport::getRegionDefine(int idx) const
+{
+  if (idx < 0) {
+    return nullptr;
+  }
+  return defines[idx].get();
+}
+
+size_t LineRegionsFlatSupport::getLineIndex(size_t lno) const
+{
+  return ((firstLineNo % lineCount) + lno - firstLineNo) % lineCount;
+}
+
+bool LineRegionsFlatSupport::checkLine(size_t lno) const
+{
+  if (lno < firstLineNo || lno >= firstLineNo + lineCount) {
+    COLORER_LOG_TRACE("[LineRegionsFlatSupport] checkLine: line % out of range", lno);
+    return false;
+  }
+  return true;
+}
+
+void LineRegionsFlatSupport::openLine(size_t lno)
+{
+  if (lno == currentLine) {
+    return;
+  }
+  flushLine();
+  currentLine = lno;
+  const LineSpan& span = lineSpans[getLineIndex(lno)];
+  current.clear();
+  current.append(regions, span.offset, span.count);
+  flowBackground = -1;
+}
+
+void LineRegionsFlatSupport::flushLine()
+{
+  if (currentLine == NO_LINE) {
+    return;
+  }
+  size_t lno = currentLine;
+  currentLine = NO_LINE;
+  if (!checkLine(lno)) {
+    return;
+  }
+  size_t idx = getLineIndex(lno);
+  LineSpan& span = lineSpans[idx];
+  liveRegions -= span.count;
+  span.offset = regions.size();
+  span.count = current.size();
+  regions.append(current, 0, current.size());
+  liveRegions += span.count;
+  useLine(idx);
+  dropUnused(idx);
+  if (regions.size() - liveRegions > REPACK_MIN_GARBAGE && regions.size() > 2 * liveRegions) {
+    repack();
+  }
+}
+
+void LineRegionsFlatSupport::repack()
+{
+  FlatRegionArrays packed;
+  packed.reserve(liveRegions);
+  for (auto& span : lineSpans) {
+    size_t offset = packed.size();
+    packed.append(regions, span.offset, span.count);
+    span.offset = offset;
+  }
+  regions = std::move(packed);
+}
+
+void LineRegionsFlatSupport::useLine(size_t idx) const
+{
+  if (regionLimit == 0 || idx == useLast) {
+    return;
+  }
+  unuseLine(idx);
+  usePrev[idx] = useLast;
+  if (useLast != NO_LINE) {
+    useNext[useLast] = idx;
+  }
+  else {
+    useFirst = idx;
+  }
+  useLast = idx;
+}
+
+void LineRegionsFlatSupport::unuseLine(size_t idx) const
+{
+  if (usePrev[idx] == NO_LINE && useFirst != idx) {
+    return;
+  }
+  if (usePrev[idx] != NO_LINE) {
+    useNext[usePrev[idx]] = useNext[idx];
+  }
+  else {
+    useFirst = useNext[idx];
+  }
+  if (useNext[idx] != NO_LINE) {
+    usePrev[useNext[idx]] = usePrev[idx];
+  }
+  else {
+    useLast = usePrev[idx];
+  }
+  usePrev[idx] = useNext[idx] = NO_LINE;
+}
+
+void LineRegionsFlatSupport::dropUnused(size_t keep)
+{
+  if (regionLimit == 0) {
+    return;
+  }
+  // regions of dropped lines stay in the buffer until repack
+  while (liveRegions > regionLimit && useFirst != NO_LINE && useFirst != keep) {
+    size_t idx = useFirst;
+    unuseLine(idx);
+    liveRegions -= lineSpans[idx].count;
+    lineSpans[idx] = LineSpan();
+  }
+}
+
+int LineRegionsFlatSupport::resolveDefine(const RegionDefine* rd, int parent)
+{
+  auto key = std::make_pair(rd, parent);
+  auto it = definesIndex.find(key);
+  if (it != definesIndex.end()) {
+    return it->second;
+  }
+  std::unique_ptr<RegionDefine> resolved(rd->clone());
+  resolved->assignParent(getRegionDefine(parent));
+  defines.push_back(std::move(resolved));
+  int idx = static_cast<int>(defines.size()) - 1;
+  definesIndex.emplace(key, idx);
+  return idx;
+}
+
+int LineRegionsFlatSupport::mapRegion(const Region* region)
+{
+  if (regionMapper == nullptr) {
+    return -1;
+  }
+  int parent = schemeStack.back().rdef;
+  const RegionDefine* rd = regionMapper->getRegionDefine(region);
+  if (rd == nullptr) {
+    rd = getRegionDefine(parent);
+  }
+  if (rd == nullptr) {
+    return -1;
+  }
+  return resolveDefine(rd, parent);
+}
+
+void LineRegionsFlatSupport::startParsing(size_t /*lno*/)
+{
+  flushLine();
+  schemeStack.clear();
+  schemeStack.push_back({nullptr, nullptr, background != nullptr ? resolveDefine(background, -1) : -1});
+}
+
+void LineRegionsFlatSupport::endParsing(size_t /*lno*/)
+{
+  flushLine();
+}
+
+void LineRegionsFlatSupport::clearLine(size_t lno, UnicodeString* /*line*/)
+{
+  if (!checkLine(lno)) {
+    return;
+  }
+  flushLine();
+  currentLine = lno;
+  current.clear();
+  const SchemeEntry& top = schemeStack.back();
+  current.push_back(0, -1, top.region, top.scheme, top.rdef, 0);
+  flowBackground = 0;
+}
+
+void LineRegionsFlatSupport::addRegion(size_t lno, UnicodeString* /*line*/, int sx, int ex, const Region* region)
+{
+  // ignoring out of cached interval lines
+  if (!checkLine(lno)) {
+    return;
+  }
+  openLine(lno);
+  uint8_t flags = region->hasParent(special) ? FlatRegionArrays::SPECIAL : 0;
+  addLineRegion(sx, ex, region, schemeStack.back().scheme, mapRegion(region), flags);
+}
+
+void LineRegionsFlatSupport::enterScheme(size_t lno, UnicodeString* /*line*/, int sx, int /*ex*/, const Region* region,
+                                         const Scheme* scheme)
+{
+  schemeStack.push_back({region, scheme, mapRegion(region)});
+  // ignoring out of cached interval lines and transparent regions
+  if (!checkLine(lno) || region == nullptr) {
+    return;
+  }
+  openLine(lno);
+  if (flowBackground != -1) {
+    current.end[flowBackground] = sx;
+  }
+  flowBackground = addLineRegion(sx, -1, region, scheme, schemeStack.back().rdef, 0);
+}
+
+void LineRegionsFlatSupport::leaveScheme(size_t lno, UnicodeString* /*line*/, int /*sx*/, int ex,
+                                         const Region* /*region*/, const Scheme* /*scheme*/)
+{
+  const Region* scheme_region = schemeStack.back().region;
+  schemeStack.pop_back();
+  // ignoring out of cached interval lines and transparent regions
+  if (!checkLine(lno) || scheme_region == nullptr) {
+    return;
+  }
+  openLine(lno);
+  if (flowBackground != -1) {
+    current.end[flowBackground] = ex;
+  }
+  const SchemeEntry& top = schemeStack.back();
+  flowBackground = addLineRegion(ex, -1, top.region, top.scheme, top.rdef, 0);
+}
+
+int LineRegionsFlatSupport::addLineRegion(int start, int end, const Region* region, const Scheme* scheme, int rdef,
+                                          uint8_t flags)
+{
+  if (compact && !(flags & FlatRegionArrays::SPECIAL)) {
+    return mergeLineRegion(start, end, region, scheme, rdef);
+  }
+  current.push_back(start, end, region, scheme, rdef, flags);
+  return static_cast<int>(current.size()) - 1;
+}
+
+/*
+  Regions of line in compact mode are sorted by start and do not overlap,
+  special regions are kept after them in the order of adding.
+  New region is merged with them in one pass: previous region is cut
+  at the start of new region, following regions are cut at the end of it
+  or removed, if new region covers them.
+*/
+int LineRegionsFlatSupport::mergeLineRegion(int start, int end, const Region* region, const Scheme* scheme, int rdef)
+{
+  size_t count = current.size();
+  size_t specials = count;
+  while (specials > 0 && (current.flags[specials - 1] & FlatRegionArrays::SPECIAL)) {
+    specials--;
+  }
+  size_t pos = 0;
+  while (pos < specials && current.start[pos] < start) {
+    pos++;
+  }
+
+  merged.clear();
+  merged.reserve(count + 2);
+  int flow = -1;
+  auto keep = [&](size_t idx) {
+    if (static_cast<int>(idx) == flowBackground) {
+      flow = static_cast<int>(merged.size());
+    }
+    merged.push_back(current.start[idx], current.end[idx], current.region[idx], current.scheme[idx],
+                     current.rdef[idx], current.flags[idx]);
+  };
+
+  for (size_t i = 0; i + 1 < pos; i++) {
+    keep(i);
+  }
+  bool split = false;
+  size_t prev = pos - 1;
+  int prev_end = 0;
+  if (pos > 0) {
+    prev_end = current.end[prev];
+    if (prev_end > start || prev_end == -1) {
+      // our region breaks previous region into two parts
+      split = (prev_end > end || prev_end == -1) && end != -1;
+      // zero-width region is removed
+      if (current.start[prev] != start) {
+        keep(prev);
+        merged.end.back() = start;
+      }
+    }
+    else {
+      keep(prev);
+    }
+  }
+  int added = static_cast<int>(merged.size());
+  merged.push_back(start, end, region, scheme, rdef, 0);
+  if (split) {
+    if (static_cast<int>(prev) == flowBackground) {
+      flow = static_cast<int>(merged.size());
+    }
+    merged.push_back(end, prev_end, current.region[prev], current.scheme[prev], current.rdef[prev],
+                     current.flags[prev]);
+  }
+  // region up to the end of line hides all following regions
+  if (end != -1) {
+    for (size_t i = pos; i < specials; i++) {
+      if (current.end[i] != -1 && current.end[i] <= end) {
+        continue;
+      }
+      keep(i);
+      if (current.start[i] < end) {
+        merged.start.back() = end;
+      }
+    }
+  }
+  for (size_t i = specials; i < count; i++) {
+    keep(i);
+  }
+  std::swap(current, merged);
+  flowBackground = flow;
+  return added;
+}
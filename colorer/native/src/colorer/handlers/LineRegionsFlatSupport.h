@@ -0,0 +1,325 @@
+#ifndef COLORER_LINEREGIONSFLATSUPPORT_H
+#define COLORER_LINEREGIONSFLATSUPPORT_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+#include "colorer/RegionHandler.h"
+#include "colorer/handlers/RegionDefine.h"
+#include "colorer/handlers/RegionMapper.h"
+#include "colorer/handlers/StyledRegion.h"
+#include "colorer/handlers/TextRegion.h"
+
+class LineRegionsFlatSupport;
+
+/** Regions of lines, stored as structure of arrays.
+    @ingroup colorer_handlers
+*/
+struct FlatRegionArrays
+{
+  static constexpr uint8_t SPECIAL = 1;
+
+  std::vector<int> start;
+  std::vector<int> end;
+  std::vector<const Region*> region;
+  std::vector<const Scheme*> scheme;
+  // index of region define in handler, -1 if region is not mapped
+  std::vector<int> rdef;
+  std::vector<uint8_t> flags;
+
+  [[nodiscard]] size_t size() const
+  {
+    return start.size();
+  }
+
+  void clear();
+  void reserve(size_t count);
+  void push_back(int start, int end, const Region* region, const Scheme* scheme, int rdef, uint8_t flags);
+  void append(const FlatRegionArrays& src, size_t from, size_t count);
+};
+
+/** Region of line in LineRegionsFlatSupport.
+    Has the same meaning of fields as LineRegion, end is -1 for
+    regions up to the end of line.
+    @ingroup colorer_handlers
+*/
+class FlatRegion
+{
+ public:
+  FlatRegion(const LineRegionsFlatSupport* store_, const FlatRegionArrays* arrays_, size_t idx_)
+      : store(store_), arrays(arrays_), idx(idx_)
+  {
+  }
+
+  [[nodiscard]] int start() const
+  {
+    return arrays->start[idx];
+  }
+  [[nodiscard]] int end() const
+  {
+    return arrays->end[idx];
+  }
+  [[nodiscard]] const Region* region() const
+  {
+    return arrays->region[idx];
+  }
+  [[nodiscard]] const Scheme* scheme() const
+  {
+    return arrays->scheme[idx];
+  }
+  [[nodiscard]] bool special() const
+  {
+    return (arrays->flags[idx] & FlatRegionArrays::SPECIAL) != 0;
+  }
+  [[nodiscard]] const RegionDefine* rdef() const;
+
+  [[nodiscard]] const StyledRegion* styled() const
+  {
+    return StyledRegion::cast(rdef());
+  }
+  [[nodiscard]] const TextRegion* texted() const
+  {
+    return TextRegion::cast(rdef());
+  }
+
+ private:
+  const LineRegionsFlatSupport* store;
+  const FlatRegionArrays* arrays;
+  size_t idx;
+};
+
+/** Range of regions of one line in LineRegionsFlatSupport.
+    Range is valid until the next parse of the text.
+    @ingroup colorer_handlers
+*/
+class FlatLineRegions
+{
+ public:
+  class iterator
+  {
+   public:
+    iterator(const LineRegionsFlatSupport* store_, const FlatRegionArrays* arrays_, size_t idx_)
+        : store(store_), arrays(arrays_), idx(idx_)
+    {
+    }
+
+    FlatRegion operator*() const
+    {
+      return FlatRegion(store, arrays, idx);
+    }
+    iterator& operator++()
+    {
+      idx++;
+      return *this;
+    }
+    bool operator==(const iterator& it) const
+    {
+      return idx == it.idx;
+    }
+    bool operator!=(const iterator& it) const
+    {
+      return idx != it.idx;
+    }
+
+   private:
+    const LineRegionsFlatSupport* store;
+    const FlatRegionArrays* arrays;
+    size_t idx;
+  };
+
+  FlatLineRegions() = default;
+  FlatLineRegions(const LineRegionsFlatSupport* store_, const FlatRegionArrays* arrays_, size_t offset_,
+                  size_t count_)
+      : store(store_), arrays(arrays_), offset(offset_), count(count_)
+  {
+  }
+
+  [[nodiscard]] size_t size() const
+  {
+    return count;
+  }
+  [[nodiscard]] bool empty() const
+  {
+    return count == 0;
+  }
+  FlatRegion operator[](size_t idx) const
+  {
+    return FlatRegion(store, arrays, offset + idx);
+  }
+  [[nodiscard]] iterator begin() const
+  {
+    return iterator(store, arrays, offset);
+  }
+  [[nodiscard]] iterator end() const
+  {
+    return iterator(store, arrays, offset + count);
+  }
+
+ private:
+  const LineRegionsFlatSupport* store = nullptr;
+  const FlatRegionArrays* arrays = nullptr;
+  size_t offset = 0;
+  size_t count = 0;
+};
+
+/** Region store implementation of RegionHandler with regions of all lines
+    in one contiguous buffer.
+    Regions of the line are collected in the separate arrays while line is parsed,
+    and are appended to the buffer, when parser goes to the next line.
+    Buffer is repacked, when it has more replaced regions, than actual.
+    Region defines are resolved once for each pair of region define and
+    parent define and are referenced by index.
+    In compact mode regions in line are laid out without overlaps
+    in the same way, as LineRegionsCompactSupport does.
+    Number of stored regions can be limited, then regions of the least
+    recently used lines are dropped.
+    @ingroup colorer_handlers
+*/
+class LineRegionsFlatSupport : public RegionHandler
+{
+ public:
+  explicit LineRegionsFlatSupport(bool compact = true);
+  ~LineRegionsFlatSupport() override = default;
+
+  /**
+   * Resize structures to maintain regions for @c lineCount lines.
+   */
+  void resize(size_t lineCount);
+
+  /**
+   * Return current size of this line regions structure
+   */
+  [[nodiscard]] size_t size() const;
+
+  /**
+   * Drops all stored regions
+   */
+  void clear();
+
+  /**
+   * Limits the number of stored regions. Lines, which were stored or read
+   * least recently, are dropped, while regions are over the limit.
+   * @param maxRegions Maximum number of regions, 0 - no limit.
+   */
+  void setRegionLimit(size_t maxRegions);
+
+  /**
+   * Sets start line position of line structures.
+   */
+  void setFirstLine(size_t first);
+
+  /**
+   * Returns first line position, installed in this line structures.
+   */
+  [[nodiscard]] size_t getFirstLine() const;
+
+  /**
+   * Background region define, which is used to
+   * fill transparent regions.
+   */
+  void setBackground(const RegionDefine* back);
+
+  /**
+   * Tells handler to mark with special flag
+   * all Regions with specified ancestor.
+   */
+  void setSpecialRegion(const Region* special);
+
+  /**
+   * Choose the source of RegionDefine definitions.
+   * Must be called again, if definitions in the mapper were changed.
+   */
+  void setRegionMapper(const RegionMapper* rds);
+
+  /**
+   * Returns regions of @c lno line, or empty range, if line is out of stored lines.
+   */
+  [[nodiscard]] FlatLineRegions getLineRegions(size_t lno) const;
+
+  /**
+   * Returns true, if regions of @c lno line are stored.
+   */
+  [[nodiscard]] bool hasLine(size_t lno) const;
+
+  /**
+   * Returns region define by its index in regions arrays.
+   */
+  [[nodiscard]] const RegionDefine* getRegionDefine(int idx) const;
+
+  /**
+   * RegionHandler implementation
+   */
+  void startParsing(size_t lno) override;
+  void endParsing(size_t lno) override;
+  void clearLine(size_t lno, UnicodeString* line) override;
+  void addRegion(size_t lno, UnicodeString* line, int sx, int ex, const Region* region) override;
+  void enterScheme(size_t lno, UnicodeString* line, int sx, int ex, const Region* region, const Scheme* scheme) override;
+  void leaveScheme(size_t lno, UnicodeString* line, int sx, int ex, const Region* region, const Scheme* scheme) override;
+
+ private:
+  struct LineSpan
+  {
+    size_t offset = 0;
+    size_t count = 0;
+  };
+
+  struct SchemeEntry
+  {
+    const Region* region;
+    const Scheme* scheme;
+    int rdef;
+  };
+
+  static constexpr size_t NO_LINE = static_cast<size_t>(-1);
+
+  bool compact;
+  const RegionMapper* regionMapper = nullptr;
+  const Region* special = nullptr;
+  const RegionDefine* background = nullptr;
+  size_t firstLineNo = 0;
+  size_t lineCount = 0;
+
+  FlatRegionArrays regions;
+  std::vector<LineSpan> lineSpans;
+  size_t liveRegions = 0;
+
+  size_t regionLimit = 0;
+  // indexes of stored lines in the order of use, from the least recently used one
+  mutable std::vector<size_t> usePrev;
+  mutable std::vector<size_t> useNext;
+  mutable size_t useFirst = NO_LINE;
+  mutable size_t useLast = NO_LINE;
+
+  // line, which is filled now
+  size_t currentLine = NO_LINE;
+  FlatRegionArrays current;
+  FlatRegionArrays merged;
+  // index of region in current line, which end is set by the next scheme change
+  int flowBackground = -1;
+
+  std::vector<SchemeEntry> schemeStack;
+
+  std::vector<std::unique_ptr<RegionDefine>> defines;
+  std::map<std::pair<const RegionDefine*, int>, int> definesIndex;
+
+  [[nodiscard]] size_t getLineIndex(size_t lno) const;
+  [[nodiscard]] bool checkLine(size_t lno) const;
+  void openLine(size_t lno);
+  void flushLine();
+  void repack();
+  void useLine(size_t idx) const;
+  void unuseLine(size_t idx) const;
+  void dropUnused(size_t keep);
+  int mapRegion(const Region* region);
+  int resolveDefine(const RegionDefine* rd, int parent);
+  int addLineRegion(int start, int end, const Region* region, const Scheme* scheme, int rdef, uint8_t flags);
+  int mergeLineRegion(int start, int end, const Region* region, const Scheme* scheme, int rdef);
+};
+
+inline const RegionDefine* FlatRegion::rdef() const
+{
+  return store->getRegionDefine(arrays->rdef[idx]);
+}
+
+#endif  // COLORER_LINEREGIONSFLATSUPPORT_H
@@ -1,5 +1,8 @@
 #include "colorer/handlers/LineRegionsSupport.h"
 
+// number of LineRegion objects, allocated at once
+static const int REGION_SLAB_SIZE = 256;
+
 LineRegionsSupport::LineRegionsSupport()
 {
   lineCount = 0;
@@ -13,9 +16,16 @@ LineRegionsSupport::~LineRegionsSupport()
 {
   clear();
   for (size_t i = 1; i < schemeStack.size(); i++) {
-    delete schemeStack[i];
+    deleteRegion(schemeStack[i]);
   }
   schemeStack.clear();
+  // defines are owned by this handler, not by regions
+  for (auto& slab : regionSlabs) {
+    for (int i = 0; i < REGION_SLAB_SIZE; i++) {
+      slab[i].rdef = nullptr;
+    }
+  }
+  background.rdef = nullptr;
 }
 
 void LineRegionsSupport::resize(size_t lineCount_)
@@ -32,14 +42,83 @@ size_t LineRegionsSupport::size() const
 void LineRegionsSupport::clear()
 {
   for (auto& lineRegion : lineRegions) {
-    LineRegion* ln = lineRegion;
+    deleteRegions(lineRegion);
     lineRegion = nullptr;
-    while (ln != nullptr) {
-      LineRegion* lnn = ln->next;
-      delete ln;
-      ln = lnn;
+  }
+}
+
+LineRegion* LineRegionsSupport::newRegion()
+{
+  if (freeRegions == nullptr) {
+    regionSlabs.emplace_back(new LineRegion[REGION_SLAB_SIZE]);
+    LineRegion* slab = regionSlabs.back().get();
+    for (int i = 0; i < REGION_SLAB_SIZE; i++) {
+      slab[i].next = freeRegions;
+      freeRegions = &slab[i];
     }
   }
+  LineRegion* lr = freeRegions;
+  freeRegions = lr->next;
+  lr->rdef = nullptr;
+  lr->region = nullptr;
+  lr->scheme = nullptr;
+  lr->start = 0;
+  lr->end = 0;
+  lr->special = false;
+  lr->next = nullptr;
+  lr->prev = nullptr;
+  return lr;
+}
+
+LineRegion* LineRegionsSupport::newRegion(const LineRegion& lr)
+{
+  LineRegion* lnew = newRegion();
+  // unlike LineRegion copy, define is shared
+  lnew->start = lr.start;
+  lnew->end = lr.end;
+  lnew->scheme = lr.scheme;
+  lnew->region = lr.region;
+  lnew->special = lr.special;
+  lnew->rdef = lr.rdef;
+  return lnew;
+}
+
+size_t LineRegionsSupport::getPoolSize() const
+{
+  return regionSlabs.size() * REGION_SLAB_SIZE;
+}
+
+RegionDefine* LineRegionsSupport::resolveDefine(const RegionDefine* rd, const RegionDefine* parent)
+{
+  auto key = std::make_pair(rd, parent);
+  auto it = definesIndex.find(key);
+  if (it != definesIndex.end()) {
+    return it->second;
+  }
+  std::unique_ptr<RegionDefine> resolved(rd->clone());
+  resolved->assignParent(parent);
+  defines.push_back(std::move(resolved));
+  definesIndex.emplace(key, defines.back().get());
+  return defines.back().get();
+}
+
+void LineRegionsSupport::deleteRegion(LineRegion* lr)
+{
+  lr->next = freeRegions;
+  freeRegions = lr;
+}
+
+void LineRegionsSupport::deleteRegions(LineRegion* first)
+{
+  if (first == nullptr) {
+    return;
+  }
+  LineRegion* last = first;
+  while (last->next != nullptr) {
+    last = last->next;
+  }
+  last->next = freeRegions;
+  freeRegions = first;
 }
 
 size_t LineRegionsSupport::getLineIndex(size_t lno) const
@@ -55,6 +134,27 @@ LineRegion* LineRegionsSupport::getLineRegions(size_t lno) const
   return lineRegions.at(getLineIndex(lno));
 }
 
+void LineRegionsSupport::setLineRegions(size_t lno, const FlatLineRegions& regions)
+{
+  if (!checkLine(lno)) {
+    return;
+  }
+  deleteRegions(getLineRegions(lno));
+  lineRegions.at(getLineIndex(lno)) = nullptr;
+  for (auto region : regions) {
+    auto* lr = newRegion();
+    lr->start = region.start();
+    lr->end = region.end();
+    lr->region = region.region();
+    lr->scheme = region.scheme();
+    lr->special = region.special();
+    if (region.rdef() != nullptr) {
+      lr->rdef = resolveDefine(region.rdef(), nullptr);
+    }
+    LineRegionsSupport::addLineRegion(lno, lr);
+  }
+}
+
 void LineRegionsSupport::setFirstLine(size_t first)
 {
   firstLineNo = first;
@@ -78,6 +178,8 @@ void LineRegionsSupport::setSpecialRegion(const Region* _special)
 void LineRegionsSupport::setRegionMapper(const RegionMapper* rs)
 {
   regionMapper = rs;
+  // already stored regions keep their defines, new ones are resolved again
+  definesIndex.clear();
 }
 
 bool LineRegionsSupport::checkLine(size_t lno) const
@@ -92,7 +194,7 @@ bool LineRegionsSupport::checkLine(size_t lno) const
 void LineRegionsSupport::startParsing(size_t /*lno*/)
 {
   for (size_t i = 1; i < schemeStack.size(); i++) {
-    delete schemeStack[i];
+    deleteRegion(schemeStack[i]);
   }
   schemeStack.clear();
   schemeStack.push_back(&background);
@@ -104,13 +206,8 @@ void LineRegionsSupport::clearLine(size_t lno, UnicodeString* /*line*/)
     return;
   }
 
-  LineRegion* ln = getLineRegions(lno);
-  while (ln != nullptr) {
-    LineRegion* lnn = ln->next;
-    delete ln;
-    ln = lnn;
-  }
-  auto* lfirst = new LineRegion(*schemeStack.back());
+  deleteRegions(getLineRegions(lno));
+  auto* lfirst = newRegion(*schemeStack.back());
   lfirst->start = 0;
   lfirst->end = -1;
   lfirst->next = nullptr;
@@ -125,7 +222,7 @@ void LineRegionsSupport::addRegion(size_t line_no, UnicodeString* /*line*/, int
   if (!checkLine(line_no)) {
     return;
   }
-  auto* lnew = new LineRegion();
+  auto* lnew = newRegion();
   lnew->start = start_idx;
   lnew->end = end_idx;
   lnew->region = region;
@@ -139,8 +236,7 @@ void LineRegionsSupport::addRegion(size_t line_no, UnicodeString* /*line*/, int
       rd = schemeStack.back()->rdef;
     }
     if (rd != nullptr) {
-      lnew->rdef = rd->clone();
-      lnew->rdef->assignParent(schemeStack.back()->rdef);
+      lnew->rdef = resolveDefine(rd, schemeStack.back()->rdef);
     }
   }
   addLineRegion(line_no, lnew);
@@ -148,7 +244,7 @@ void LineRegionsSupport::addRegion(size_t line_no, UnicodeString* /*line*/, int
 
 void LineRegionsSupport::enterScheme(size_t line_no, UnicodeString* /*line*/, int start_idx, int /*end_idx*/, const Region* region, const Scheme* scheme)
 {
-  auto* lr = new LineRegion();
+  auto* lr = newRegion();
   lr->region = region;
   lr->scheme = scheme;
   lr->start = start_idx;
@@ -159,8 +255,7 @@ void LineRegionsSupport::enterScheme(size_t line_no, UnicodeString* /*line*/, in
       rd = schemeStack.back()->rdef;
     }
     if (rd != nullptr) {
-      lr->rdef = rd->clone();
-      lr->rdef->assignParent(schemeStack.back()->rdef);
+      lr->rdef = resolveDefine(rd, schemeStack.back()->rdef);
     }
   }
   schemeStack.push_back(lr);
@@ -170,7 +265,7 @@ void LineRegionsSupport::enterScheme(size_t line_no, UnicodeString* /*line*/, in
   }
   // we must skip transparent regions
   if (lr->region != nullptr) {
-    auto* lr_add = new LineRegion(*lr);
+    auto* lr_add = newRegion(*lr);
     flowBackground->end = lr_add->start;
     flowBackground = lr_add;
     addLineRegion(line_no, lr_add);
@@ -180,7 +275,7 @@ void LineRegionsSupport::enterScheme(size_t line_no, UnicodeString* /*line*/, in
 void LineRegionsSupport::leaveScheme(size_t line_no, UnicodeString* /*line*/, int /*start_idx*/, int end_idx, const Region* /*region*/, const Scheme* /*scheme*/)
 {
   const Region* scheme_region = schemeStack.back()->region;
-  delete schemeStack.back();
+  deleteRegion(schemeStack.back());
   schemeStack.pop_back();
   // ignoring out of cached interval lines
   if (!checkLine(line_no)) {
@@ -188,7 +283,7 @@ void LineRegionsSupport::leaveScheme(size_t line_no, UnicodeString* /*line*/, in
   }
   // we have to skip transparent regions
   if (scheme_region != nullptr) {
-    auto* lr = new LineRegion(*schemeStack.back());
+    auto* lr = newRegion(*schemeStack.back());
     lr->start = end_idx;
     lr->end = -1;
     flowBackground->end = lr->start;
@@ -3,8 +3,11 @@
 
 #include "colorer/RegionHandler.h"
 #include "colorer/handlers/LineRegion.h"
+#include "colorer/handlers/LineRegionsFlatSupport.h"
 #include "colorer/handlers/RegionDefine.h"
 #include "colorer/handlers/RegionMapper.h"
+#include <map>
+#include <memory>
 #include <vector>
 
 /** Region store implementation of RegionHandler.
@@ -60,6 +63,7 @@ class LineRegionsSupport : public RegionHandler
    * Choose the source of RegionDefine definitions.
    * This source returns information about mapping
    * Region objects into RegionDefine objects.
+   * Already stored regions keep their defines.
    */
   void setRegionMapper(const RegionMapper* rds);
 
@@ -69,6 +73,19 @@ class LineRegionsSupport : public RegionHandler
    */
   [[nodiscard]] LineRegion* getLineRegions(size_t lno) const;
 
+  /**
+   * Replaces regions of @c lno line by the copies of regions, kept in flat store.
+   * Regions are copied as is, layout of compact store is not applied to them.
+   * Defines of the flat store are found by address, so after the change of
+   * flat store #setRegionMapper must be called again.
+   */
+  void setLineRegions(size_t lno, const FlatLineRegions& regions);
+
+  /**
+   * Returns number of LineRegion objects, allocated by the pool of this handler.
+   */
+  [[nodiscard]] size_t getPoolSize() const;
+
   /**
    * RegionHandler implementation
    */
@@ -86,6 +103,21 @@ class LineRegionsSupport : public RegionHandler
   [[nodiscard]] size_t getLineIndex(size_t lno) const;
   [[nodiscard]] bool checkLine(size_t lno) const;
 
+  /**
+   * LineRegion objects are taken from the pool of this handler
+   * and returned into it, when line is cleared.
+   */
+  LineRegion* newRegion();
+  LineRegion* newRegion(const LineRegion& lr);
+  void deleteRegion(LineRegion* lr);
+  void deleteRegions(LineRegion* first);
+
+  /**
+   * Region define @c rd, completed with values of @c parent.
+   * Each pair is resolved once, regions of this handler share the result.
+   */
+  RegionDefine* resolveDefine(const RegionDefine* rd, const RegionDefine* parent);
+
   std::vector<LineRegion*> lineRegions;
   std::vector<LineRegion*> schemeStack;
 
@@ -96,6 +128,15 @@ class LineRegionsSupport : public RegionHandler
   LineRegion background;
   size_t firstLineNo;
   size_t lineCount;
+
+ private:
+  // storage of LineRegion objects, unused objects are linked by next field
+  std::vector<std::unique_ptr<LineRegion[]>> regionSlabs;
+  LineRegion* freeRegions = nullptr;
+
+  // resolved defines of regions, they live as long as the handler
+  std::vector<std::unique_ptr<RegionDefine>> defines;
+  std::map<std::pair<const RegionDefine*, const RegionDefine*>, RegionDefine*> definesIndex;
 };
 
 #endif // COLORER_LINEREGIONSSUPPORT_H
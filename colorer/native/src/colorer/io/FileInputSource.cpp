@@ -9,6 +9,10 @@
 #if defined __unix__ || defined __GNUC__
 #include <unistd.h>
 #endif
+#if defined __unix__ || defined __APPLE__
+#include <sys/mman.h>
+#define COLORER_MMAP_FILES
+#endif
 #ifndef O_BINARY
 #define O_BINARY 0x0
 #endif
@@ -51,7 +55,21 @@ FileInputSource::FileInputSource(const UnicodeString* basePath, FileInputSource*
 FileInputSource::~FileInputSource()
 {
   delete baseLocation;
+  freeStream();
+}
+
+void FileInputSource::freeStream()
+{
+#ifdef COLORER_MMAP_FILES
+  if (mapped) {
+    munmap(stream, len);
+    stream = nullptr;
+    mapped = false;
+    return;
+  }
+#endif
   delete[] stream;
+  stream = nullptr;
 }
 colorer::InputSource* FileInputSource::createRelative(const UnicodeString* relPath)
 {
@@ -80,19 +98,31 @@ const byte* FileInputSource::openStream()
   fstat(source, &st);
   len = st.st_size;
 
+#ifdef COLORER_MMAP_FILES
+  // pages of file are read on access, data is not copied
+  if (len > 0) {
+    void* addr = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, source, 0);
+    if (addr != MAP_FAILED) {
+      close(source);
+      stream = static_cast<byte*>(addr);
+      mapped = true;
+      return stream;
+    }
+  }
+#endif
+
   stream = new byte[len];
-  memset(stream, 0, sizeof(byte) * len);
 #ifdef _MSC_VER
-  if (_read(source, stream, len) != len) {
-    throw InputSourceException("Error on read file" + *baseLocation);
-  }
+  int read_len = _read(source, stream, len);
   _close(source);
 #else
-  if (read(source, stream, len) != len) {
-    throw InputSourceException("Error on read file" + *baseLocation);
-  }
+  int read_len = static_cast<int>(read(source, stream, len));
   close(source);
 #endif
+  if (read_len != len) {
+    freeStream();
+    throw InputSourceException("Error on read file" + *baseLocation);
+  }
   return stream;
 }
 
@@ -100,8 +130,7 @@ void FileInputSource::closeStream()
 {
   if (stream == nullptr)
     throw InputSourceException("closeStream(): source stream is not yet opened");
-  delete[] stream;
-  stream = nullptr;
+  freeStream();
 }
 
 int FileInputSource::length() const
@@ -4,6 +4,8 @@
 #include "colorer/io/InputSource.h"
 
 /** Reads data from file with OS services.
+    On POSIX systems file is mapped into memory instead of reading,
+    so the file must not be truncated while stream is opened.
     @ingroup common_io
 */
 class FileInputSource : public colorer::InputSource
@@ -24,6 +26,11 @@ class FileInputSource : public colorer::InputSource
   UnicodeString* baseLocation = nullptr;
   byte* stream = nullptr;
   int len = 0;
+  // stream is mapped file, not allocated buffer
+  bool mapped = false;
+
+ private:
+  void freeStream();
 };
 
 #endif // COLORER_FILEINPUTSOURCE_H
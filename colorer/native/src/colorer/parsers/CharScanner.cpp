@@ -0,0 +1,195 @@
+#include "colorer/parsers/CharScanner.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define COLORER_SCANNER_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_SSSE3 __attribute__((target("ssse3")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SSSE3
+#define TARGET_AVX2
+#endif
+
+namespace {
+
+enum class SimdLevel { NONE, SSSE3, AVX2 };
+
+[[maybe_unused]] SimdLevel detectSimdLevel()
+{
+#ifdef COLORER_SCANNER_X86
+#if defined(__GNUC__) || defined(__clang__)
+  if (__builtin_cpu_supports("avx2")) {
+    return SimdLevel::AVX2;
+  }
+  if (__builtin_cpu_supports("ssse3")) {
+    return SimdLevel::SSSE3;
+  }
+#elif defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  int max_leaf = info[0];
+  __cpuid(info, 1);
+  bool ssse3 = (info[2] & (1 << 9)) != 0;
+  // AVX2 needs OS support of YMM registers
+  bool os_ymm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+  if (os_ymm && max_leaf >= 7) {
+    __cpuidex(info, 7, 0);
+    if ((info[1] & (1 << 5)) != 0) {
+      return SimdLevel::AVX2;
+    }
+  }
+  if (ssse3) {
+    return SimdLevel::SSSE3;
+  }
+#endif
+#endif
+  return SimdLevel::NONE;
+}
+
+[[maybe_unused]] int lowestBit(unsigned int mask)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_ctz(mask);
+#elif defined(_MSC_VER)
+  unsigned long idx;
+  _BitScanForward(&idx, mask);
+  return static_cast<int>(idx);
+#else
+  int idx = 0;
+  while (!(mask & 1)) {
+    mask >>= 1;
+    idx++;
+  }
+  return idx;
+#endif
+}
+
+}  // namespace
+
+CharScanner::CharScanner(const SStartChars& chars_) : chars(chars_)
+{
+  for (int c = 0; c < 256; c++) {
+    if (chars.chars[c]) {
+      int high_nibble = c >> 4;
+      uint8_t* table = high_nibble < 8 ? lowTable : highTable;
+      table[c & 0x0F] |= static_cast<uint8_t>(1 << (high_nibble & 7));
+    }
+  }
+}
+
+int CharScanner::find(const UnicodeString& str, int from, int to) const
+{
+#ifdef COLORER_FEATURE_ICU
+  static const SimdLevel level = detectSimdLevel();
+  const UChar* text = str.getBuffer();
+  switch (level) {
+    case SimdLevel::AVX2:
+      return findAvx2(text, from, to);
+    case SimdLevel::SSSE3:
+      return findSsse3(text, from, to);
+    case SimdLevel::NONE:
+      break;
+  }
+  return findScalar(text, from, to);
+#else
+  while (from < to && !chars.contains(str[from])) {
+    from++;
+  }
+  return from;
+#endif
+}
+
+int CharScanner::findScalar(const UChar* text, int from, int to) const
+{
+  while (from < to && !chars.contains(text[from])) {
+    from++;
+  }
+  return from;
+}
+
+// Chars are packed into bytes, membership of byte in the set is found by
+// two table lookups: low nibble selects the mask of high nibbles in the set,
+// high nibble selects the bit in this mask. Chars above 0xFF are matched by
+// the 'high' flag of the set.
+
+TARGET_SSSE3 int CharScanner::findSsse3(const UChar* text, int from, int to) const
+{
+#ifdef COLORER_SCANNER_X86
+  const __m128i low_table = _mm_load_si128(reinterpret_cast<const __m128i*>(lowTable));
+  const __m128i high_table = _mm_load_si128(reinterpret_cast<const __m128i*>(highTable));
+  const __m128i bits = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+  const __m128i low_byte = _mm_set1_epi16(0x00FF);
+  const __m128i nibble = _mm_set1_epi8(0x0F);
+  const __m128i sign = _mm_set1_epi8(-128);
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i high_chars = chars.high ? _mm_set1_epi8(-1) : zero;
+
+  for (; from + 16 <= to; from += 16) {
+    __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + from));
+    __m128i v2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + from + 8));
+    __m128i bytes = _mm_packus_epi16(_mm_and_si128(v1, low_byte), _mm_and_si128(v2, low_byte));
+    __m128i is_low = _mm_packs_epi16(_mm_cmpeq_epi16(_mm_srli_epi16(v1, 8), zero),
+                                     _mm_cmpeq_epi16(_mm_srli_epi16(v2, 8), zero));
+
+    __m128i masks = _mm_or_si128(_mm_shuffle_epi8(low_table, bytes),
+                                 _mm_shuffle_epi8(high_table, _mm_xor_si128(bytes, sign)));
+    __m128i bit = _mm_shuffle_epi8(bits, _mm_and_si128(_mm_srli_epi16(bytes, 4), nibble));
+    __m128i not_in_set = _mm_cmpeq_epi8(_mm_and_si128(masks, bit), zero);
+
+    __m128i found = _mm_or_si128(_mm_andnot_si128(not_in_set, is_low), _mm_andnot_si128(is_low, high_chars));
+    auto mask = static_cast<unsigned int>(_mm_movemask_epi8(found));
+    if (mask) {
+      return from + lowestBit(mask);
+    }
+  }
+#endif
+  return findScalar(text, from, to);
+}
+
+TARGET_AVX2 int CharScanner::findAvx2(const UChar* text, int from, int to) const
+{
+#ifdef COLORER_SCANNER_X86
+  const __m256i low_table =
+      _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(lowTable)));
+  const __m256i high_table =
+      _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(highTable)));
+  const __m256i bits = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8,
+                                        16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+  const __m256i low_byte = _mm256_set1_epi16(0x00FF);
+  const __m256i nibble = _mm256_set1_epi8(0x0F);
+  const __m256i sign = _mm256_set1_epi8(-128);
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i high_chars = chars.high ? _mm256_set1_epi8(-1) : zero;
+
+  for (; from + 32 <= to; from += 32) {
+    __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + from));
+    __m256i v2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + from + 16));
+    // pack works inside 128 bit lanes, permute restores the order of chars
+    __m256i bytes = _mm256_permute4x64_epi64(
+        _mm256_packus_epi16(_mm256_and_si256(v1, low_byte), _mm256_and_si256(v2, low_byte)), 0xD8);
+    __m256i is_low = _mm256_permute4x64_epi64(
+        _mm256_packs_epi16(_mm256_cmpeq_epi16(_mm256_srli_epi16(v1, 8), zero),
+                           _mm256_cmpeq_epi16(_mm256_srli_epi16(v2, 8), zero)),
+        0xD8);
+
+    __m256i masks = _mm256_or_si256(_mm256_shuffle_epi8(low_table, bytes),
+                                    _mm256_shuffle_epi8(high_table, _mm256_xor_si256(bytes, sign)));
+    __m256i bit = _mm256_shuffle_epi8(bits, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), nibble));
+    __m256i not_in_set = _mm256_cmpeq_epi8(_mm256_and_si256(masks, bit), zero);
+
+    __m256i found =
+        _mm256_or_si256(_mm256_andnot_si256(not_in_set, is_low), _mm256_andnot_si256(is_low, high_chars));
+    auto mask = static_cast<unsigned int>(_mm256_movemask_epi8(found));
+    if (mask) {
+      return from + lowestBit(mask);
+    }
+  }
+#endif
+  return findSsse3(text, from, to);
+}
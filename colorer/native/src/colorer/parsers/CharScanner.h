@@ -0,0 +1,38 @@
+#ifndef COLORER_CHARSCANNER_H
+#define COLORER_CHARSCANNER_H
+
+#include <cstdint>
+#include "colorer/Common.h"
+#include "colorer/cregexp/cregexp.h"
+
+/** Search of the next char from the set in the line.
+    Uses AVX2 or SSSE3 instructions, if processor supports them.
+    @ingroup colorer_parsers
+*/
+class CharScanner
+{
+ public:
+  explicit CharScanner(const SStartChars& chars);
+
+  [[nodiscard]] bool contains(UChar c) const
+  {
+    return chars.contains(c);
+  }
+
+  /** Returns position of the first char from the set in the line between
+      @c from and @c to, or @c to if there is no such char.
+   */
+  [[nodiscard]] int find(const UnicodeString& str, int from, int to) const;
+
+ private:
+  SStartChars chars;
+  // masks of high nibbles 0-7 and 8-15 by low nibble of char
+  alignas(16) uint8_t lowTable[16] = {};
+  alignas(16) uint8_t highTable[16] = {};
+
+  int findScalar(const UChar* text, int from, int to) const;
+  int findSsse3(const UChar* text, int from, int to) const;
+  int findAvx2(const UChar* text, int from, int to) const;
+};
+
+#endif  // COLORER_CHARSCANNER_H
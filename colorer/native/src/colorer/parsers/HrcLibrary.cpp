@@ -53,11 +53,31 @@ const Region* HrcLibrary::getRegion(const UnicodeString* name)
   return pimpl->getRegion(name);
 }
 
+void HrcLibrary::setCacheDir(const UnicodeString& cache_dir)
+{
+  pimpl->setCacheDir(cache_dir);
+}
+
+void HrcLibrary::setEagerCompile(bool eager)
+{
+  pimpl->setEagerCompile(eager);
+}
+
+HrcLibrary::RegExpStats HrcLibrary::getRegExpStats() const
+{
+  return pimpl->getRegExpStats();
+}
+
 void HrcLibrary::loadFileType(FileType* filetype)
 {
   pimpl->loadFileType(filetype);
 }
 
+void HrcLibrary::loadAllFileTypes(unsigned int threads)
+{
+  pimpl->loadAllFileTypes(threads);
+}
+
 void HrcLibrary::loadHrcSettings(const XmlInputSource& is)
 {
   pimpl->loadHrcSettings(is);
@@ -1,9 +1,18 @@
 #include "colorer/parsers/HrcLibraryImpl.h"
+#include <algorithm>
+#include <atomic>
 #include <memory>
+#include <thread>
+#include <unordered_set>
 #include "colorer/base/XmlTagDefs.h"
 #include "colorer/parsers/FileTypeImpl.h"
 #include "colorer/xml/XmlReader.h"
 
+static bool hasNamedBrackets(const UnicodeString& pattern)
+{
+  return pattern.indexOf(UnicodeString(u"(?{")) != -1;
+}
+
 HrcLibrary::Impl::Impl()
 {
   fileTypeHash.reserve(200);
@@ -71,6 +80,19 @@ void HrcLibrary::Impl::unloadFileType(const FileType* filetype)
       }
     }
   }
+  unlinkedSchemes.erase(std::remove_if(unlinkedSchemes.begin(), unlinkedSchemes.end(),
+                                       [filetype](const SchemeImpl* scheme) { return scheme->fileType == filetype; }),
+                        unlinkedSchemes.end());
+  preparedSchemes.erase(std::remove_if(preparedSchemes.begin(), preparedSchemes.end(),
+                                       [filetype](const SchemeImpl* scheme) { return scheme->fileType == filetype; }),
+                        preparedSchemes.end());
+  for (auto subst = virtualSubst.begin(); subst != virtualSubst.end();) {
+    auto& schemes = subst->second;
+    schemes.erase(std::remove_if(schemes.begin(), schemes.end(),
+                                 [filetype](const SchemeImpl* scheme) { return scheme->fileType == filetype; }),
+                  schemes.end());
+    subst = subst->first->fileType == filetype ? virtualSubst.erase(subst) : std::next(subst);
+  }
   for (auto ft = fileTypeVector.begin(); ft != fileTypeVector.end(); ++ft) {
     if (*ft == filetype) {
       fileTypeVector.erase(ft);
@@ -79,6 +101,12 @@ void HrcLibrary::Impl::unloadFileType(const FileType* filetype)
   }
   fileTypeHash.erase(filetype->getName());
   delete filetype;
+
+  // regexps, which are not used by nodes of any scheme
+  std::lock_guard<std::mutex> lock(regexpMutex);
+  for (auto regexp = regexpCache.begin(); regexp != regexpCache.end();) {
+    regexp = regexp->second.use_count() == 1 ? regexpCache.erase(regexp) : std::next(regexp);
+  }
 }
 
 void HrcLibrary::Impl::loadFileType(FileType* filetype)
@@ -116,6 +144,63 @@ void HrcLibrary::Impl::loadFileType(FileType* filetype)
   thisType->pimpl->input_source_loading = false;
 }
 
+void HrcLibrary::Impl::loadAllFileTypes(unsigned int threads)
+{
+  std::vector<FileType*> types;
+  std::vector<const XmlInputSource*> sources;
+  std::unordered_set<UnicodeString> paths;
+  for (auto* type : fileTypeVector) {
+    const auto& type_impl = type->pimpl;
+    if (type_impl->loadDone || type_impl->load_broken || !type_impl->inputSource) {
+      continue;
+    }
+    types.push_back(type);
+    if (paths.insert(type_impl->inputSource->getPath()).second) {
+      sources.push_back(type_impl->inputSource.get());
+    }
+  }
+
+  // xml of files is read in parallel, errors are reported by the following load of the type
+  std::vector<std::list<XMLNode>> nodes(sources.size());
+  std::vector<char> is_read(sources.size(), 0);
+  std::atomic<size_t> next_source {0};
+  auto read_sources = [&]() {
+    for (size_t idx = next_source++; idx < sources.size(); idx = next_source++) {
+      try {
+        XmlReader xml(*sources[idx], xmlCache.get());
+        if (xml.parse()) {
+          xml.getNodes(nodes[idx]);
+          is_read[idx] = 1;
+        }
+      } catch (...) {
+        nodes[idx].clear();
+      }
+    }
+  };
+  if (threads == 0) {
+    threads = std::thread::hardware_concurrency();
+  }
+  std::vector<std::thread> workers;
+  for (unsigned int i = 1; i < threads && i < sources.size(); i++) {
+    workers.emplace_back(read_sources);
+  }
+  read_sources();
+  for (auto& worker : workers) {
+    worker.join();
+  }
+
+  for (size_t idx = 0; idx < sources.size(); idx++) {
+    if (is_read[idx]) {
+      prereadNodes.emplace(sources[idx]->getPath(), std::move(nodes[idx]));
+    }
+  }
+  // types are built in the same order, as by sequential load
+  for (auto* type : types) {
+    loadFileType(type);
+  }
+  prereadNodes.clear();
+}
+
 void HrcLibrary::Impl::loadHrcSettings(const XmlInputSource& is)
 {
   XmlReader xml_parser(is);
@@ -210,12 +295,19 @@ void HrcLibrary::Impl::parseHRC(const XmlInputSource& is)
 {
   COLORER_LOG_DEBUG("begin parse '%'", is.getPath());
 
-  XmlReader xml(is);
-  if (!xml.parse()) {
-    throw HrcLibraryException("Error reading hrc file '" + is.getPath() + "'");
-  }
   std::list<XMLNode> nodes;
-  xml.getNodes(nodes);
+  auto preread = prereadNodes.find(is.getPath());
+  if (preread != prereadNodes.end()) {
+    nodes.splice(nodes.end(), preread->second);
+    prereadNodes.erase(preread);
+  }
+  else {
+    XmlReader xml(is, xmlCache.get());
+    if (!xml.parse()) {
+      throw HrcLibraryException("Error reading hrc file '" + is.getPath() + "'");
+    }
+    xml.getNodes(nodes);
+  }
 
   if (nodes.begin()->name != hrcTagHrc) {
     throw HrcLibraryException("Incorrect hrc-file structure. Main '<hrc>' block not found. Current file " +
@@ -547,6 +639,8 @@ void HrcLibrary::Impl::addScheme(const XMLNode& elem)
 
   auto* scheme = new SchemeImpl(qSchemeName.get());
   scheme->fileType = current_parse_type;
+  scheme->preparer = this;
+  unlinkedSchemes.push_back(scheme);
 
   schemeHash.try_emplace(*scheme->getName(), scheme);
   const auto& condIf = elem.getAttrValue(hrcSchemeAttrIf);
@@ -633,19 +727,14 @@ void HrcLibrary::Impl::addSchemeRegexp(SchemeImpl* scheme, const XMLNode& elem)
     return;
   }
 
-  const auto entMatchParam = useEntities(&matchParam);
-  auto regexp = std::make_unique<CRegExp>(entMatchParam.get());
-  if (!regexp->isOk()) {
-    COLORER_LOG_ERROR("fault compiling regexp '%' of scheme '%', skip this regexp block.", *entMatchParam,
-                      *scheme->schemeName);
-    return;
-  }
-
   auto scheme_node = std::make_unique<SchemeNodeRegexp>();
   const auto& dhrcRegexpAttrPriority = elem.getAttrValue(hrcRegexpAttrPriority);
   scheme_node->lowPriority = UnicodeString(value_low).compare(dhrcRegexpAttrPriority) == 0;
-  scheme_node->start = std::move(regexp);
-  scheme_node->start->setPositionMoves(false);
+  scheme_node->startPattern = useEntities(&matchParam);
+  // names of brackets are needed to load regions, so such regexp is compiled now
+  if ((eagerCompile || hasNamedBrackets(*scheme_node->startPattern)) && !compileNode(scheme, scheme_node.get())) {
+    return;
+  }
 
   loadRegexpRegions(scheme_node.get(), elem);
   if (scheme_node->region) {
@@ -701,26 +790,6 @@ void HrcLibrary::Impl::addSchemeBlock(SchemeImpl* scheme, const XMLNode& elem)
     return;
   }
 
-  const uUnicodeString startParam = useEntities(&start_param);
-  auto start_regexp = std::make_unique<CRegExp>(startParam.get());
-  start_regexp->setPositionMoves(false);
-  if (!start_regexp->isOk()) {
-    COLORER_LOG_ERROR("fault compiling start regexp '%' in block of scheme '%', skip this block.", *startParam,
-                      *scheme->schemeName);
-    return;
-  }
-
-  const uUnicodeString endParam = useEntities(&end_param);
-  auto end_regexp = std::make_unique<CRegExp>();
-  end_regexp->setPositionMoves(true);
-  end_regexp->setBackRE(start_regexp.get());
-  end_regexp->setRE(endParam.get());
-  if (!end_regexp->isOk()) {
-    COLORER_LOG_ERROR("fault compiling end regexp '%' in block of scheme '%', skip this block.", *startParam,
-                      *scheme->schemeName);
-    return;
-  }
-
   const auto& attr_pr = elem.getAttrValue(hrcBlockAttrPriority);
   const auto& attr_cpr = elem.getAttrValue(hrcBlockAttrContentPriority);
   const auto& attr_ireg = elem.getAttrValue(hrcBlockAttrInnerRegion);
@@ -730,8 +799,14 @@ void HrcLibrary::Impl::addSchemeBlock(SchemeImpl* scheme, const XMLNode& elem)
   scheme_node->lowPriority = UnicodeString(value_low).compare(attr_pr) == 0;
   scheme_node->lowContentPriority = UnicodeString(value_low).compare(attr_cpr) == 0;
   scheme_node->innerRegion = UnicodeString(value_yes).compare(attr_ireg) == 0;
-  scheme_node->start = std::move(start_regexp);
-  scheme_node->end = std::move(end_regexp);
+  scheme_node->startPattern = useEntities(&start_param);
+  scheme_node->endPattern = useEntities(&end_param);
+  // names of brackets are needed to load regions, so such regexps are compiled now
+  if ((eagerCompile || hasNamedBrackets(*scheme_node->startPattern) || hasNamedBrackets(*scheme_node->endPattern)) &&
+      !compileNode(scheme, scheme_node.get()))
+  {
+    return;
+  }
 
   loadBlockRegions(scheme_node.get(), elem);
   loadRegions(scheme_node.get(), element_start, true);
@@ -773,10 +848,8 @@ void HrcLibrary::Impl::parseSchemeKeywords(SchemeImpl* scheme, const XMLNode& el
 
   loopSchemeKeywords(elem, scheme, scheme_node.get(), region);
   scheme_node->kwList->firstChar->freeze();
+  // trie is built with other nodes of scheme
 
-  // TODO unique keywords in list
-  scheme_node->kwList->sortList();
-  scheme_node->kwList->substrIndex();
   scheme->nodes.push_back(std::move(scheme_node));
 }
 
@@ -917,8 +990,11 @@ void HrcLibrary::Impl::loadRegexpRegions(SchemeNodeRegexp* node, const XMLNode&
     node->regions[i] = getNCRegion(&el, UnicodeString(rg_tmpl));
   }
 
-  for (int i = 0; i < NAMED_REGIONS_NUM; i++) {
-    node->regionsn[i] = getNCRegion(node->start->getBracketName(i), false);
+  // regexp without named brackets can be not compiled yet
+  if (node->start) {
+    for (int i = 0; i < NAMED_REGIONS_NUM; i++) {
+      node->regionsn[i] = getNCRegion(node->start->getBracketName(i), false);
+    }
   }
 }
 
@@ -943,6 +1019,10 @@ void HrcLibrary::Impl::loadRegions(SchemeNodeBlock* node, const XMLNode* el, con
     }
   }
 
+  // regexps without named brackets can be not compiled yet
+  if (!node->start) {
+    return;
+  }
   for (int i = 0; i < NAMED_REGIONS_NUM; i++) {
     if (start_element) {
       node->regionsn[i] = getNCRegion(node->start->getBracketName(i), false);
@@ -992,9 +1072,15 @@ void HrcLibrary::Impl::updateSchemeLink(uUnicodeString& scheme_name, SchemeImpl*
 
 void HrcLibrary::Impl::updateLinks()
 {
+  bool virtualChanged = false;
   while (structureChanged) {
     structureChanged = false;
-    for (auto const& [key, scheme] : schemeHash) {
+    unlinkedSchemes.erase(std::remove_if(unlinkedSchemes.begin(), unlinkedSchemes.end(),
+                                         [](const SchemeImpl* scheme) { return scheme->linksResolved; }),
+                          unlinkedSchemes.end());
+    // schemes of types, loaded while links are resolved, are added to the end of list
+    for (size_t idx = 0; idx < unlinkedSchemes.size(); idx++) {
+      auto* scheme = unlinkedSchemes[idx];
       if (!scheme->fileType->pimpl->loadDone) {
         continue;
       }
@@ -1012,17 +1098,183 @@ void HrcLibrary::Impl::updateLinks()
 
           updateSchemeLink(snode_inherit->schemeName, &snode_inherit->scheme, 1, scheme);
           for (auto* vt : snode_inherit->virtualEntryVector) {
+            if (vt->virtSchemeName == nullptr && vt->substSchemeName == nullptr) {
+              continue;
+            }
             updateSchemeLink(vt->virtSchemeName, &vt->virtScheme, 2, scheme);
             updateSchemeLink(vt->substSchemeName, &vt->substScheme, 3, scheme);
+            if (vt->virtScheme && vt->substScheme) {
+              // virtual scheme can be replaced by substitution anywhere below this inherit,
+              // so first chars of all schemes, which use it, are changed
+              virtualSubst[vt->virtScheme].push_back(vt->substScheme);
+              virtualChanged = true;
+            }
           }
         }
       }
+      // names of links are cleared after the first try, so scheme is removed from the list
+      scheme->linksResolved = true;
       current_parse_type = old_parseType;
       if (structureChanged) {
         break;
       }
     }
   }
+  if (virtualChanged) {
+    invalidateFirstChars();
+  }
+  if (eagerCompile) {
+    for (auto const& [key, scheme] : schemeHash) {
+      if (scheme->fileType->pimpl->loadDone) {
+        prepareScheme(scheme);
+      }
+    }
+  }
+}
+
+void HrcLibrary::Impl::invalidateFirstChars()
+{
+  // first chars are built again on the next entry into scheme, compiled nodes are kept
+  std::lock_guard<std::mutex> lock(prepareMutex);
+  for (auto* scheme : preparedSchemes) {
+    scheme->prepared.store(false, std::memory_order_release);
+  }
+  preparedSchemes.clear();
+}
+
+bool HrcLibrary::Impl::compileNode(const SchemeImpl* scheme, SchemeNodeRegexp* node)
+{
+  if (node->start) {
+    return true;
+  }
+  auto regexp = getRegExp(*node->startPattern, false, nullptr);
+  if (!regexp->isOk()) {
+    COLORER_LOG_ERROR("fault compiling regexp '%' of scheme '%', skip this regexp block.", *node->startPattern,
+                      *scheme->schemeName);
+    return false;
+  }
+  node->start = std::move(regexp);
+  node->startPattern.reset();
+  return true;
+}
+
+bool HrcLibrary::Impl::compileNode(const SchemeImpl* scheme, SchemeNodeBlock* node)
+{
+  if (node->start && node->end) {
+    return true;
+  }
+  auto start_regexp = getRegExp(*node->startPattern, false, nullptr);
+  if (!start_regexp->isOk()) {
+    COLORER_LOG_ERROR("fault compiling start regexp '%' in block of scheme '%', skip this block.",
+                      *node->startPattern, *scheme->schemeName);
+    return false;
+  }
+  auto end_regexp = getRegExp(*node->endPattern, true, start_regexp.get());
+  if (!end_regexp->isOk()) {
+    COLORER_LOG_ERROR("fault compiling end regexp '%' in block of scheme '%', skip this block.", *node->endPattern,
+                      *scheme->schemeName);
+    return false;
+  }
+  node->start = std::move(start_regexp);
+  node->end = std::move(end_regexp);
+  node->startPattern.reset();
+  node->endPattern.reset();
+  return true;
+}
+
+void HrcLibrary::Impl::compileSchemeNodes(SchemeImpl* scheme)
+{
+  auto& nodes = scheme->nodes;
+  for (auto it = nodes.begin(); it != nodes.end();) {
+    bool compiled = true;
+    switch ((*it)->type) {
+      case SchemeNode::SchemeNodeType::SNT_RE:
+        compiled = compileNode(scheme, static_cast<SchemeNodeRegexp*>(it->get()));
+        break;
+      case SchemeNode::SchemeNodeType::SNT_BLOCK:
+        compiled = compileNode(scheme, static_cast<SchemeNodeBlock*>(it->get()));
+        break;
+      case SchemeNode::SchemeNodeType::SNT_KEYWORDS: {
+        auto* kw_list = static_cast<SchemeNodeKeywords*>(it->get())->kwList.get();
+        if (kw_list->trie.empty()) {
+          kw_list->buildTrie();
+        }
+        break;
+      }
+      case SchemeNode::SchemeNodeType::SNT_INHERIT:
+        break;
+    }
+    // node with broken regexp is removed, as it is done at load
+    it = compiled ? it + 1 : nodes.erase(it);
+  }
+  scheme->buildNodeIndex();
+  scheme->nodesCompiled = true;
+}
+
+void HrcLibrary::Impl::updateFirstChars(SchemeImpl* scheme)
+{
+  // scheme can match text from the first chars of own nodes, nodes of inherited schemes
+  // and schemes, which replace them by virtual entries
+  SStartChars chars;
+  bool any = false;
+  std::vector<SchemeImpl*> stack {scheme};
+  std::unordered_set<SchemeImpl*> visited {scheme};
+  while (!stack.empty() && !any) {
+    auto* current = stack.back();
+    stack.pop_back();
+    if (!current->nodesCompiled) {
+      compileSchemeNodes(current);
+    }
+    if (!current->fillFirstChars(chars)) {
+      any = true;
+      break;
+    }
+    auto visit = [&](SchemeImpl* used) {
+      if (visited.insert(used).second) {
+        stack.push_back(used);
+      }
+    };
+    for (const auto& snode : current->nodes) {
+      if (snode->type == SchemeNode::SchemeNodeType::SNT_INHERIT) {
+        auto* snode_inherit = static_cast<SchemeNodeInherit*>(snode.get());
+        if (snode_inherit->scheme) {
+          visit(snode_inherit->scheme);
+        }
+      }
+    }
+    auto subst = virtualSubst.find(current);
+    if (subst != virtualSubst.end()) {
+      for (auto* used : subst->second) {
+        visit(used);
+      }
+    }
+  }
+
+  // other threads can still parse with the previous first chars of scheme
+  std::shared_ptr<const CharScanner> first_chars;
+  if (!any && !(chars.chars.all() && chars.high)) {
+    first_chars = std::make_shared<const CharScanner>(chars);
+  }
+  std::atomic_store(&scheme->firstChars, std::move(first_chars));
+}
+
+void HrcLibrary::Impl::prepareScheme(SchemeImpl* scheme)
+{
+  std::lock_guard<std::mutex> lock(prepareMutex);
+  if (scheme->prepared.load(std::memory_order_relaxed)) {
+    return;
+  }
+  if (!scheme->nodesCompiled) {
+    compileSchemeNodes(scheme);
+  }
+  updateFirstChars(scheme);
+  preparedSchemes.push_back(scheme);
+  scheme->prepared.store(true, std::memory_order_release);
+}
+
+void HrcLibrary::Impl::setEagerCompile(bool eager)
+{
+  eagerCompile = eager;
 }
 
 uUnicodeString HrcLibrary::Impl::qualifyOwnName(const UnicodeString& name) const
@@ -1121,6 +1373,50 @@ uUnicodeString HrcLibrary::Impl::qualifyForeignName(const UnicodeString* name, c
   return nullptr;
 }
 
+size_t HrcLibrary::Impl::RegExpKeyHash::operator()(const RegExpKey& key) const
+{
+  size_t hash = std::hash<UnicodeString>()(key.pattern);
+  hash ^= std::hash<const CRegExp*>()(key.backRE) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+  return key.positionMoves ? ~hash : hash;
+}
+
+std::shared_ptr<CRegExp> HrcLibrary::Impl::getRegExp(const UnicodeString& pattern, bool positionMoves,
+                                                     CRegExp* backRE)
+{
+  std::lock_guard<std::mutex> lock(regexpMutex);
+  regexpRequested++;
+  RegExpKey key {pattern, positionMoves, backRE};
+  auto it = regexpCache.find(key);
+  if (it != regexpCache.end()) {
+    return it->second;
+  }
+  auto regexp = std::make_shared<CRegExp>();
+  regexp->setPositionMoves(positionMoves);
+  regexp->setBackRE(backRE);
+  regexp->setRE(&pattern);
+  regexpCache.emplace(std::move(key), regexp);
+  return regexp;
+}
+
+void HrcLibrary::Impl::setCacheDir(const UnicodeString& cache_dir)
+{
+  if (cache_dir.isEmpty()) {
+    xmlCache.reset();
+  }
+  else {
+    xmlCache = std::make_unique<XmlCache>(cache_dir);
+  }
+}
+
+HrcLibrary::RegExpStats HrcLibrary::Impl::getRegExpStats() const
+{
+  std::lock_guard<std::mutex> lock(regexpMutex);
+  HrcLibrary::RegExpStats stats;
+  stats.requested = regexpRequested;
+  stats.compiled = regexpCache.size();
+  return stats;
+}
+
 uUnicodeString HrcLibrary::Impl::useEntities(const UnicodeString* name)
 {
   int copypos = 0;
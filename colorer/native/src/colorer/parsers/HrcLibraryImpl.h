@@ -1,11 +1,14 @@
 #ifndef COLORER_HRCLIBRARYIMPL_H
 #define COLORER_HRCLIBRARYIMPL_H
 
+#include <memory>
+#include <mutex>
 #include <unordered_map>
 #include "colorer/HrcLibrary.h"
 #include "colorer/cregexp/cregexp.h"
 #include "colorer/parsers/SchemeImpl.h"
 #include "colorer/xml/XMLNode.h"
+#include "colorer/xml/XmlCache.h"
 #include "colorer/xml/XmlInputSource.h"
 
 class FileType;
@@ -14,17 +17,18 @@ class FileType;
     Reads and maintains HRC database of syntax rules, used by TextParser implementations to make
     realtime text syntax parsing.
 */
-class HrcLibrary::Impl
+class HrcLibrary::Impl : public SchemePreparer
 {
  public:
   Impl();
-  ~Impl();
+  ~Impl() override;
 
   // типы загрузки hrc файла: полная, только прототипы и внешние пакеты, только типы
   enum class LoadType { FULL, PROTOTYPE, TYPE };
 
   void loadSource(XmlInputSource* input_source, LoadType load_type);
   void loadFileType(FileType* filetype);
+  void loadAllFileTypes(unsigned int threads);
   void loadHrcSettings(const XmlInputSource& is);
   FileType* getFileType(const UnicodeString* name);
   FileType* enumerateFileTypes(unsigned int index) const;
@@ -34,6 +38,10 @@ class HrcLibrary::Impl
   size_t getRegionCount() const;
   const Region* getRegion(unsigned int id) const;
   const Region* getRegion(const UnicodeString* name);
+  HrcLibrary::RegExpStats getRegExpStats() const;
+  void setCacheDir(const UnicodeString& cache_dir);
+  void setEagerCompile(bool eager);
+  void prepareScheme(SchemeImpl* scheme) override;
 
  protected:
   enum class QualifyNameType { QNT_DEFINE, QNT_SCHEME, QNT_ENTITY };
@@ -50,6 +58,41 @@ class HrcLibrary::Impl
   std::unordered_map<UnicodeString, const Region*> regionNamesHash;
   std::unordered_map<UnicodeString, UnicodeString*> schemeEntitiesHash;
 
+  // compiled regexps of scheme nodes, text of regexp includes its flags
+  struct RegExpKey
+  {
+    UnicodeString pattern;
+    bool positionMoves;
+    const CRegExp* backRE;
+
+    bool operator==(const RegExpKey& key) const
+    {
+      return positionMoves == key.positionMoves && backRE == key.backRE && pattern == key.pattern;
+    }
+  };
+  struct RegExpKeyHash
+  {
+    size_t operator()(const RegExpKey& key) const;
+  };
+  // guards regexpCache and regexpRequested, regexps are requested by loader and parsers
+  mutable std::mutex regexpMutex;
+  std::unordered_map<RegExpKey, std::shared_ptr<CRegExp>, RegExpKeyHash> regexpCache;
+  size_t regexpRequested = 0;
+
+  std::unique_ptr<XmlCache> xmlCache;
+  // documents, read before the load of their types
+  std::unordered_map<UnicodeString, std::list<XMLNode>> prereadNodes;
+  // schemes in the order of load, which links to other schemes are not resolved yet
+  std::vector<SchemeImpl*> unlinkedSchemes;
+
+  bool eagerCompile = false;
+  // guards compilation of schemes, which can be started by parsers in different threads
+  std::mutex prepareMutex;
+  // schemes, which were prepared since the last invalidation of first chars
+  std::vector<SchemeImpl*> preparedSchemes;
+  // substitutions of virtual schemes from all inherit nodes
+  std::unordered_map<SchemeImpl*, std::vector<SchemeImpl*>> virtualSubst;
+
   FileType* current_parse_type = nullptr;
   XmlInputSource* current_input_source = nullptr;
   LoadType current_load_type = LoadType::FULL;
@@ -89,9 +132,15 @@ class HrcLibrary::Impl
   uUnicodeString qualifyForeignName(const UnicodeString* name, QualifyNameType qntype, bool logErrors);
 
   void updateLinks();
+  void invalidateFirstChars();
+  bool compileNode(const SchemeImpl* scheme, SchemeNodeRegexp* node);
+  bool compileNode(const SchemeImpl* scheme, SchemeNodeBlock* node);
+  void compileSchemeNodes(SchemeImpl* scheme);
+  void updateFirstChars(SchemeImpl* scheme);
   void updateSchemeLink(uUnicodeString& scheme_name, SchemeImpl** scheme_impl, byte scheme_type,
                         const SchemeImpl* current_scheme);
   uUnicodeString useEntities(const UnicodeString* name);
+  std::shared_ptr<CRegExp> getRegExp(const UnicodeString& pattern, bool positionMoves, CRegExp* backRE);
   const Region* getNCRegion(const XMLNode* elem, const UnicodeString& tag);
   const Region* getNCRegion(const UnicodeString* name, bool logErrors);
   void loopSchemeKeywords(const XMLNode& elem, const SchemeImpl* scheme, const SchemeNodeKeywords* scheme_node,
@@ -1,4 +1,6 @@
 #include "colorer/parsers/KeywordList.h"
+#include <algorithm>
+#include <map>
 
 KeywordList::KeywordList(size_t list_size)
 {
@@ -11,63 +13,69 @@ KeywordList::~KeywordList()
   delete[] kwList;
 }
 
-int kwCompare(const void* e1, const void* e2)
+void KeywordList::buildTrie()
 {
-  return ((KeywordInfo*) e1)->keyword->compare(*((KeywordInfo*) e2)->keyword);
-}
+  trie.assign(1, KeywordTrieNode());
+  std::vector<std::map<UChar, int>> children(1);
+  for (int idx = 0; idx < count; idx++) {
+    const UnicodeString& keyword = *kwList[idx].keyword;
+    int node = 0;
+    for (int i = 0; i < keyword.length(); i++) {
+      UChar c = matchCase ? keyword[i] : Character::foldCase(keyword[i]);
+      auto child = children[node].find(c);
+      if (child != children[node].end()) {
+        node = child->second;
+        continue;
+      }
+      int new_node = static_cast<int>(trie.size());
+      KeywordTrieNode trie_node;
+      trie_node.parent = node;
+      trie_node.depth = i + 1;
+      trie.push_back(trie_node);
+      children.emplace_back();
+      children[node].emplace(c, new_node);
+      node = new_node;
+    }
+    if (node != 0) {
+      trie[node].keyword = idx;
+    }
+  }
 
-int kwCompareI(const void* e1, const void* e2)
-{
-  return UStr::caseCompare(*((KeywordInfo*) e1)->keyword, *((KeywordInfo*) e2)->keyword);
+  edgeChars.clear();
+  edgeNodes.clear();
+  edgeChars.reserve(trie.size() - 1);
+  edgeNodes.reserve(trie.size() - 1);
+  for (size_t node = 0; node < trie.size(); node++) {
+    trie[node].firstEdge = static_cast<int>(edgeChars.size());
+    trie[node].edgeCount = static_cast<int>(children[node].size());
+    for (const auto& [c, child] : children[node]) {
+      edgeChars.push_back(c);
+      edgeNodes.push_back(child);
+    }
+  }
 }
 
-void KeywordList::sortList()
+int KeywordList::findEdge(int node, UChar c) const
 {
-  if (count < 2) {
-    return;
-  }
-
-  if (matchCase) {
-    qsort((void*) kwList, count, sizeof(KeywordInfo), &kwCompare);
-  } else {
-    qsort((void*) kwList, count, sizeof(KeywordInfo), &kwCompareI);
+  const auto& trie_node = trie[node];
+  const UChar* first = edgeChars.data() + trie_node.firstEdge;
+  const UChar* last = first + trie_node.edgeCount;
+  const UChar* edge = trie_node.edgeCount > 8 ? std::lower_bound(first, last, c) : std::find(first, last, c);
+  if (edge == last || *edge != c) {
+    return -1;
   }
+  return edgeNodes[edge - edgeChars.data()];
 }
 
-/* Searches previous elements num with same partial name
-   for example:
-   3: getParameterName  2
-   2: getParameter      1
-   1: getParam          0
-   0: getPar           -1
-*/
-void KeywordList::substrIndex()
+int KeywordList::walk(const UnicodeString& str, int pos, int end) const
 {
-  for (int i = count - 1; i > 0; i--) {
-    for (int ii = i - 1; ii >= 0; ii--) {
-      if (matchCase) {
-        if ((*kwList[ii].keyword)[0] != (*kwList[i].keyword)[0]) {
-          break;
-        }
-        if (kwList[ii].keyword->length() < kwList[i].keyword->length() &&
-            UnicodeString(*kwList[i].keyword, 0, kwList[ii].keyword->length()).compare(*kwList[ii].keyword) == 0)
-        {
-          kwList[i].indexOfShorter = ii;
-          break;
-        }
-      }
-      else {
-        if (Character::toLowerCase((*kwList[ii].keyword)[0]) != Character::toLowerCase((*kwList[i].keyword)[0])) {
-          break;
-        }
-        if (kwList[ii].keyword->length() < kwList[i].keyword->length() &&
-            UStr::caseCompare(UnicodeString(*kwList[i].keyword, 0, kwList[ii].keyword->length()),
-                              *kwList[ii].keyword) == 0)
-        {
-          kwList[i].indexOfShorter = ii;
-          break;
-        }
-      }
+  int node = 0;
+  for (; pos < end; pos++) {
+    int next = findEdge(node, matchCase ? str[pos] : Character::foldCase(str[pos]));
+    if (next == -1) {
+      break;
     }
+    node = next;
   }
+  return node;
 }
@@ -2,12 +2,12 @@
 #define COLORER_KEYWORDLIST_H
 
 #include <climits>
+#include <vector>
 #include "colorer/Common.h"
 #include "colorer/Region.h"
 
 /** Information about one parsed keyword.
-    Contains keyword, symbol specifier, region reference
-    and internal optimization field.
+    Contains keyword, symbol specifier and region reference.
     @ingroup colorer_parsers
 */
 struct KeywordInfo
@@ -16,10 +16,27 @@ struct KeywordInfo
   std::unique_ptr<const UnicodeString> keyword;
   const Region* region = nullptr;
   bool isSymbol = false;
-  int indexOfShorter = -1;
+};
+
+/** Node of the keywords trie.
+    @ingroup colorer_parsers
+*/
+struct KeywordTrieNode
+{
+  int parent = -1;
+  // index in kwList of keyword, which ends in this node, or -1
+  int keyword = -1;
+  // length of text from the root
+  int depth = 0;
+  // range of node edges in KeywordList::edgeChars and KeywordList::edgeNodes
+  int firstEdge = 0;
+  int edgeCount = 0;
 };
 
 /** List of keywords.
+    Keywords are compiled into the trie with edges, sorted by char
+    (case folded for case insensitive list). Edges of one node are stored
+    together in flat arrays.
     @ingroup colorer_parsers
 */
 class KeywordList
@@ -30,10 +47,25 @@ class KeywordList
   int minKeywordLength = INT_MAX;
   std::unique_ptr<CharacterClass> firstChar;
   KeywordInfo* kwList = nullptr;
+  std::vector<KeywordTrieNode> trie;
+  std::vector<UChar> edgeChars;
+  std::vector<int> edgeNodes;
+
   explicit KeywordList(size_t list_size);
   ~KeywordList();
-  void sortList();
-  void substrIndex();
+
+  /** Builds trie from kwList. Must be called after all keywords are added.
+      If keyword is duplicated, the last one is used.
+  */
+  void buildTrie();
+
+  /** Follows the text from @c pos to @c end by the trie.
+      @return Index of the deepest reached node, zero is the root.
+  */
+  [[nodiscard]] int walk(const UnicodeString& str, int pos, int end) const;
+
+ private:
+  [[nodiscard]] int findEdge(int node, UChar c) const;
 };
 
 #endif  //COLORER_KEYWORDLIST_H
@@ -0,0 +1,438 @@
+#include "colorer/ParallelTextParser.h"
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "colorer/Exception.h"
+#include "colorer/TextParser.h"
+
+/** Single call of RegionHandler, saved for the later replay.
+ */
+struct ParseEvent
+{
+  enum class Type { CLEAR_LINE, ADD_REGION, ENTER_SCHEME, LEAVE_SCHEME };
+
+  Type type;
+  size_t lno;
+  UnicodeString* line;
+  int sx;
+  int ex;
+  const Region* region;
+  const Scheme* scheme;
+};
+
+static void replayEvent(RegionHandler* rh, const ParseEvent& ev)
+{
+  switch (ev.type) {
+    case ParseEvent::Type::CLEAR_LINE:
+      rh->clearLine(ev.lno, ev.line);
+      break;
+    case ParseEvent::Type::ADD_REGION:
+      rh->addRegion(ev.lno, ev.line, ev.sx, ev.ex, ev.region);
+      break;
+    case ParseEvent::Type::ENTER_SCHEME:
+      rh->enterScheme(ev.lno, ev.line, ev.sx, ev.ex, ev.region, ev.scheme);
+      break;
+    case ParseEvent::Type::LEAVE_SCHEME:
+      rh->leaveScheme(ev.lno, ev.line, ev.sx, ev.ex, ev.region, ev.scheme);
+      break;
+  }
+}
+
+/** LineSource for worker parsers. Hides startJob/endJob of the real source,
+    they are called once by ParallelTextParser.
+ */
+class ChunkLineSource : public LineSource
+{
+ public:
+  explicit ChunkLineSource(LineSource* source) : lineSource(source) {}
+
+  UnicodeString* getLine(size_t lno) override
+  {
+    return lineSource->getLine(lno);
+  }
+
+ private:
+  LineSource* lineSource;
+};
+
+/** Result of the speculative parse of a chunk.
+    Events are stored, and the depth of not closed blocks is counted.
+ */
+class ChunkRecorder : public RegionHandler
+{
+ public:
+  int start = 0;
+  int end = 0;
+  int depth = 0;
+  bool ready = false;
+  bool skipped = false;
+  std::exception_ptr error;
+  std::vector<ParseEvent> events;
+
+  void clearLine(size_t lno, UnicodeString* line) override
+  {
+    events.push_back({ParseEvent::Type::CLEAR_LINE, lno, line, 0, 0, nullptr, nullptr});
+  }
+
+  void addRegion(size_t lno, UnicodeString* line, int sx, int ex, const Region* region) override
+  {
+    events.push_back({ParseEvent::Type::ADD_REGION, lno, line, sx, ex, region, nullptr});
+  }
+
+  void enterScheme(size_t lno, UnicodeString* line, int sx, int ex, const Region* region, const Scheme* scheme) override
+  {
+    depth++;
+    events.push_back({ParseEvent::Type::ENTER_SCHEME, lno, line, sx, ex, region, scheme});
+  }
+
+  void leaveScheme(size_t lno, UnicodeString* line, int sx, int ex, const Region* region, const Scheme* scheme) override
+  {
+    depth--;
+    events.push_back({ParseEvent::Type::LEAVE_SCHEME, lno, line, sx, ex, region, scheme});
+  }
+};
+
+/** RegionHandler of the sequential parse, which continues a chunk ended inside a block.
+    Passes events from line @c fromLine into the target handler, and stops the parser
+    at the first chunk boundary outside of any block.
+ */
+class SequentialForwarder : public RegionHandler
+{
+ public:
+  SequentialForwarder(RegionHandler* target, TextParser* parser, const std::vector<int>& boundaries,
+                      std::atomic<int>& sequentialLine, int fromLine)
+      : target(target), parser(parser), boundaries(boundaries), sequentialLine(sequentialLine), fromLine(fromLine)
+  {
+  }
+
+  // index of chunk, where parse was stopped, or -1
+  int stopChunk = -1;
+  size_t lastLine = 0;
+
+  void clearLine(size_t lno, UnicodeString* line) override
+  {
+    if (stopChunk != -1) {
+      return;
+    }
+    if (static_cast<int>(lno) > fromLine) {
+      while (nextBoundary < boundaries.size() && boundaries[nextBoundary] < static_cast<int>(lno)) {
+        nextBoundary++;
+      }
+      if (nextBoundary < boundaries.size() && boundaries[nextBoundary] == static_cast<int>(lno)) {
+        if (depth == 0) {
+          stopChunk = static_cast<int>(nextBoundary);
+          parser->breakParse();
+          return;
+        }
+        sequentialLine = static_cast<int>(lno);
+      }
+    }
+    lastLine = lno;
+    if (static_cast<int>(lno) >= fromLine) {
+      target->clearLine(lno, line);
+    }
+  }
+
+  void addRegion(size_t lno, UnicodeString* line, int sx, int ex, const Region* region) override
+  {
+    if (stopChunk == -1 && static_cast<int>(lno) >= fromLine) {
+      target->addRegion(lno, line, sx, ex, region);
+    }
+  }
+
+  void enterScheme(size_t lno, UnicodeString* line, int sx, int ex, const Region* region, const Scheme* scheme) override
+  {
+    if (stopChunk != -1) {
+      return;
+    }
+    depth++;
+    if (static_cast<int>(lno) >= fromLine) {
+      target->enterScheme(lno, line, sx, ex, region, scheme);
+    }
+  }
+
+  void leaveScheme(size_t lno, UnicodeString* line, int sx, int ex, const Region* region, const Scheme* scheme) override
+  {
+    if (stopChunk != -1) {
+      return;
+    }
+    depth--;
+    if (static_cast<int>(lno) >= fromLine) {
+      target->leaveScheme(lno, line, sx, ex, region, scheme);
+    }
+  }
+
+ private:
+  RegionHandler* target;
+  TextParser* parser;
+  const std::vector<int>& boundaries;
+  std::atomic<int>& sequentialLine;
+  int fromLine;
+  int depth = 0;
+  size_t nextBoundary = 0;
+};
+
+class ParallelTextParser::Impl
+{
+ public:
+  explicit Impl(unsigned int threads_count);
+
+  void setFileType(FileType* type);
+  void setLineSource(LineSource* lh);
+  void setRegionHandler(RegionHandler* rh);
+  void setChunkSize(int lines);
+  void setMaxBlockSize(int max_block_size);
+  int parse(int from, int num);
+
+ private:
+  // minimal number of lines in automatically selected chunk
+  static constexpr int MIN_CHUNK_SIZE = 500;
+  // number of chunks per thread in automatic selection
+  static constexpr int CHUNKS_PER_THREAD = 4;
+
+  unsigned int threads;
+  int chunkSize = 0;
+  int maxBlockSize = 1000;
+  FileType* fileType = nullptr;
+  LineSource* lineSource = nullptr;
+  RegionHandler* regionHandler = nullptr;
+
+  std::vector<std::unique_ptr<ChunkRecorder>> chunks;
+  std::vector<int> boundaries;
+  std::atomic<int> nextChunk {0};
+  // line, already parsed by the sequential parser inside a block
+  std::atomic<int> sequentialLine {-1};
+  std::mutex mutex;
+  std::condition_variable chunkReady;
+
+  void setupParser(TextParser& parser, LineSource* source, RegionHandler* handler) const;
+  void parseChunks(LineSource* source);
+  ChunkRecorder* waitChunk(size_t idx);
+  int parseSequential(size_t idx, int to, size_t& lastLine);
+};
+
+ParallelTextParser::Impl::Impl(unsigned int threads_count) : threads(threads_count)
+{
+  if (threads == 0) {
+    threads = std::thread::hardware_concurrency();
+  }
+  if (threads == 0) {
+    threads = 1;
+  }
+}
+
+void ParallelTextParser::Impl::setFileType(FileType* type)
+{
+  fileType = type;
+}
+
+void ParallelTextParser::Impl::setLineSource(LineSource* lh)
+{
+  lineSource = lh;
+}
+
+void ParallelTextParser::Impl::setRegionHandler(RegionHandler* rh)
+{
+  regionHandler = rh;
+}
+
+void ParallelTextParser::Impl::setChunkSize(int lines)
+{
+  chunkSize = lines < 0 ? 0 : lines;
+}
+
+void ParallelTextParser::Impl::setMaxBlockSize(int max_block_size)
+{
+  maxBlockSize = max_block_size;
+}
+
+void ParallelTextParser::Impl::setupParser(TextParser& parser, LineSource* source, RegionHandler* handler) const
+{
+  parser.setFileType(fileType);
+  parser.setMaxBlockSize(maxBlockSize);
+  parser.setLineSource(source);
+  parser.setRegionHandler(handler);
+}
+
+void ParallelTextParser::Impl::parseChunks(LineSource* source)
+{
+  for (;;) {
+    size_t idx = nextChunk++;
+    if (idx >= chunks.size()) {
+      return;
+    }
+    auto& chunk = *chunks[idx];
+    if (chunk.start <= sequentialLine) {
+      // this part of text is already parsed sequentially
+      chunk.skipped = true;
+    }
+    else {
+      try {
+        TextParser parser;
+        setupParser(parser, source, &chunk);
+        parser.parse(chunk.start, chunk.end - chunk.start, TextParser::TextParseMode::TPM_CACHE_OFF);
+      } catch (...) {
+        chunk.error = std::current_exception();
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      chunk.ready = true;
+    }
+    chunkReady.notify_all();
+  }
+}
+
+ChunkRecorder* ParallelTextParser::Impl::waitChunk(size_t idx)
+{
+  auto* chunk = chunks[idx].get();
+  std::unique_lock<std::mutex> lock(mutex);
+  chunkReady.wait(lock, [chunk] { return chunk->ready; });
+  if (chunk->error) {
+    std::rethrow_exception(chunk->error);
+  }
+  return chunk;
+}
+
+int ParallelTextParser::Impl::parseSequential(size_t idx, int to, size_t& lastLine)
+{
+  // chunk idx-1 started outside of blocks, parse from its start
+  int from = chunks[idx - 1]->start;
+  TextParser parser;
+  SequentialForwarder forwarder(regionHandler, &parser, boundaries, sequentialLine, chunks[idx]->start);
+  ChunkLineSource source(lineSource);
+  setupParser(parser, &source, &forwarder);
+  parser.parse(from, to - from, TextParser::TextParseMode::TPM_CACHE_OFF);
+  if (forwarder.lastLine >= static_cast<size_t>(chunks[idx]->start)) {
+    lastLine = forwarder.lastLine;
+  }
+  return forwarder.stopChunk;
+}
+
+int ParallelTextParser::Impl::parse(int from, int num)
+{
+  if (!regionHandler || !lineSource || !fileType) {
+    return from;
+  }
+
+  int chunk_size = chunkSize;
+  if (chunk_size == 0) {
+    chunk_size = num / static_cast<int>(threads * CHUNKS_PER_THREAD);
+    if (chunk_size < MIN_CHUNK_SIZE) {
+      chunk_size = MIN_CHUNK_SIZE;
+    }
+  }
+  if (threads == 1 || num <= chunk_size) {
+    TextParser parser;
+    setupParser(parser, lineSource, regionHandler);
+    return parser.parse(from, num, TextParser::TextParseMode::TPM_CACHE_OFF);
+  }
+
+  chunks.clear();
+  boundaries.clear();
+  for (int line = from; line < from + num; line += chunk_size) {
+    auto chunk = std::make_unique<ChunkRecorder>();
+    chunk->start = line;
+    chunk->end = line + chunk_size < from + num ? line + chunk_size : from + num;
+    boundaries.push_back(line);
+    chunks.push_back(std::move(chunk));
+  }
+  nextChunk = 0;
+  sequentialLine = -1;
+
+  ChunkLineSource source(lineSource);
+  std::vector<std::thread> workers;
+  auto workers_count = threads < chunks.size() ? threads : static_cast<unsigned int>(chunks.size());
+  // stops workers on any exit from this function
+  auto join_workers = [this, &workers]() {
+    nextChunk = static_cast<int>(chunks.size());
+    for (auto& worker : workers) {
+      worker.join();
+    }
+    workers.clear();
+  };
+  for (unsigned int i = 0; i < workers_count; i++) {
+    workers.emplace_back(&ParallelTextParser::Impl::parseChunks, this, &source);
+  }
+
+  size_t lastLine = from;
+  try {
+    lineSource->startJob(from);
+    regionHandler->startParsing(from);
+
+    size_t idx = 0;
+    bool outside_blocks = true;
+    while (idx < chunks.size()) {
+      if (!outside_blocks) {
+        int stop = parseSequential(idx, from + num, lastLine);
+        if (stop == -1) {
+          break;
+        }
+        idx = stop;
+        outside_blocks = true;
+        continue;
+      }
+      auto* chunk = waitChunk(idx);
+      if (chunk->skipped) {
+        // sequential parser has passed this chunk, so its start
+        // can't be outside of blocks
+        throw Exception("ParallelTextParser: wrong chunk order");
+      }
+      for (const auto& ev : chunk->events) {
+        replayEvent(regionHandler, ev);
+        if (ev.type == ParseEvent::Type::CLEAR_LINE) {
+          lastLine = ev.lno;
+        }
+      }
+      outside_blocks = (chunk->depth == 0);
+      chunk->events.clear();
+      chunk->events.shrink_to_fit();
+      idx++;
+    }
+  } catch (...) {
+    join_workers();
+    chunks.clear();
+    throw;
+  }
+  join_workers();
+  chunks.clear();
+
+  regionHandler->endParsing(lastLine);
+  lineSource->endJob(lastLine);
+  return static_cast<int>(lastLine);
+}
+
+ParallelTextParser::ParallelTextParser(unsigned int threads) : pimpl(spimpl::make_unique_impl<Impl>(threads)) {}
+
+void ParallelTextParser::setFileType(FileType* type)
+{
+  pimpl->setFileType(type);
+}
+
+void ParallelTextParser::setLineSource(LineSource* lh)
+{
+  pimpl->setLineSource(lh);
+}
+
+void ParallelTextParser::setRegionHandler(RegionHandler* rh)
+{
+  pimpl->setRegionHandler(rh);
+}
+
+void ParallelTextParser::setChunkSize(int lines)
+{
+  pimpl->setChunkSize(lines);
+}
+
+void ParallelTextParser::setMaxBlockSize(int max_block_size)
+{
+  pimpl->setMaxBlockSize(max_block_size);
+}
+
+int ParallelTextParser::parse(int from, int num)
+{
+  return pimpl->parse(from, num);
+}
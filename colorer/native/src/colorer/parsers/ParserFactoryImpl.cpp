@@ -14,7 +14,6 @@ ParserFactory::Impl::Impl()
 ParserFactory::Impl::~Impl()
 {
   delete hrc_library;
-  CRegExp::clearRegExpStack();
 }
 
 void ParserFactory::Impl::loadCatalog(const UnicodeString* catalog_path)
@@ -34,6 +33,14 @@ void ParserFactory::Impl::loadCatalog(const UnicodeString* catalog_path)
   }
 
   readCatalog(*base_catalog_path);
+
+  // parsed hrc files are cached, if directory for cache is set
+  auto cache_dir = colorer::Environment::getOSEnv("COLORER_HRC_CACHE");
+  if (cache_dir && !cache_dir->isEmpty()) {
+    COLORER_LOG_DEBUG("hrc cache in %", *cache_dir);
+    hrc_library->setCacheDir(*colorer::Environment::normalizePath(cache_dir.get()));
+  }
+
   COLORER_LOG_DEBUG("start load hrc files");
   // загружаем hrc файлы, прописанные в hrc-sets
   // это могут быть: относительные пути, полные пути, пути до папки с файлами
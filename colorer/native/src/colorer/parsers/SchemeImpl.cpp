@@ -0,0 +1,82 @@
+#include "colorer/parsers/SchemeImpl.h"
+
+static bool canStartWith(const SchemeNode* node, UChar c, bool anyChar)
+{
+  const CRegExp* start = nullptr;
+  switch (node->type) {
+    case SchemeNode::SchemeNodeType::SNT_INHERIT:
+      return true;
+    case SchemeNode::SchemeNodeType::SNT_KEYWORDS: {
+      auto* kw_list = static_cast<const SchemeNodeKeywords*>(node)->kwList.get();
+      if (kw_list->count == 0) {
+        return false;
+      }
+      return anyChar || c >= 256 || kw_list->firstChar->contains(c);
+    }
+    case SchemeNode::SchemeNodeType::SNT_RE:
+      start = static_cast<const SchemeNodeRegexp*>(node)->start.get();
+      break;
+    case SchemeNode::SchemeNodeType::SNT_BLOCK:
+      start = static_cast<const SchemeNodeBlock*>(node)->start.get();
+      break;
+  }
+  const SStartChars* start_chars = start->getStartChars();
+  return anyChar || start_chars == nullptr || start_chars->contains(c);
+}
+
+void SchemeImpl::buildNodeIndex()
+{
+  nodeLists.clear();
+  for (int c = 0; c < 258; c++) {
+    std::vector<SchemeNode*> list;
+    for (const auto& node : nodes) {
+      if (canStartWith(node.get(), static_cast<UChar>(c), c == 257)) {
+        list.push_back(node.get());
+      }
+    }
+    size_t idx = 0;
+    while (idx < nodeLists.size() && nodeLists[idx] != list) {
+      idx++;
+    }
+    if (idx == nodeLists.size()) {
+      nodeLists.push_back(std::move(list));
+    }
+    nodeListIndex[c] = static_cast<uint16_t>(idx);
+  }
+}
+
+bool SchemeImpl::fillFirstChars(SStartChars& chars) const
+{
+  for (const auto& node : nodes) {
+    const CRegExp* start = nullptr;
+    switch (node->type) {
+      case SchemeNode::SchemeNodeType::SNT_INHERIT:
+        continue;
+      case SchemeNode::SchemeNodeType::SNT_KEYWORDS: {
+        auto* kw_list = static_cast<const SchemeNodeKeywords*>(node.get())->kwList.get();
+        if (kw_list->count != 0) {
+          for (int c = 0; c < 256; c++) {
+            if (kw_list->firstChar->contains(static_cast<UChar>(c))) {
+              chars.chars.set(c);
+            }
+          }
+          chars.high = true;
+        }
+        continue;
+      }
+      case SchemeNode::SchemeNodeType::SNT_RE:
+        start = static_cast<const SchemeNodeRegexp*>(node.get())->start.get();
+        break;
+      case SchemeNode::SchemeNodeType::SNT_BLOCK:
+        start = static_cast<const SchemeNodeBlock*>(node.get())->start.get();
+        break;
+    }
+    const SStartChars* start_chars = start->getStartChars();
+    if (start_chars == nullptr) {
+      return false;
+    }
+    chars.chars |= start_chars->chars;
+    chars.high = chars.high || start_chars->high;
+  }
+  return true;
+}
@@ -1,17 +1,34 @@
 #ifndef COLORER_HRCPARSERPELPERS_H
 #define COLORER_HRCPARSERPELPERS_H
 
+#include <atomic>
 #include <memory>
 #include <vector>
 #include "colorer/Scheme.h"
 #include "colorer/TextParser.h"
 #include "colorer/cregexp/cregexp.h"
+#include "colorer/parsers/CharScanner.h"
 #include "colorer/parsers/SchemeNode.h"
 
 class FileType;
+class SchemeImpl;
+
+/** Compiles nodes of scheme on its first use.
+    @ingroup colorer_parsers
+*/
+class SchemePreparer
+{
+ public:
+  /** Compiles regexps and keyword lists of scheme nodes, builds index of nodes
+      and first chars of scheme, if it was not done yet. Must be thread safe.
+  */
+  virtual void prepareScheme(SchemeImpl* scheme) = 0;
+  virtual ~SchemePreparer() = default;
+};
 
 /** Scheme storage implementation.
-    Manages the vector of SchemeNode's.
+    Manages the vector of SchemeNode's and the index of nodes
+    by the first char of text at the parse position.
     @ingroup colorer_parsers
 */
 class SchemeImpl : public Scheme
@@ -35,10 +52,64 @@ class SchemeImpl : public Scheme
   std::vector<std::unique_ptr<SchemeNode>> nodes;
   FileType* fileType = nullptr;
 
-  explicit SchemeImpl(const UnicodeString* sn)
+  // lists of nodes for #getNodes, several chars can share one list
+  std::vector<std::vector<SchemeNode*>> nodeLists;
+  // index in nodeLists for chars 0x00-0xFF, other chars, unknown char
+  uint16_t nodeListIndex[258] = {};
+  // first chars of all nodes, including nodes of inherited and virtual schemes.
+  // nullptr, if scheme can match text from any char. Built by HrcLibrary.
+  // Replaced with std::atomic_store, parsers hold the value taken by std::atomic_load.
+  std::shared_ptr<const CharScanner> firstChars;
+
+  // links of nodes to other schemes are resolved
+  bool linksResolved = false;
+
+  SchemePreparer* preparer = nullptr;
+  // regexps and keyword lists of nodes are compiled
+  bool nodesCompiled = false;
+  // nodes are compiled, index of nodes and first chars are built
+  std::atomic<bool> prepared {false};
+
+  explicit SchemeImpl(const UnicodeString* sn) : nodeLists(1)
   {
     schemeName = std::make_unique<UnicodeString>(*sn);
   }
+
+  /** Prepares scheme for parsing, if it was not prepared yet.
+      Must be called before the use of nodes and first chars of scheme.
+   */
+  void prepare()
+  {
+    if (!prepared.load(std::memory_order_acquire)) {
+      preparer->prepareScheme(this);
+    }
+  }
+
+  /** Builds index of nodes by the first char. Must be called after all nodes are added.
+      Node is excluded from the list of char, only if it can't match text starting
+      with this char. Inherit nodes are always included: they can be
+      replaced by the virtual schemes while parsing.
+  */
+  void buildNodeIndex();
+
+  /** Adds to the set first chars of own nodes of scheme, except inherit nodes.
+      @return false, if some node can match text from any char.
+  */
+  bool fillFirstChars(SStartChars& chars) const;
+
+  /** Nodes, which can match text starting with @c c, in the order of scheme.
+   */
+  [[nodiscard]] const std::vector<SchemeNode*>& getNodes(UChar c) const
+  {
+    return nodeLists[nodeListIndex[c < 256 ? c : 256]];
+  }
+
+  /** All nodes of scheme, used if the first char is unknown.
+   */
+  [[nodiscard]] const std::vector<SchemeNode*>& getNodes() const
+  {
+    return nodeLists[nodeListIndex[257]];
+  }
 };
 
 #endif  // COLORER_HRCPARSERPELPERS_H
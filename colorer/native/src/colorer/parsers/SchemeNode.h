@@ -44,7 +44,9 @@ class SchemeNodeRegexp final : public SchemeNode
 {
  public:
   bool lowPriority = false;
-  std::unique_ptr<CRegExp> start;
+  // text of regexp, until it is compiled
+  uUnicodeString startPattern = nullptr;
+  std::shared_ptr<CRegExp> start;
   const Region* region = nullptr;
   const Region* regions[REGIONS_NUM] = {};
   const Region* regionsn[NAMED_REGIONS_NUM] = {};
@@ -61,8 +63,11 @@ class SchemeNodeBlock final : public SchemeNode
   bool lowContentPriority = false;
   uUnicodeString schemeName = nullptr;
   SchemeImpl* scheme = nullptr;
-  std::unique_ptr<CRegExp> start;
-  std::unique_ptr<CRegExp> end;
+  // text of regexps, until they are compiled
+  uUnicodeString startPattern = nullptr;
+  uUnicodeString endPattern = nullptr;
+  std::shared_ptr<CRegExp> start;
+  std::shared_ptr<CRegExp> end;
   const Region* region = nullptr;
   const Region* regions[REGIONS_NUM] = {};
   const Region* regionsn[NAMED_REGIONS_NUM] = {};
@@ -18,6 +18,11 @@ int TextParser::parse(int from, int num, TextParseMode mode)
   return pimpl->parse(from, num, mode);
 }
 
+bool TextParser::tryParseLine(int lno)
+{
+  return pimpl->tryParseLine(lno);
+}
+
 void TextParser::setFileType(FileType* type)
 {
   pimpl->setFileType(type);
@@ -37,3 +42,8 @@ void TextParser::setMaxBlockSize(int max_block_size)
 {
   pimpl->setMaxBlockSize(max_block_size);
 }
+
+const SRegStats& TextParser::getRegExpStats() const
+{
+  return pimpl->getRegExpStats();
+}
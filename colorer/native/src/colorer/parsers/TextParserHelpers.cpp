@@ -1,4 +1,5 @@
 #include "colorer/parsers/TextParserHelpers.h"
+#include <algorithm>
 
 /////////////////////////////////////////////////////////////////////////
 // parser's cache structures
@@ -29,29 +30,59 @@ ParseCache::~ParseCache()
 
 ParseCache* ParseCache::searchLine(int ln, ParseCache** cache)
 {
-  ParseCache* r1 = nullptr;
-  ParseCache* r2 = nullptr;
-  ParseCache* tmp = this;
   *cache = nullptr;
-  while (tmp) {
-    COLORER_LOG_DEEPTRACE("[TPCache] searchLine() tmp:%,%-%", *tmp->scheme->getName(), tmp->sline, tmp->eline);
-    if (tmp->sline <= ln && tmp->eline >= ln) {
-      if (tmp->children) {
-        r1 = tmp->children->searchLine(ln, &r2);
-      }
-      if (r1) {
-        *cache = r2;
-        return r1;
-      }
-      *cache = r2;  // last child
-      return tmp;
+  if (sline > ln || eline < ln) {
+    return nullptr;
+  }
+  ParseCache* level = this;
+  while (true) {
+    COLORER_LOG_DEEPTRACE("[TPCache] searchLine() level:%,%-%", *level->scheme->getName(), level->sline, level->eline);
+    const auto& index = level->childIndex;
+    // last child, started not after the line
+    auto it = std::upper_bound(index.begin(), index.end(), ln,
+                               [](int line, const ParseCache* child) { return line < child->sline; });
+    if (it == index.begin()) {
+      return level;
     }
-    if (tmp->sline <= ln) {
-      *cache = tmp;
+    ParseCache* child = *(it - 1);
+    if (child->eline < ln) {
+      *cache = child;
+      return level;
     }
-    tmp = tmp->next;
+    level = child;
   }
-  return nullptr;
+}
+
+ParseCache* ParseCache::appendChild()
+{
+  auto* child = new ParseCache;
+  child->parent = this;
+  child->childPos = childIndex.size();
+  if (childIndex.empty()) {
+    children = child;
+  }
+  else {
+    child->prev = childIndex.back();
+    child->prev->next = child;
+  }
+  childIndex.push_back(child);
+  return child;
+}
+
+void ParseCache::truncateChildren(ParseCache* last)
+{
+  ParseCache* first;
+  if (last) {
+    first = last->next;
+    last->next = nullptr;
+    childIndex.resize(last->childPos + 1);
+  }
+  else {
+    first = children;
+    children = nullptr;
+    childIndex.clear();
+  }
+  delete first;
 }
 
 /////////////////////////////////////////////////////////////////////////
@@ -1,6 +1,7 @@
 #ifndef COLORER_TEXTPARSERPELPERS_H
 #define COLORER_TEXTPARSERPELPERS_H
 
+#include <vector>
 #include "colorer/parsers/HrcLibraryImpl.h"
 
 #if !defined COLORERMODE || defined NAMED_MATCHES_IN_HASH
@@ -66,11 +67,13 @@ class ParseCache
   VirtualEntryVector** vcache = nullptr;
 
   /**
-   * RE Match object for start RE of the enwrapped <block> object
+   * RE Match object for start RE of the enwrapped <block> object,
+   * positions are in backLine.
    */
   SMatches matchstart = {};
   /**
-   * Copy of the line with parent's start RE.
+   * Copy of the text of start RE matches, nullptr if the end RE
+   * doesn't refer to them.
    */
   UnicodeString* backLine = nullptr;
 
@@ -85,11 +88,27 @@ class ParseCache
   ~ParseCache();
   /**
    * Searched a cache position for the specified line number.
+   * Children of each level are found by binary search in the index of children.
    * @param ln     Line number to search for
    * @param cache  Cache entry, filled with last child cache entry.
    * @return       Cache entry, assigned to the specified line number
    */
   ParseCache* searchLine(int ln, ParseCache** cache);
+  /**
+   * Creates new child entry after the last child of this entry.
+   */
+  ParseCache* appendChild();
+  /**
+   * Deletes children of this entry, which follow the child @c last.
+   * @param last  Last child to keep, nullptr to delete all children.
+   */
+  void truncateChildren(ParseCache* last);
+
+ private:
+  /** Children in the order of lines, they never overlap */
+  std::vector<ParseCache*> childIndex;
+  /** Position of this entry in the index of parent's children */
+  size_t childPos = 0;
 };
 
 #endif // COLORER_TEXTPARSERPELPERS_H
@@ -1,4 +1,5 @@
 #include "colorer/parsers/TextParserImpl.h"
+#include <algorithm>
 
 TextParser::Impl::Impl()
 {
@@ -68,20 +69,11 @@ int TextParser::Impl::parse(int from, int num, TextParseMode mode)
   COLORER_LOG_DEEPTRACE("[TextParserImpl] parse: cache filled");
 
   do {
-    if (!forward) {
-      if (!parent) {
-        return from;
-      }
-      if (updateCache) {
-        delete parent->children;
-        parent->children = nullptr;
-      }
+    if (!parent) {
+      return from;
     }
-    else {
-      if (updateCache) {
-        delete forward->next;
-        forward->next = nullptr;
-      }
+    if (updateCache) {
+      parent->truncateChildren(forward);
     }
     baseScheme = parent->scheme;
 
@@ -89,7 +81,8 @@ int TextParser::Impl::parse(int from, int num, TextParseMode mode)
     COLORER_LOG_DEEPTRACE("[TextParserImpl] parse: goes into colorize()");
     if (parent != cache) {
       vtlist->restore(parent->vcache);
-      parent->clender->end->setBackTrace(parent->backLine, &parent->matchstart);
+      backLine = parent->backLine;
+      backMatch = &parent->matchstart;
       colorize(parent->clender->end.get(), parent->clender->lowContentPriority);
       vtlist->clear();
     }
@@ -105,6 +98,9 @@ int TextParser::Impl::parse(int from, int num, TextParseMode mode)
     if (parent != cache && current_parse_line < end_line4parse) {
       leaveScheme(current_parse_line, &matchend, parent->clender);
     }
+    else if (lineEndBlocks) {
+      lineEndBlocks->push_back({nullptr, nullptr, {}, {}, nullptr, parent});
+    }
     gx = matchend.e[0];
 
     forward = parent;
@@ -116,6 +112,109 @@ int TextParser::Impl::parse(int from, int num, TextParseMode mode)
   return endLine;
 }
 
+namespace {
+
+// copies the part of line with all matches, positions of matches are moved into this copy
+void copyMatches(const UnicodeString& line, const SMatches& match, UnicodeString& text, SMatches& text_match)
+{
+  int start = match.s[0];
+  int end = match.e[0];
+  auto extend = [&](int s, int e) {
+    if (s != -1 && e != -1) {
+      start = std::min(start, s);
+      end = std::max(end, e);
+    }
+  };
+  for (int i = 1; i < match.cMatch; i++) {
+    extend(match.s[i], match.e[i]);
+  }
+  for (int i = 0; i < match.cnMatch; i++) {
+    extend(match.ns[i], match.ne[i]);
+  }
+  text = UnicodeString(line, start, end - start);
+
+  text_match = match;
+  auto move = [start](int& pos) {
+    if (pos != -1) {
+      pos -= start;
+    }
+  };
+  for (int i = 0; i < match.cMatch; i++) {
+    move(text_match.s[i]);
+    move(text_match.e[i]);
+  }
+  for (int i = 0; i < match.cnMatch; i++) {
+    move(text_match.ns[i]);
+    move(text_match.ne[i]);
+  }
+}
+
+bool sameMatches(const SMatches& match1, const SMatches& match2)
+{
+  if (match1.cMatch != match2.cMatch || match1.cnMatch != match2.cnMatch) {
+    return false;
+  }
+  for (int i = 0; i < match1.cMatch; i++) {
+    if (match1.s[i] != match2.s[i] || match1.e[i] != match2.e[i]) {
+      return false;
+    }
+  }
+  for (int i = 0; i < match1.cnMatch; i++) {
+    if (match1.ns[i] != match2.ns[i] || match1.ne[i] != match2.ne[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool sameVirtual(VirtualEntryVector* const* vcache1, VirtualEntryVector* const* vcache2)
+{
+  if (vcache1 == nullptr || vcache2 == nullptr) {
+    return vcache1 == vcache2;
+  }
+  int i = 0;
+  for (; vcache1[i] != nullptr && vcache1[i] == vcache2[i]; i++) {
+  }
+  return vcache1[i] == vcache2[i];
+}
+
+}  // namespace
+
+bool TextParser::Impl::tryParseLine(int lno)
+{
+  std::vector<OpenBlock> blocks;
+  lineEndBlocks = &blocks;
+  parse(lno, 1, TextParseMode::TPM_CACHE_READ);
+  lineEndBlocks = nullptr;
+  if (breakParsing || blocks.empty()) {
+    return false;
+  }
+
+  /* Blocks, opened at the end of the line, are compared with cached blocks at the start of the next one.
+     Start of the new block can be moved in the line, but the end regexp of block
+     can refer to the text of start matches, so this text must be the same. */
+  ParseCache* next_forward;
+  ParseCache* level = cache->searchLine(lno + 1, &next_forward);
+  for (const auto& block : blocks) {
+    if (level == nullptr) {
+      return false;
+    }
+    if (block.cached) {
+      if (block.cached != level) {
+        return false;
+      }
+    }
+    else if (level->sline != lno + 1 || level->clender != block.node || level->scheme != block.scheme ||
+             !sameVirtual(level->vcache, block.vcache.get()) ||
+             (level->backLine && (*level->backLine != block.backText || !sameMatches(level->matchstart, block.match))))
+    {
+      return false;
+    }
+    level = level->parent;
+  }
+  return level == nullptr;
+}
+
 void TextParser::Impl::initCache()
 {
   delete cache;
@@ -197,74 +296,50 @@ void TextParser::Impl::fillInvisibleSchemes(ParseCache* ch)
 int TextParser::Impl::searchKW(const SchemeNodeKeywords* node, int /*no*/, int lowlen,
                                int /*hilen*/)
 {
-  if (node->kwList->count == 0 || node->kwList->minKeywordLength + gx > lowlen) {
+  const KeywordList* kw_list = node->kwList.get();
+  if (kw_list->count == 0 || kw_list->minKeywordLength + gx > lowlen) {
     return MATCH_NOTHING;
   }
 
-  if (gx < lowlen && !node->kwList->firstChar->contains((*str)[gx])) {
+  if (gx < lowlen && !kw_list->firstChar->contains((*str)[gx])) {
     return MATCH_NOTHING;
   }
 
-  int left = 0;
-  int right = node->kwList->count;
-  while (true) {
-    int pos = left + (right - left) / 2;
-    int kwlen = node->kwList->kwList[pos].keyword->length();
-    if (lowlen < gx + kwlen) {
-      kwlen = lowlen - gx;
-    }
-
-    int8_t compare_result;
-    if (node->kwList->matchCase) {
-      compare_result = node->kwList->kwList[pos].keyword->compare(UnicodeString(*str, gx, kwlen));
+  // from the longest keyword, which starts the text, to the shortest
+  for (int trie_node = kw_list->walk(*str, gx, lowlen); trie_node != 0;
+       trie_node = kw_list->trie[trie_node].parent)
+  {
+    int keyword = kw_list->trie[trie_node].keyword;
+    if (keyword == -1) {
+      continue;
     }
-    else {
-      compare_result =
-          UStr::caseCompare(*node->kwList->kwList[pos].keyword, UnicodeString(*str, gx, kwlen));
-    }
-
-    if (compare_result == 0 && right - left == 1) {
-      bool badbound = false;
-      if (!node->kwList->kwList[pos].isSymbol) {
-        if (!node->worddiv) {
-          // default word bound
-          if ((gx > 0 && (Character::isLetterOrDigit((*str)[gx - 1]) || (*str)[gx - 1] == L'_')) ||
-              (gx + kwlen < lowlen &&
-               (Character::isLetterOrDigit((*str)[gx + kwlen]) || (*str)[gx + kwlen] == L'_')))
-          {
-            badbound = true;
-          }
-        }
-        else {
-          // custom check for word bound
-          if ((gx > 0 && !node->worddiv->contains((*str)[gx - 1])) ||
-              (gx + kwlen < lowlen && !node->worddiv->contains((*str)[gx + kwlen])))
-          {
-            badbound = true;
-          }
+    const KeywordInfo& info = kw_list->kwList[keyword];
+    int kwlen = kw_list->trie[trie_node].depth;
+    bool badbound = false;
+    if (!info.isSymbol) {
+      if (!node->worddiv) {
+        // default word bound
+        if ((gx > 0 && (Character::isLetterOrDigit((*str)[gx - 1]) || (*str)[gx - 1] == L'_')) ||
+            (gx + kwlen < lowlen &&
+             (Character::isLetterOrDigit((*str)[gx + kwlen]) || (*str)[gx + kwlen] == L'_')))
+        {
+          badbound = true;
         }
       }
-      if (!badbound) {
-        COLORER_LOG_DEEPTRACE("[TextParserImpl] KW matched. gx=%, region=%", gx,
-                             node->kwList->kwList[pos].region->getName());
-        addRegion(current_parse_line, gx, gx + kwlen, node->kwList->kwList[pos].region);
-        gx += kwlen;
-        return MATCH_RE;
-      }
-    }
-    if (right - left == 1) {
-      left = node->kwList->kwList[pos].indexOfShorter;
-      if (left != -1) {
-        right = left + 1;
-        continue;
+      else {
+        // custom check for word bound
+        if ((gx > 0 && !node->worddiv->contains((*str)[gx - 1])) ||
+            (gx + kwlen < lowlen && !node->worddiv->contains((*str)[gx + kwlen])))
+        {
+          badbound = true;
+        }
       }
-      break;
-    }
-    if (compare_result == 1) {
-      right = pos;
     }
-    else {  // if (compare_result == 0 || compare_result == -1)
-      left = pos;
+    if (!badbound) {
+      COLORER_LOG_DEEPTRACE("[TextParserImpl] KW matched. gx=%, region=%", gx, info.region->getName());
+      addRegion(current_parse_line, gx, gx + kwlen, info.region);
+      gx += kwlen;
+      return MATCH_RE;
     }
   }
   return MATCH_NOTHING;
@@ -287,6 +362,7 @@ int TextParser::Impl::searchIN(SchemeNodeInherit* node, int no, int lowLen, int
     // ограничений
     bool b = vtlist->push(node);
     // парсим текст по имплементации текущего inherit
+    node->scheme->prepare();
     re_result = searchMatch(node->scheme, no, lowLen, hiLen);
     if (b) {
       // достаем inherit из списка, больше он не нужен
@@ -295,6 +371,7 @@ int TextParser::Impl::searchIN(SchemeNodeInherit* node, int no, int lowLen, int
   }
   else {
     // нашли замену, по ней далее парсим текст
+    ssubst->prepare();
     re_result = searchMatch(ssubst, no, lowLen, hiLen);
     vtlist->popvirt();
   }
@@ -304,7 +381,7 @@ int TextParser::Impl::searchIN(SchemeNodeInherit* node, int no, int lowLen, int
 int TextParser::Impl::searchRE(SchemeNodeRegexp* node, int /*no*/, int lowLen, int hiLen)
 {
   SMatches match {};
-  if (!node->start->parse(str, gx, node->lowPriority ? lowLen : hiLen, &match, schemeStart)) {
+  if (!node->start->parse(regexpContext, str, gx, node->lowPriority ? lowLen : hiLen, &match, schemeStart)) {
     return MATCH_NOTHING;
   }
   COLORER_LOG_DEEPTRACE("[TextParserImpl] RE matched. gx=%", gx);
@@ -335,7 +412,7 @@ int TextParser::Impl::searchBL(SchemeNodeBlock* node, int no, int lowLen, int hi
 
   // проверяем совпадение по регулярному выражению start
   SMatches match {};
-  if (!node->start->parse(str, gx, node->lowPriority ? lowLen : hiLen, &match, schemeStart)) {
+  if (!node->start->parse(regexpContext, str, gx, node->lowPriority ? lowLen : hiLen, &match, schemeStart)) {
     return MATCH_NOTHING;
   }
 
@@ -354,33 +431,29 @@ int TextParser::Impl::searchBL(SchemeNodeBlock* node, int no, int lowLen, int hi
   ParseCache* ResF = nullptr;
   ParseCache* ResP = nullptr;
 
-  auto* backLine = new UnicodeString(*str);
+  /* End regexp with \y \Y refers to the text of start matches. This text is copied,
+     as the line can be changed by the line source, when parser goes to the next lines. */
+  UnicodeString backText;
+  SMatches backTextMatch {};
+  bool back_trace = node->end->hasBackTrace();
+  if (back_trace) {
+    copyMatches(*str, match, backText, backTextMatch);
+  }
   if (updateCache) {
     ResF = forward;
     ResP = parent;
-    if (forward) {
-      forward->next = new ParseCache;
-      forward->next->prev = forward;
-      OldCacheF = forward->next;
-      OldCacheP = parent ? parent : forward->parent;
-      parent = forward->next;
-      forward = nullptr;
-    }
-    else {
-      forward = new ParseCache;
-      parent->children = forward;
-      OldCacheF = forward;
-      OldCacheP = parent;
-      parent = forward;
-      forward = nullptr;
-    }
-    OldCacheF->parent = OldCacheP;
+    OldCacheP = parent;
+    OldCacheF = parent->appendChild();
+    parent = OldCacheF;
+    forward = nullptr;
     OldCacheF->sline = current_parse_line + 1;
     OldCacheF->eline = 0x7FFFFFFF;
     OldCacheF->scheme = ssubst;
-    OldCacheF->matchstart = match;
     OldCacheF->clender = node;
-    OldCacheF->backLine = backLine;
+    if (back_trace) {
+      OldCacheF->matchstart = backTextMatch;
+      OldCacheF->backLine = new UnicodeString(backText);
+    }
   }
 
   // сохраняем текущие значения ...
@@ -389,43 +462,40 @@ int TextParser::Impl::searchBL(SchemeNodeBlock* node, int no, int lowLen, int hi
   auto old_scheme = baseScheme;
   auto old_schemeStart = schemeStart;
   auto old_matchend = matchend;
-
-  // ... переменных регулярного выражения end блока
-  SMatches* old_reg_match;
-  UnicodeString* old_reg_str;
-  auto scheme_end = node->end.get();
-  scheme_end->getBackTrace((const UnicodeString**) &old_reg_str, &old_reg_match);
+  // ... данных для \y \Y регулярного выражения end блока
+  auto old_backLine = backLine;
+  auto old_backMatch = backMatch;
 
   // задаем новые значения
   baseScheme = ssubst;
   schemeStart = gx;
-  scheme_end->setBackTrace(backLine, &match);
+  backLine = back_trace ? &backText : nullptr;
+  backMatch = back_trace ? &backTextMatch : nullptr;
 
   enterScheme(no, &match, node);
-  colorize(scheme_end, node->lowContentPriority);
+  colorize(node->end.get(), node->lowContentPriority);
 
   if (current_parse_line < end_line4parse) {
     leaveScheme(current_parse_line, &matchend, node);
   }
+  else if (lineEndBlocks) {
+    lineEndBlocks->push_back(
+        {node, ssubst, backText, backTextMatch, std::unique_ptr<VirtualEntryVector*[]>(vtlist->store()), nullptr});
+  }
   gx = matchend.e[0];
   /* (empty-block.test) Check if the consumed scheme is zero-length */
   bool zeroLength = (match.s[0] == matchend.e[0] && old_gy == current_parse_line);
 
   // восстанавливаем старые значения
-  scheme_end->setBackTrace(old_reg_str, old_reg_match);
+  backMatch = old_backMatch;
+  backLine = old_backLine;
   matchend = old_matchend;
   schemeStart = old_schemeStart;
   baseScheme = old_scheme;
 
   if (updateCache) {
     if (old_gy == current_parse_line) {
-      delete OldCacheF;
-      if (ResF) {
-        ResF->next = nullptr;
-      }
-      else if (ResP) {
-        ResP->children = nullptr;
-      }
+      OldCacheP->truncateChildren(ResF);
       forward = ResF;
       parent = ResP;
     }
@@ -436,9 +506,6 @@ int TextParser::Impl::searchBL(SchemeNodeBlock* node, int no, int lowLen, int hi
       parent = OldCacheP;
     }
   }
-  else {
-    delete backLine;
-  }
   if (ssubst != node->scheme) {
     vtlist->popvirt();
   }
@@ -458,16 +525,18 @@ int TextParser::Impl::searchMatch(const SchemeImpl* cscheme, int no, int lowLen,
   if (!cscheme) {
     return MATCH_NOTHING;
   }
+  // nodes, which can't match text from the current char, are skipped
+  const auto& nodes = gx < lowLen ? cscheme->getNodes((*str)[gx]) : cscheme->getNodes();
 #ifdef COLORER_USE_DEEPTRACE
   int idx = 0;
 #endif
-  for (auto const& schemeNode : cscheme->nodes) {
+  for (auto* schemeNode : nodes) {
     COLORER_LOG_DEEPTRACE("[TextParserImpl] searchMatch: processing node:%/%, type:%", idx + 1,
-                         cscheme->nodes.size(),
+                         nodes.size(),
                          SchemeNode::schemeNodeTypeNames[static_cast<int>(schemeNode->type)]);
     switch (schemeNode->type) {
       case SchemeNode::SchemeNodeType::SNT_INHERIT: {
-        auto schemeNodeInherit = static_cast<SchemeNodeInherit*>(schemeNode.get());
+        auto schemeNodeInherit = static_cast<SchemeNodeInherit*>(schemeNode);
         int re_result = searchIN(schemeNodeInherit, no, lowLen, hiLen);
         if (re_result != MATCH_NOTHING) {
           return re_result;
@@ -475,21 +544,21 @@ int TextParser::Impl::searchMatch(const SchemeImpl* cscheme, int no, int lowLen,
         break;
       }
       case SchemeNode::SchemeNodeType::SNT_KEYWORDS: {
-        auto schemeNodeKe = static_cast<SchemeNodeKeywords*>(schemeNode.get());
+        auto schemeNodeKe = static_cast<SchemeNodeKeywords*>(schemeNode);
         if (searchKW(schemeNodeKe, no, lowLen, hiLen) == MATCH_RE) {
           return MATCH_RE;
         }
         break;
       }
       case SchemeNode::SchemeNodeType::SNT_RE: {
-        auto schemeNodeRe = static_cast<SchemeNodeRegexp*>(schemeNode.get());
+        auto schemeNodeRe = static_cast<SchemeNodeRegexp*>(schemeNode);
         if (searchRE(schemeNodeRe, no, lowLen, hiLen) == MATCH_RE) {
           return MATCH_RE;
         }
         break;
       }
       case SchemeNode::SchemeNodeType::SNT_BLOCK: {
-        auto schemeNodeBlock = static_cast<SchemeNodeBlock*>(schemeNode.get());
+        auto schemeNodeBlock = static_cast<SchemeNodeBlock*>(schemeNode);
         if (searchBL(schemeNodeBlock, no, lowLen, hiLen) != MATCH_NOTHING) {
           return MATCH_SCHEME;
         }
@@ -512,6 +581,10 @@ bool TextParser::Impl::colorize(CRegExp* root_end_re, bool lowContentPriority)
     return true;
   }
   stackLevel++;
+  // nodes of scheme are compiled on the first entry
+  baseScheme->prepare();
+  // first chars can be replaced by another thread, the taken ones live until return
+  const auto first_chars = std::atomic_load(&baseScheme->firstChars);
 
   for (; current_parse_line < end_line4parse;) {
     COLORER_LOG_DEEPTRACE("[TextParserImpl] colorize: line no %", current_parse_line);
@@ -541,7 +614,7 @@ bool TextParser::Impl::colorize(CRegExp* root_end_re, bool lowContentPriority)
     // searches for the end of parent block
     int res = 0;
     if (root_end_re) {
-      res = root_end_re->parse(str, gx, len, &matchend, schemeStart);
+      res = root_end_re->parse(regexpContext, str, gx, len, &matchend, schemeStart, -1, backLine, backMatch);
     }
     if (!res) {
       matchend.s[0] = matchend.e[0] = gx + maxBlockSize > len ? len : gx + maxBlockSize;
@@ -562,6 +635,10 @@ bool TextParser::Impl::colorize(CRegExp* root_end_re, bool lowContentPriority)
         current_parse_line = end_line4parse;
         break;
       }
+      // skips chars, from which no node of scheme can match text
+      if (first_chars && gx < matchend.s[0] && !first_chars->contains((*str)[gx])) {
+        gx = first_chars->find(*str, gx + 1, matchend.s[0]);
+      }
       int old_current_parse_line = current_parse_line;
       int re_result =
           searchMatch(baseScheme, current_parse_line, matchend.s[0],
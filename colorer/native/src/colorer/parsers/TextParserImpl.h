@@ -23,9 +23,14 @@ class TextParser::Impl
   void setLineSource(LineSource* lh);
   void setRegionHandler(RegionHandler* rh);
   int parse(int from, int num, TextParseMode mode);
+  bool tryParseLine(int lno);
   void breakParse();
   void initCache();
   void setMaxBlockSize(int max_block_size);
+  const SRegStats& getRegExpStats() const
+  {
+    return regexpContext.getStats();
+  }
 
  private:
   UnicodeString* str = nullptr;
@@ -50,12 +55,34 @@ class TextParser::Impl
   SMatches matchend = {};
   VTList* vtlist = nullptr;
 
+  // match-time data for all regexps of this parser
+  MatchContext regexpContext;
+  // string and matches of the current block start, used by \y \Y in the end regexp
+  const UnicodeString* backLine = nullptr;
+  const SMatches* backMatch = nullptr;
+
   LineSource* lineSource = nullptr;
   RegionHandler* regionHandler = nullptr;
 
   // maximum block size of regexp in string line
   int maxBlockSize = 1000;
 
+  /** Block, which is not closed at the end of the line, parsed by tryParseLine.
+      Either new block, opened on this line, or cached one.
+   */
+  struct OpenBlock
+  {
+    const SchemeNodeBlock* node;
+    const SchemeImpl* scheme;
+    // copy of start matches, if the end regexp refers to them
+    UnicodeString backText;
+    SMatches match;
+    std::unique_ptr<VirtualEntryVector*[]> vcache;
+    ParseCache* cached;
+  };
+  // open blocks from the innermost one, collected while tryParseLine works
+  std::vector<OpenBlock>* lineEndBlocks = nullptr;
+
   void fillInvisibleSchemes(ParseCache* cache);
   void addRegion(int lno, int sx, int ex, const Region* region);
   void enterScheme(int lno, int sx, int ex, const Region* region);
@@ -44,3 +44,8 @@ UChar Character::toTitleCase(UChar c)
 {
   return (UChar) u_totitle(c);
 }
+
+UChar Character::foldCase(UChar c)
+{
+  return (UChar) u_foldCase(c, U_FOLD_CASE_DEFAULT);
+}
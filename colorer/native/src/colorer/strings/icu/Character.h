@@ -16,6 +16,8 @@ class Character
   static UChar toLowerCase(UChar c);
   static UChar toUpperCase(UChar c);
   static UChar toTitleCase(UChar c);
+  // simple case folding, used for case insensitive comparison
+  static UChar foldCase(UChar c);
 };
 
 #endif  // COLORER_CHARACTER_H
@@ -109,6 +109,37 @@ void ParsedLineWriter::htmlRGBWrite(Writer* markupWriter, Writer* textWriter,
   }
 }
 
+void ParsedLineWriter::htmlRGBWrite(Writer* markupWriter, Writer* textWriter,
+                                    std::unordered_map<UnicodeString, UnicodeString*>* docLinkHash,
+                                    const UnicodeString* line, const FlatLineRegions& lineRegions)
+{
+  int pos = 0;
+  for (auto l1 : lineRegions) {
+    if (l1.special() || l1.rdef() == nullptr)
+      continue;
+    if (l1.start() == l1.end())
+      continue;
+    int end = l1.end();
+    if (end == -1)
+      end = line->length();
+    if (l1.start() > pos) {
+      textWriter->write(line, pos, l1.start() - pos);
+      pos = l1.start();
+    }
+    if (!docLinkHash->empty())
+      writeHref(markupWriter, docLinkHash, l1.scheme(), UnicodeString(*line, pos, end - l1.start()), true);
+    writeStart(markupWriter, l1.styled());
+    textWriter->write(line, pos, end - l1.start());
+    writeEnd(markupWriter, l1.styled());
+    if (!docLinkHash->empty())
+      writeHref(markupWriter, docLinkHash, l1.scheme(), UnicodeString(*line, pos, end - l1.start()), false);
+    pos += end - l1.start();
+  }
+  if (pos < line->length()) {
+    textWriter->write(line, pos, line->length() - pos);
+  }
+}
+
 void ParsedLineWriter::writeStyle(Writer* writer, const StyledRegion* lr)
 {
   static char span[256];
@@ -3,6 +3,7 @@
 
 #include <unordered_map>
 #include "colorer/handlers/LineRegion.h"
+#include "colorer/handlers/LineRegionsFlatSupport.h"
 #include "colorer/io/Writer.h"
 /**
     Static service methods of LineRegion output.
@@ -49,6 +50,12 @@ class ParsedLineWriter
   static void htmlRGBWrite(Writer* markupWriter, Writer* textWriter, std::unordered_map<UnicodeString, UnicodeString*>* docLinkHash,
                            const UnicodeString* line, LineRegion* lineRegions);
 
+  /** Write specified line of text using regions of LineRegionsFlatSupport.
+      Output is the same, as of htmlRGBWrite for LineRegion list.
+  */
+  static void htmlRGBWrite(Writer* markupWriter, Writer* textWriter, std::unordered_map<UnicodeString, UnicodeString*>* docLinkHash,
+                           const UnicodeString* line, const FlatLineRegions& lineRegions);
+
   /** Puts into stream style attributes from RegionDefine object.
    */
   static void writeStyle(Writer* writer, const StyledRegion* lr);
@@ -11,17 +11,14 @@ TextLinesStore::~TextLinesStore()
 void TextLinesStore::freeFile()
 {
   fileName.reset();
-  for (auto it : lines) {
-    delete it;
-  }
   lines.clear();
+  text = UnicodeString();
 }
 
 void TextLinesStore::loadFile(const UnicodeString* inFileName, bool tab2spaces)
 {
-  if (this->fileName) {
-    freeFile();
-  }
+  // lines refer to the text of previous file
+  freeFile();
 
   uUnicodeString file;
 
@@ -50,20 +47,27 @@ void TextLinesStore::loadFile(const UnicodeString* inFileName, bool tab2spaces)
     file = Encodings::toUnicodeString((char*) data, (int32_t) is->length());
     delete is;
   }
+  text = std::move(*file);
+  const UnicodeString& source = text;
 
-  auto length = file->length();
+  auto length = source.length();
   lines.reserve(static_cast<size_t>(length / 30));  // estimate number of lines
 
   int filepos = 0;
   int prevpos = 0;
 
   while (filepos < length + 1) {
-    if (filepos == length || (*file)[filepos] == '\r' || (*file)[filepos] == '\n') {
-      lines.push_back(new UnicodeString(*file, prevpos, filepos - prevpos));
+    if (filepos == length || source[filepos] == '\r' || source[filepos] == '\n') {
+#ifdef COLORER_FEATURE_ICU
+      // read-only alias of the part of text buffer
+      lines.emplace_back(false, source.getBuffer() + prevpos, filepos - prevpos);
+#else
+      lines.emplace_back(source, prevpos, filepos - prevpos);
+#endif
       if (tab2spaces) {
         replaceTabs(lines.size() - 1);
       }
-      if (filepos + 1 < length && (*file)[filepos] == '\r' && (*file)[filepos + 1] == '\n') {
+      if (filepos + 1 < length && source[filepos] == '\r' && source[filepos + 1] == '\n') {
         filepos++;
       }
       prevpos = filepos + 1;
@@ -82,7 +86,7 @@ UnicodeString* TextLinesStore::getLine(size_t lno)
   if (lines.size() <= lno) {
     return nullptr;
   }
-  return lines[lno];
+  return &lines[lno];
 }
 
 size_t TextLinesStore::getLineCount() const
@@ -92,5 +96,5 @@ size_t TextLinesStore::getLineCount() const
 
 void TextLinesStore::replaceTabs(size_t lno)
 {
-  lines.at(lno)->findAndReplace("\t", "    ");
+  lines.at(lno).findAndReplace("\t", "    ");
 }
\ No newline at end of file
@@ -7,6 +7,8 @@
 /** Reads array of text lines and
     makes it accessible with LineSource interface.
     All lines should be separated with \\r\\n , \\n or \\r characters.
+    Text is decoded into one buffer, lines refer to it and are copied
+    only if they are changed (ICU strings).
 
     @ingroup colorer_viewer
 */
@@ -18,8 +20,13 @@ public:
   */
   TextLinesStore()=default;
   ~TextLinesStore() override;
+  // lines refer to the buffer of text, so the store is not copied or moved
+  TextLinesStore(TextLinesStore&&) = delete;
+  TextLinesStore(const TextLinesStore&) = delete;
+  TextLinesStore& operator=(const TextLinesStore&) = delete;
+  TextLinesStore& operator=(TextLinesStore&&) = delete;
 
-  /** Loads specified file into vector of strings.
+  /** Loads specified file.
       @param inFileName File to load.
       @param tab2spaces Points, if we have to convert all tabs in file into spaces.
   */
@@ -36,7 +43,8 @@ protected:
   */
   void freeFile();
 private:
-  std::vector<UnicodeString *> lines;
+  UnicodeString text;
+  std::vector<UnicodeString> lines;
   uUnicodeString fileName;
   void replaceTabs(size_t lno);
 
@@ -0,0 +1,302 @@
+#include "colorer/xml/XmlCache.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include "colorer/utils/Environment.h"
+
+/*
+  Format of cache file, all numbers are in the byte order of the machine:
+    magic, version, byte order mark, path of the document
+    count of source files, for each: path, size, modification time, hash of content
+    count of root nodes, for each node: name, text,
+      count of attributes, for each: name, value
+      count of children, children nodes
+  Strings are stored as length and UTF-16 code units.
+*/
+
+namespace {
+
+const char CACHE_MAGIC[8] = {'C', 'L', 'R', 'X', 'M', 'L', 'C', '\0'};
+// must be increased with any change of the format
+const uint32_t CACHE_VERSION = 2;
+const uint32_t CACHE_BYTE_ORDER = 0x01020304;
+
+uint64_t hashBytes(const char* data, size_t size)
+{
+  // FNV-1a
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < size; i++) {
+    hash ^= static_cast<unsigned char>(data[i]);
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+bool getFileStamp(const fs::path& path, uint64_t& size, uint64_t& mtime)
+{
+  std::error_code ec;
+  size = fs::file_size(path, ec);
+  if (ec) {
+    return false;
+  }
+  auto time = fs::last_write_time(path, ec);
+  if (ec) {
+    return false;
+  }
+  mtime = static_cast<uint64_t>(time.time_since_epoch().count());
+  return true;
+}
+
+bool readFile(const fs::path& path, std::vector<char>& data)
+{
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file) {
+    return false;
+  }
+  auto size = file.tellg();
+  if (size < 0) {
+    return false;
+  }
+  data.resize(static_cast<size_t>(size));
+  file.seekg(0);
+  file.read(data.data(), size);
+  return static_cast<bool>(file);
+}
+
+class CacheWriter
+{
+ public:
+  std::vector<char> data;
+
+  void write(const void* src, size_t size)
+  {
+    const auto* bytes = static_cast<const char*>(src);
+    data.insert(data.end(), bytes, bytes + size);
+  }
+
+  void writeInt(uint32_t value)
+  {
+    write(&value, sizeof(value));
+  }
+
+  void writeLong(uint64_t value)
+  {
+    write(&value, sizeof(value));
+  }
+
+  void writeString(const UnicodeString& str)
+  {
+    auto len = static_cast<uint32_t>(str.length());
+    writeInt(len);
+    for (uint32_t i = 0; i < len; i++) {
+      UChar c = str[static_cast<int32_t>(i)];
+      write(&c, sizeof(c));
+    }
+  }
+
+  void writeNode(const XMLNode& node)
+  {
+    writeString(node.name);
+    writeString(node.text);
+    writeInt(static_cast<uint32_t>(node.attributes.size()));
+    for (const auto& [name, value] : node.attributes) {
+      writeString(name);
+      writeString(value);
+    }
+    writeInt(static_cast<uint32_t>(node.children.size()));
+    for (const auto& child : node.children) {
+      writeNode(child);
+    }
+  }
+};
+
+class CacheReader
+{
+ public:
+  explicit CacheReader(const std::vector<char>& data_) : data(data_) {}
+
+  bool ok = true;
+
+  bool read(void* dest, size_t size)
+  {
+    if (!ok || data.size() - pos < size) {
+      ok = false;
+      return false;
+    }
+    memcpy(dest, data.data() + pos, size);
+    pos += size;
+    return true;
+  }
+
+  uint32_t readInt()
+  {
+    uint32_t value = 0;
+    read(&value, sizeof(value));
+    return value;
+  }
+
+  uint64_t readLong()
+  {
+    uint64_t value = 0;
+    read(&value, sizeof(value));
+    return value;
+  }
+
+  UnicodeString readString()
+  {
+    uint32_t len = readInt();
+    if (!ok || (data.size() - pos) / sizeof(UChar) < len) {
+      ok = false;
+      return {};
+    }
+    buffer.resize(len);
+    read(buffer.data(), len * sizeof(UChar));
+    return {buffer.data(), static_cast<int32_t>(len)};
+  }
+
+  void readNode(XMLNode& node)
+  {
+    node.name = readString();
+    node.text = readString();
+    uint32_t attr_count = readInt();
+    for (uint32_t i = 0; i < attr_count && ok; i++) {
+      UnicodeString name = readString();
+      node.attributes.try_emplace(name, readString());
+    }
+    uint32_t child_count = readInt();
+    for (uint32_t i = 0; i < child_count && ok; i++) {
+      node.children.emplace_back();
+      readNode(node.children.back());
+    }
+  }
+
+  [[nodiscard]] bool atEnd() const
+  {
+    return pos == data.size();
+  }
+
+ private:
+  const std::vector<char>& data;
+  size_t pos = 0;
+  std::vector<UChar> buffer;
+};
+
+}  // namespace
+
+XmlCache::XmlCache(const UnicodeString& cache_dir_) : cache_dir(colorer::Environment::to_filepath(&cache_dir_)) {}
+
+fs::path XmlCache::getCacheFile(const UnicodeString& source_path) const
+{
+  CacheWriter name;
+  name.writeString(source_path);
+  char file_name[32];
+  snprintf(file_name, sizeof(file_name), "%016llx.xmlc",
+           static_cast<unsigned long long>(hashBytes(name.data.data(), name.data.size())));
+  return cache_dir / file_name;
+}
+
+bool XmlCache::load(const UnicodeString& source_path, std::list<XMLNode>& nodes) const
+{
+  std::vector<char> data;
+  if (!readFile(getCacheFile(source_path), data)) {
+    return false;
+  }
+  CacheReader reader(data);
+  char magic[sizeof(CACHE_MAGIC)];
+  reader.read(magic, sizeof(magic));
+  if (!reader.ok || memcmp(magic, CACHE_MAGIC, sizeof(magic)) != 0 || reader.readInt() != CACHE_VERSION ||
+      reader.readInt() != CACHE_BYTE_ORDER)
+  {
+    return false;
+  }
+  // cache files of different documents can have the same name
+  if (reader.readString() != source_path || !reader.ok) {
+    return false;
+  }
+
+  uint32_t file_count = reader.readInt();
+  std::vector<char> content;
+  for (uint32_t i = 0; i < file_count && reader.ok; i++) {
+    UnicodeString path = reader.readString();
+    uint64_t size = reader.readLong();
+    uint64_t mtime = reader.readLong();
+    uint64_t hash = reader.readLong();
+    if (!reader.ok) {
+      break;
+    }
+    // content is read only for files, which were touched after the cache was written
+    auto file_path = colorer::Environment::to_filepath(&path);
+    uint64_t file_size = 0;
+    uint64_t file_mtime = 0;
+    if (!getFileStamp(file_path, file_size, file_mtime) || file_size != size ||
+        (file_mtime != mtime &&
+         (!readFile(file_path, content) || content.size() != size || hashBytes(content.data(), content.size()) != hash)))
+    {
+      COLORER_LOG_DEBUG("cache of '%' is out of date", source_path);
+      return false;
+    }
+  }
+
+  std::list<XMLNode> cached;
+  uint32_t node_count = reader.readInt();
+  for (uint32_t i = 0; i < node_count && reader.ok; i++) {
+    cached.emplace_back();
+    reader.readNode(cached.back());
+  }
+  if (!reader.ok || !reader.atEnd()) {
+    COLORER_LOG_WARN("broken cache file for '%'", source_path);
+    return false;
+  }
+  nodes.splice(nodes.end(), cached);
+  return true;
+}
+
+void XmlCache::save(const UnicodeString& source_path, const std::vector<UnicodeString>& files,
+                    const std::list<XMLNode>& nodes) const
+{
+  CacheWriter writer;
+  writer.write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+  writer.writeInt(CACHE_VERSION);
+  writer.writeInt(CACHE_BYTE_ORDER);
+  writer.writeString(source_path);
+
+  writer.writeInt(static_cast<uint32_t>(files.size()));
+  std::vector<char> content;
+  for (const auto& file : files) {
+    // time is taken before the read, so change during the read makes the cache out of date
+    auto file_path = colorer::Environment::to_filepath(&file);
+    uint64_t size = 0;
+    uint64_t mtime = 0;
+    if (!getFileStamp(file_path, size, mtime) || !readFile(file_path, content)) {
+      return;
+    }
+    writer.writeString(file);
+    writer.writeLong(content.size());
+    writer.writeLong(mtime);
+    writer.writeLong(hashBytes(content.data(), content.size()));
+  }
+
+  writer.writeInt(static_cast<uint32_t>(nodes.size()));
+  for (const auto& node : nodes) {
+    writer.writeNode(node);
+  }
+
+  // file is renamed after write, so other process never reads partially written cache
+  std::error_code ec;
+  fs::create_directories(cache_dir, ec);
+  auto cache_file = getCacheFile(source_path);
+  auto temp_file = cache_file;
+  temp_file += ".tmp";
+  {
+    std::ofstream out(temp_file, std::ios::binary | std::ios::trunc);
+    out.write(writer.data.data(), static_cast<std::streamsize>(writer.data.size()));
+    if (!out) {
+      COLORER_LOG_WARN("can't write cache file for '%'", source_path);
+      return;
+    }
+  }
+  fs::rename(temp_file, cache_file, ec);
+  if (ec) {
+    fs::remove(temp_file, ec);
+  }
+}
@@ -0,0 +1,39 @@
+#ifndef COLORER_XMLCACHE_H
+#define COLORER_XMLCACHE_H
+
+#include <list>
+#include <vector>
+#include "colorer/utils/FileSystems.h"
+#include "colorer/xml/XMLNode.h"
+
+/** Cache of parsed xml documents in binary files.
+    Cache file keeps the path and nodes of the document and the list of files,
+    read by the parser (document itself and its external entities), with their
+    sizes, modification times and hashes. Content of a file is hashed again only
+    if its modification time was changed. Cache file is used only if the version
+    of its format is the current one and none of these files was changed,
+    otherwise document is parsed again and cache file is rewritten.
+*/
+class XmlCache
+{
+ public:
+  explicit XmlCache(const UnicodeString& cache_dir);
+
+  /** Reads nodes of the document @c source_path from the cache.
+      @return false, if there is no valid cache file for this document.
+   */
+  bool load(const UnicodeString& source_path, std::list<XMLNode>& nodes) const;
+
+  /** Writes nodes of the document @c source_path into the cache.
+      @param files Files, which content was used to build the nodes.
+   */
+  void save(const UnicodeString& source_path, const std::vector<UnicodeString>& files,
+            const std::list<XMLNode>& nodes) const;
+
+ private:
+  fs::path cache_dir;
+
+  [[nodiscard]] fs::path getCacheFile(const UnicodeString& source_path) const;
+};
+
+#endif  // COLORER_XMLCACHE_H
@@ -1,8 +1,8 @@
 #include "colorer/xml/XmlReader.h"
 
-XmlReader::XmlReader(const XmlInputSource& xml_input_source)
+XmlReader::XmlReader(const XmlInputSource& xml_input_source, const XmlCache* cache)
+    : input_source(&xml_input_source), xml_cache(cache)
 {
-  input_source = &xml_input_source;
 }
 
 XmlReader::~XmlReader()
@@ -12,11 +12,26 @@ XmlReader::~XmlReader()
 
 bool XmlReader::parse()
 {
+  if (xml_cache && xml_cache->load(input_source->getPath(), cached_nodes)) {
+    from_cache = true;
+    return true;
+  }
   xml_reader = new LibXmlReader(*input_source);
   return xml_reader->isParsed();
 }
 
-void XmlReader::getNodes(std::list<XMLNode>& nodes) const
+void XmlReader::getNodes(std::list<XMLNode>& nodes)
 {
+  if (from_cache) {
+    nodes.splice(nodes.end(), cached_nodes);
+    return;
+  }
+  if (xml_cache && !xml_reader->getSourceFiles().empty()) {
+    std::list<XMLNode> parsed;
+    xml_reader->parse(parsed);
+    xml_cache->save(input_source->getPath(), xml_reader->getSourceFiles(), parsed);
+    nodes.splice(nodes.end(), parsed);
+    return;
+  }
   xml_reader->parse(nodes);
-}
\ No newline at end of file
+}
@@ -2,20 +2,27 @@
 #define COLORER_XMLREADER_H
 
 #include "colorer/xml/XMLNode.h"
+#include "colorer/xml/XmlCache.h"
 #include "colorer/xml/XmlInputSource.h"
 #include "libxml2/LibXmlReader.h"
 
 class XmlReader
 {
  public:
-  explicit XmlReader(const XmlInputSource& xml_input_source);
+  /** @param cache Cache of parsed documents, if it is not null, document is
+             read from it, when cache is up to date, and is saved to it otherwise.
+   */
+  explicit XmlReader(const XmlInputSource& xml_input_source, const XmlCache* cache = nullptr);
   ~XmlReader();
   bool parse();
-  void getNodes(std::list<XMLNode>& nodes) const;
+  void getNodes(std::list<XMLNode>& nodes);
 
  private:
   const XmlInputSource* input_source;
+  const XmlCache* xml_cache;
   LibXmlReader* xml_reader = nullptr;
+  std::list<XMLNode> cached_nodes;
+  bool from_cache = false;
 };
 
 #endif  // COLORER_XMLREADER_H
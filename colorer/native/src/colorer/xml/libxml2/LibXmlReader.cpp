@@ -2,6 +2,7 @@
 #include <libxml/parserInternals.h>
 #include <cstring>
 #include <fstream>
+#include <mutex>
 #include "colorer/Exception.h"
 #include "colorer/base/BaseNames.h"
 #include "colorer/utils/Environment.h"
@@ -14,103 +15,152 @@
 #define strdup(p) _strdup(p)
 #endif
 
-uUnicodeString LibXmlReader::current_file = nullptr;
-bool LibXmlReader::is_first_call = false;
+thread_local uUnicodeString LibXmlReader::current_file = nullptr;
+thread_local bool LibXmlReader::is_first_call = false;
+thread_local std::vector<UnicodeString> LibXmlReader::loaded_files;
+thread_local bool LibXmlReader::loaded_only_files = true;
 
 LibXmlReader::LibXmlReader(const UnicodeString& source_file)
 {
-  xmlSetExternalEntityLoader(xmlMyExternalEntityLoader);
+  // global settings of libxml are changed once, before any parsing
+  static std::once_flag init_flag;
+  std::call_once(init_flag, []() {
+    xmlInitParser();
+    xmlSetExternalEntityLoader(xmlMyExternalEntityLoader);
+  });
+  // error handler is set for each thread
   xmlSetGenericErrorFunc(nullptr, xml_error_func);
 
   current_file = std::make_unique<UnicodeString>(source_file);
   is_first_call = true;
+  loaded_files.clear();
+  loaded_only_files = true;
 
   // you can pass any string for the file name, it can be processed/converted into xml by MyExternalEntityLoader
-  xmldoc = xmlReadFile(UStr::to_stdstr(&source_file).c_str(), nullptr, XML_PARSE_NOENT | XML_PARSE_NONET);
+  xmlParserInputBufferPtr input = nullptr;
+  xmlTextReaderPtr reader = createReader(source_file, input);
+  if (reader != nullptr) {
+    parsed = readNodes(reader);
+    xmlFreeTextReader(reader);
+  }
+  if (input != nullptr) {
+    xmlFreeParserInputBuffer(input);
+  }
+  if (!parsed) {
+    document_nodes.clear();
+  }
+  if (loaded_only_files) {
+    source_files = std::move(loaded_files);
+  }
+  loaded_files.clear();
 }
 
 LibXmlReader::LibXmlReader(const XmlInputSource& source) : LibXmlReader(source.getPath()) {}
 
 LibXmlReader::~LibXmlReader()
 {
-  if (xmldoc != nullptr) {
-    xmlFreeDoc(xmldoc);
-  }
   current_file.reset();
 }
 
-void LibXmlReader::parse(std::list<XMLNode>& nodes)
+xmlTextReaderPtr LibXmlReader::createReader(const UnicodeString& source_file, xmlParserInputBufferPtr& input)
 {
-  xmlNode* current = xmlDocGetRootElement(xmldoc);
-  while (current != nullptr) {
-    XMLNode result;
-    populateNode(current, result);
-    nodes.push_back(result);
-    current = current->next;
+  // document is opened by the same loader, as its external entities, so it can be in jar or in env: path
+  xmlParserCtxtPtr ctxt = xmlNewParserCtxt();
+  if (ctxt == nullptr) {
+    return nullptr;
   }
-}
-
-bool LibXmlReader::populateNode(xmlNode* node, XMLNode& result)
-{
-  if (node->type == XML_ELEMENT_NODE) {
-    result.name = UnicodeString(reinterpret_cast<const char*>(node->name));
-
-    const auto text_string = getElementText(node);
-    if (text_string && !text_string->isEmpty()) {
-      result.text = UnicodeString(*text_string.get());
-    }
-    getChildren(node, result);
-    getAttributes(node, result.attributes);
+  xmlParserInputPtr stream = xmlMyExternalEntityLoader(UStr::to_stdstr(&source_file).c_str(), nullptr, ctxt);
+  if (stream == nullptr) {
+    xmlFreeParserCtxt(ctxt);
+    return nullptr;
+  }
+  // buffer of stream is passed to reader, its url is the base for relative paths of entities
+  input = stream->buf;
+  stream->buf = nullptr;
+  std::string url = stream->filename != nullptr ? stream->filename : UStr::to_stdstr(&source_file);
+  xmlFreeInputStream(stream);
+  xmlFreeParserCtxt(ctxt);
 
-    return true;
+  xmlTextReaderPtr reader = xmlNewTextReader(input, url.c_str());
+  if (reader == nullptr) {
+    return nullptr;
+  }
+  if (xmlTextReaderSetup(reader, nullptr, nullptr, nullptr, XML_PARSE_NOENT | XML_PARSE_NONET) != 0) {
+    xmlFreeTextReader(reader);
+    return nullptr;
   }
-  return false;
+  return reader;
 }
 
-uUnicodeString LibXmlReader::getElementText(const xmlNode* node)
+bool LibXmlReader::readNodes(xmlTextReaderPtr reader)
 {
-  for (const xmlNode* child = node->children; child != nullptr; child = child->next) {
-    if (child->type == XML_CDATA_SECTION_NODE) {
-      return Encodings::fromUTF8(child->content);
-    }
-    if (child->type == XML_TEXT_NODE) {
-      auto temp_string = Encodings::fromUTF8(child->content);
-      temp_string->trim();
-      if (temp_string->isEmpty()) {
-        continue;
+  // elements, which end is not read yet, and flag of found text for each of them
+  std::vector<XMLNode*> open_nodes;
+  std::vector<bool> text_found;
+  int ret;
+  while ((ret = xmlTextReaderRead(reader)) == 1) {
+    switch (xmlTextReaderNodeType(reader)) {
+      case XML_READER_TYPE_ELEMENT: {
+        auto& siblings = open_nodes.empty() ? document_nodes : open_nodes.back()->children;
+        auto& node = siblings.emplace_back();
+        node.name = UnicodeString(reinterpret_cast<const char*>(xmlTextReaderConstLocalName(reader)));
+        bool is_empty = xmlTextReaderIsEmptyElement(reader) == 1;
+        getAttributes(reader, node.attributes);
+        if (!is_empty) {
+          open_nodes.push_back(&node);
+          text_found.push_back(false);
+        }
+        break;
+      }
+      case XML_READER_TYPE_END_ELEMENT:
+        if (!open_nodes.empty()) {
+          open_nodes.pop_back();
+          text_found.pop_back();
+        }
+        break;
+      case XML_READER_TYPE_CDATA:
+      case XML_READER_TYPE_TEXT: {
+        // text of element is its first CDATA section or first not blank text
+        if (open_nodes.empty() || text_found.back()) {
+          break;
+        }
+        const xmlChar* value = xmlTextReaderConstValue(reader);
+        if (value == nullptr) {
+          break;
+        }
+        auto text = Encodings::fromUTF8(const_cast<xmlChar*>(value));
+        if (xmlTextReaderNodeType(reader) == XML_READER_TYPE_TEXT) {
+          text->trim();
+          if (text->isEmpty()) {
+            break;
+          }
+        }
+        open_nodes.back()->text = *text;
+        text_found.back() = true;
+        break;
       }
-      return temp_string;
+      default:
+        break;
     }
   }
-  return nullptr;
+  return ret == 0;
 }
 
-void LibXmlReader::getChildren(xmlNode* node, XMLNode& result)
+void LibXmlReader::parse(std::list<XMLNode>& nodes)
 {
-  if (node->children == nullptr) {
-    return;
-  }
-  node = node->children;
-
-  while (node != nullptr) {
-    if (!xmlIsBlankNode(node)) {
-      XMLNode child;
-      if (populateNode(node, child)) {
-        result.children.push_back(child);
-      }
-    }
-    node = node->next;
-  }
+  nodes.splice(nodes.end(), document_nodes);
 }
 
-void LibXmlReader::getAttributes(const xmlNode* node, std::unordered_map<UnicodeString, UnicodeString>& data)
+void LibXmlReader::getAttributes(xmlTextReaderPtr reader, std::unordered_map<UnicodeString, UnicodeString>& data)
 {
-  for (xmlAttrPtr attr = node->properties; attr != nullptr; attr = attr->next) {
-    const auto content = xmlNodeGetContent(attr->children);
-    auto decoded_string = Encodings::fromUTF8(content);
-    data.try_emplace(reinterpret_cast<const char*>(attr->name), *decoded_string.get());
-    xmlFree(content);
+  while (xmlTextReaderMoveToNextAttribute(reader) == 1) {
+    if (xmlTextReaderIsNamespaceDecl(reader) == 1) {
+      continue;
+    }
+    auto decoded_string = Encodings::fromUTF8(const_cast<xmlChar*>(xmlTextReaderConstValue(reader)));
+    data.try_emplace(reinterpret_cast<const char*>(xmlTextReaderConstLocalName(reader)), std::move(*decoded_string));
   }
+  xmlTextReaderMoveToElement(reader);
 }
 
 #ifdef COLORER_FEATURE_ZIPINPUTSOURCE
@@ -119,7 +169,7 @@ xmlParserInputPtr LibXmlReader::xmlZipEntityLoader(const PathInJar& paths, xmlPa
   const auto is = SharedXmlInputSource::getSharedInputSource(paths.path_to_jar);
   is->open();
 
-  const auto unzipped_stream = unzip(is->getSrc(), is->getSize(), paths.path_in_jar);
+  const auto unzipped_stream = unzip(is->getSrc(), is->getSize(), paths.path_in_jar, is->getZipIndex());
 
   xmlParserInputBufferPtr buf =
       xmlParserInputBufferCreateMem(reinterpret_cast<const char*>(unzipped_stream->data()),
@@ -160,6 +210,7 @@ xmlParserInputPtr LibXmlReader::xmlMyExternalEntityLoader(const char* URL, const
   if (string_url.startsWith(jar) || current_file->startsWith(jar)) {
     const auto paths = LibXmlInputSource::getFullPathsToZip(string_url, is_first_call ? nullptr : current_file.get());
     is_first_call = false;
+    loaded_only_files = false;
     xmlParserInputPtr ret = nullptr;
     try {
       ret = xmlZipEntityLoader(paths, ctxt);
@@ -180,14 +231,20 @@ xmlParserInputPtr LibXmlReader::xmlMyExternalEntityLoader(const char* URL, const
   is_first_call = false;
   // read it as a regular file
   xmlParserInputPtr ret = xmlNewInputFromFile(ctxt, UStr::to_stdstr(&string_url).c_str());
+  if (ret != nullptr) {
+    loaded_files.push_back(string_url);
+  }
+  else {
+    loaded_only_files = false;
+  }
 
   return ret;
 }
 
 void LibXmlReader::xml_error_func(void* /*ctx*/, const char* msg, ...)
 {
-  static char buf[4096];
-  static int slen = 0;
+  thread_local char buf[4096];
+  thread_local int slen = 0;
   va_list args;
 
   /* libxml2 prints IO errors from bad includes paths by
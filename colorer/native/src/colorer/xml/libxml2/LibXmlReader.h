@@ -2,11 +2,16 @@
 #define COLORER_LIBXMLREADER_H
 
 #include <libxml/parser.h>
-#include <libxml/tree.h>
+#include <libxml/xmlreader.h>
 #include <list>
+#include <vector>
 #include "colorer/xml/XMLNode.h"
 #include "colorer/xml/XmlInputSource.h"
 
+/** Reader of xml document into XMLNode tree.
+    Document is read by libxml2 xmlTextReader, so the whole libxml2 tree of
+    the document is never built, nodes are created directly from the stream.
+*/
 class LibXmlReader
 {
  public:
@@ -14,28 +19,44 @@ class LibXmlReader
 
   ~LibXmlReader();
 
+  /** Moves nodes of the document to the end of @c nodes.
+   */
   void parse(std::list<XMLNode>& nodes);
 
   [[nodiscard]]
   bool isParsed() const
   {
-    return xmldoc != nullptr;
+    return parsed;
+  }
+
+  /** Files, read while parsing: the document and its external entities.
+      Empty, if some of them was not a regular file.
+  */
+  [[nodiscard]]
+  const std::vector<UnicodeString>& getSourceFiles() const
+  {
+    return source_files;
   }
 
  private:
 
-  xmlDocPtr xmldoc {nullptr};
+  bool parsed = false;
+  std::list<XMLNode> document_nodes;
+  std::vector<UnicodeString> source_files;
 
   explicit LibXmlReader(const UnicodeString& source_file);
-  static void getAttributes(const xmlNode* node, std::unordered_map<UnicodeString, UnicodeString>& data);
-  void getChildren(xmlNode* node, XMLNode& result);
-  bool populateNode(xmlNode* node, XMLNode& result);
-  static uUnicodeString getElementText(const xmlNode* node);
+  static xmlTextReaderPtr createReader(const UnicodeString& source_file, xmlParserInputBufferPtr& input);
+  bool readNodes(xmlTextReaderPtr reader);
+  static void getAttributes(xmlTextReaderPtr reader, std::unordered_map<UnicodeString, UnicodeString>& data);
 
+  /* state of parsing is kept for each thread, so documents can be read in parallel */
   /* the name of the file that is being processed */
-  static uUnicodeString current_file;
+  static thread_local uUnicodeString current_file;
   /* is this the first xmlMyExternalEntityLoader call for current file*/
-  static bool is_first_call;
+  static thread_local bool is_first_call;
+  /* files, opened by xmlMyExternalEntityLoader for current file */
+  static thread_local std::vector<UnicodeString> loaded_files;
+  static thread_local bool loaded_only_files;
   static xmlParserInputPtr xmlMyExternalEntityLoader(const char* URL, const char* ID, xmlParserCtxtPtr ctxt);
   static void xml_error_func(void* ctx, const char* msg, ...);
 
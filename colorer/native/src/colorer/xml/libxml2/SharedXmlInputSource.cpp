@@ -4,14 +4,17 @@
 #include "colorer/utils/Environment.h"
 
 std::unordered_map<UnicodeString, SharedXmlInputSource*>* SharedXmlInputSource::isHash = nullptr;
+std::mutex SharedXmlInputSource::isMutex;
 
 int SharedXmlInputSource::addref()
 {
+  std::lock_guard<std::mutex> lock(isMutex);
   return ++ref_count;
 }
 
 int SharedXmlInputSource::delref()
 {
+  std::lock_guard<std::mutex> lock(isMutex);
   ref_count--;
   if (ref_count <= 0) {
     delete this;
@@ -22,6 +25,7 @@ int SharedXmlInputSource::delref()
 
 SharedXmlInputSource* SharedXmlInputSource::getSharedInputSource(const UnicodeString& path)
 {
+  std::lock_guard<std::mutex> lock(isMutex);
   if (isHash == nullptr) {
     isHash = new std::unordered_map<UnicodeString, SharedXmlInputSource*>();
   }
@@ -29,7 +33,8 @@ SharedXmlInputSource* SharedXmlInputSource::getSharedInputSource(const UnicodeSt
   const auto s = isHash->find(path);
   if (s != isHash->end()) {
     SharedXmlInputSource* sis = s->second;
-    sis->addref();
+    // lock is already held, addref would lock it again
+    ++sis->ref_count;
     return sis;
   }
 
@@ -66,6 +71,7 @@ byte* SharedXmlInputSource::getSrc() const
 
 void SharedXmlInputSource::open()
 {
+  std::lock_guard<std::mutex> lock(isMutex);
   if (!is_open) {
     std::ifstream f(colorer::Environment::to_filepath(&source_path), std::ios::in | std::ios::binary);
     if (!f.is_open()) {
@@ -78,4 +84,13 @@ void SharedXmlInputSource::open()
     f.close();
     is_open = true;
   }
-}
\ No newline at end of file
+}
+
+const ZipIndex* SharedXmlInputSource::getZipIndex()
+{
+  std::lock_guard<std::mutex> lock(isMutex);
+  if (!zip_index) {
+    zip_index = buildZipIndex(mSrc.get(), mSize);
+  }
+  return zip_index.get();
+}
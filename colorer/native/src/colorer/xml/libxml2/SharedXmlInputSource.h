@@ -1,8 +1,10 @@
 #ifndef SHAREDXMLINPUTSOURCE_H
 #define SHAREDXMLINPUTSOURCE_H
 
+#include <mutex>
 #include <unordered_map>
 #include "colorer/Common.h"
+#include "colorer/zip/MemoryFile.h"
 
 class SharedXmlInputSource
 {
@@ -21,6 +23,11 @@ class SharedXmlInputSource
 
   void open();
 
+  /** Index of entries of zip archive, it is built on the first call.
+      Source must be opened before this call.
+  */
+  const ZipIndex* getZipIndex();
+
   SharedXmlInputSource(SharedXmlInputSource const&) = delete;
   SharedXmlInputSource& operator=(SharedXmlInputSource const&) = delete;
   SharedXmlInputSource(SharedXmlInputSource&&) = delete;
@@ -31,12 +38,15 @@ class SharedXmlInputSource
   ~SharedXmlInputSource();
 
   static std::unordered_map<UnicodeString, SharedXmlInputSource*>* isHash;
+  // guards the list of sources and their lazy loading, documents can be read in several threads
+  static std::mutex isMutex;
 
   int ref_count {1};
   bool is_open {false};
   UnicodeString source_path;
   std::unique_ptr<byte[]> mSrc;
   int mSize {0};
+  std::unique_ptr<ZipIndex> zip_index;
 };
 
 #endif  // SHAREDXMLINPUTSOURCE_H
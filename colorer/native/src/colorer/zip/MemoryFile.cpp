@@ -2,7 +2,41 @@
 #include <cstring>
 #include "colorer/Exception.h"
 
-std::unique_ptr<std::vector<byte>> unzip(const byte* src, int size, const UnicodeString& path_in_zip)
+std::unique_ptr<ZipIndex> buildZipIndex(const byte* src, int size)
+{
+  MemoryFile mf;
+  mf.stream = src;
+  mf.length = size;
+  zlib_filefunc_def zlib_ff;
+  fill_mem_filefunc(&zlib_ff, &mf);
+
+  auto index = std::make_unique<ZipIndex>();
+  unzFile fid = unzOpen2(nullptr, &zlib_ff);
+  if (!fid) {
+    return index;
+  }
+  unz_file_info file_info;
+  std::vector<char> file_name;
+  for (int ret = unzGoToFirstFile(fid); ret == UNZ_OK; ret = unzGoToNextFile(fid)) {
+    if (unzGetCurrentFileInfo(fid, &file_info, nullptr, 0, nullptr, 0, nullptr, 0) != UNZ_OK) {
+      break;
+    }
+    file_name.resize(file_info.size_filename + 1);
+    unz_file_pos file_pos;
+    if (unzGetCurrentFileInfo(fid, nullptr, file_name.data(), static_cast<uLong>(file_name.size()), nullptr, 0,
+                              nullptr, 0) != UNZ_OK ||
+        unzGetFilePos(fid, &file_pos) != UNZ_OK)
+    {
+      break;
+    }
+    index->try_emplace(std::string(file_name.data(), file_info.size_filename), file_pos);
+  }
+  unzClose(fid);
+  return index;
+}
+
+std::unique_ptr<std::vector<byte>> unzip(const byte* src, int size, const UnicodeString& path_in_zip,
+                                         const ZipIndex* index)
 {
   MemoryFile mf;
   mf.stream = src;
@@ -16,7 +50,19 @@ std::unique_ptr<std::vector<byte>> unzip(const byte* src, int size, const Unicod
     unzClose(fid);
     throw InputSourceException("Can't locate file in JAR content: '" + path_in_zip + "'");
   }
-  int ret = unzLocateFile(fid, UStr::to_stdstr(&path_in_zip).c_str(), 0);
+  const auto entry_name = UStr::to_stdstr(&path_in_zip);
+  int ret = UNZ_END_OF_LIST_OF_FILE;
+  if (index) {
+    auto entry = index->find(entry_name);
+    if (entry != index->end()) {
+      auto file_pos = entry->second;
+      ret = unzGoToFilePos(fid, &file_pos);
+    }
+  }
+  // names are compared without case on some systems, so entry, which is not found in index, is searched as before
+  if (ret != UNZ_OK) {
+    ret = unzLocateFile(fid, entry_name.c_str(), 0);
+  }
   if (ret != UNZ_OK) {
     unzClose(fid);
     throw InputSourceException("Can't locate file in JAR content: '" + path_in_zip + "'");
@@ -2,6 +2,8 @@
 #define COLORER_MEMORYFILE_H
 
 #include <minizip/unzip.h>
+#include <string>
+#include <unordered_map>
 #include <vector>
 #include "colorer/Common.h"
 
@@ -13,7 +15,19 @@ typedef struct
   int error;
 } MemoryFile;
 
-std::unique_ptr<std::vector<byte>> unzip(const byte* src, int size, const UnicodeString& path_in_zip);
+/** Positions of entries in the central directory of zip archive by their names.
+ */
+using ZipIndex = std::unordered_map<std::string, unz_file_pos>;
+
+/** Reads the central directory of zip archive once and returns positions of all its entries.
+ */
+std::unique_ptr<ZipIndex> buildZipIndex(const byte* src, int size);
+
+/** Unpacks @c path_in_zip entry of zip archive.
+    @param index Index of archive entries, if it is null, entry is searched in the central directory.
+ */
+std::unique_ptr<std::vector<byte>> unzip(const byte* src, int size, const UnicodeString& path_in_zip,
+                                         const ZipIndex* index = nullptr);
 voidpf ZCALLBACK mem_open_file_func(voidpf opaque, const char* filename, int mode);
 uLong ZCALLBACK mem_read_file_func(voidpf opaque, voidpf stream, void* buf, uLong size);
 uLong ZCALLBACK mem_write_file_func(voidpf opaque, voidpf stream, const void* buf, uLong size);
@@ -160,7 +160,7 @@ void TestColoringFile(int count, UnicodeString* catalogPath, UnicodeString* test
     // start timer
     high_resolution_clock::time_point t1 = high_resolution_clock::now();
 
-    baseEditor.modifyLineEvent(0);
+    baseEditor.modifyEvent(0);
     baseEditor.lineCountEvent((int) textLinesStore.getLineCount());
     baseEditor.validate(-1, false);
 
@@ -0,0 +1,374 @@
+#include <catch2/catch.hpp>
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <sstream>
+#include "colorer/ParserFactory.h"
+#include "colorer/editor/BaseEditor.h"
+#include "colorer/editor/Outliner.h"
+#include "test_common.h"
+
+namespace {
+
+struct Pair
+{
+  int sline;
+  int start;
+  int eline;
+  int end;
+};
+
+Pair searchGlobalPair(BaseEditor& editor, int lno, int pos)
+{
+  PairMatch* pm = editor.searchGlobalPair(lno, pos);
+  REQUIRE(pm != nullptr);
+  Pair pair {pm->sline, pm->start->start, pm->eline, pm->end ? pm->end->start : -1};
+  editor.releasePairMatch(pm);
+  return pair;
+}
+
+class ProgressListener : public EditorListener
+{
+ public:
+  std::mutex mutex;
+  std::condition_variable progress;
+  std::vector<size_t> validLines;
+
+  void modifyEvent(size_t /*topLine*/) override {}
+
+  void parseProgressEvent(size_t validLine, size_t /*lineCount*/) override
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    validLines.push_back(validLine);
+    progress.notify_all();
+  }
+
+  void waitFor(size_t count)
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    progress.wait(lock, [&] { return validLines.size() >= count; });
+  }
+
+  void waitForLine(size_t line)
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    progress.wait(lock, [&] { return !validLines.empty() && validLines.back() == line; });
+  }
+};
+
+}  // namespace
+
+TEST_CASE("Global pair is found by index of paired regions")
+{
+  HrcTestFactory hrc("type_pairs.hrc");
+  auto& pf = hrc.getFactory();
+
+  LinesSource source;
+  source.lines.emplace_back("{");
+  for (int i = 1; i < 2999; i++) {
+    source.lines.emplace_back(i % 100 == 0 ? "  { begin x end }" : "  x");
+  }
+  source.lines.emplace_back("}");
+  source.lines[10] = "  begin";
+  source.lines[2000] = "  end";
+  auto lines = static_cast<int>(source.lines.size());
+
+  BaseEditor editor(&pf, &source);
+  editor.setFileType(UnicodeString("pairs"));
+  editor.lineCountEvent(lines);
+  editor.visibleTextEvent(0, 20);
+
+  auto pair = searchGlobalPair(editor, 0, 0);
+  REQUIRE(pair.sline == 0);
+  REQUIRE(pair.eline == lines - 1);
+  REQUIRE(pair.end == 0);
+  pair = searchGlobalPair(editor, 10, 3);
+  REQUIRE(pair.eline == 2000);
+  REQUIRE(pair.end == 2);
+  pair = searchGlobalPair(editor, 1500, 2);
+  REQUIRE(pair.eline == 1500);
+  REQUIRE(pair.end == 16);
+  pair = searchGlobalPair(editor, lines - 1, 0);
+  REQUIRE(pair.eline == 0);
+  REQUIRE(pair.end == 0);
+
+  // positions of regions are changed, pairs are the same
+  source.lines[2000] = "    end";
+  editor.modifyLineEvent(2000);
+  pair = searchGlobalPair(editor, 10, 3);
+  REQUIRE(pair.eline == 2000);
+  REQUIRE(pair.end == 4);
+
+  // pair is moved to other line
+  source.lines[2000] = "  x";
+  source.lines[2500] = "  end";
+  editor.modifyLineEvent(2000);
+  editor.modifyLineEvent(2500);
+  pair = searchGlobalPair(editor, 2500, 3);
+  REQUIRE(pair.eline == 10);
+  REQUIRE(pair.end == 2);
+  pair = searchGlobalPair(editor, 10, 3);
+  REQUIRE(pair.eline == 2500);
+
+  source.lines.insert(source.lines.begin() + 5, "  end");
+  editor.lineCountEvent(lines + 1);
+  editor.modifyEvent(5);
+  pair = searchGlobalPair(editor, 0, 0);
+  REQUIRE(pair.eline == 5);
+  pair = searchGlobalPair(editor, 11, 2);
+  REQUIRE(pair.eline == 2501);
+  pair = searchGlobalPair(editor, lines, 0);
+  REQUIRE(pair.end == -1);
+}
+
+TEST_CASE("Text is parsed by worker thread of editor")
+{
+  HrcTestFactory hrc("type_pairs.hrc");
+  auto& pf = hrc.getFactory();
+
+  LinesSource source;
+  source.lines.emplace_back("{");
+  for (int i = 1; i < 9999; i++) {
+    source.lines.emplace_back(i % 100 == 0 ? "  { begin x end }" : "  x { x } x");
+  }
+  source.lines.emplace_back("}");
+  auto lines = static_cast<int>(source.lines.size());
+
+  BaseEditor editor(&pf, &source);
+  ProgressListener listener;
+  editor.addEditorListener(&listener);
+  editor.setFileType(UnicodeString("pairs"));
+  editor.visibleTextEvent(0, 20);
+  editor.setBackgroundParsing(true);
+  editor.lineCountEvent(lines);
+  listener.waitFor(1);
+
+  {
+    // text is changed, while worker can parse it
+    BaseEditor::ParseLock lock(&editor);
+    source.lines[5] = "  begin x end";
+    editor.modifyEvent(5);
+    std::lock_guard<std::mutex> progress_lock(listener.mutex);
+    listener.validLines.clear();
+  }
+  listener.waitForLine(lines);
+  {
+    BaseEditor::ParseLock lock(&editor);
+    REQUIRE_FALSE(editor.haveInvalidLine());
+    // parse is continued from the changed line
+    REQUIRE(listener.validLines.front() <= 5 + 500);
+    REQUIRE(std::is_sorted(listener.validLines.begin(), listener.validLines.end()));
+  }
+
+  BaseEditor expected(&pf, &source);
+  expected.setFileType(UnicodeString("pairs"));
+  expected.visibleTextEvent(0, 20);
+  expected.lineCountEvent(lines);
+  for (int lno : {0, 5, 100, 5000, 9800, lines - 1}) {
+    editor.visibleTextEvent(lno, 20);
+    expected.visibleTextEvent(lno, 20);
+    BaseEditor::ParseLock lock(&editor);
+    REQUIRE(dumpRegions(editor.getLineRegions(lno)) == dumpRegions(expected.getLineRegions(lno)));
+  }
+  auto pair = searchGlobalPair(editor, 0, 0);
+  REQUIRE(pair.eline == lines - 1);
+  pair = searchGlobalPair(editor, 5, 3);
+  REQUIRE(pair.eline == 5);
+  REQUIRE(pair.end == 10);
+
+  editor.setBackgroundParsing(false);
+  editor.removeEditorListener(&listener);
+}
+
+namespace {
+
+class ParseCounter : public RegionHandler
+{
+ public:
+  int parses = 0;
+
+  void startParsing(size_t /*lno*/) override
+  {
+    parses++;
+  }
+  void clearLine(size_t /*lno*/, UnicodeString* /*line*/) override {}
+  void addRegion(size_t /*lno*/, UnicodeString* /*line*/, int /*sx*/, int /*ex*/, const Region* /*region*/) override {}
+  void enterScheme(size_t /*lno*/, UnicodeString* /*line*/, int /*sx*/, int /*ex*/, const Region* /*region*/,
+                   const Scheme* /*scheme*/) override
+  {
+  }
+  void leaveScheme(size_t /*lno*/, UnicodeString* /*line*/, int /*sx*/, int /*ex*/, const Region* /*region*/,
+                   const Scheme* /*scheme*/) override
+  {
+  }
+};
+
+}  // namespace
+
+TEST_CASE("Regions of parsed lines are read from document store")
+{
+  HrcTestFactory hrc("type_pairs.hrc");
+  auto& pf = hrc.getFactory();
+
+  // regions are copied from the store in both layouts of editor
+  for (bool compact : {true, false}) {
+    LinesSource source;
+    source.lines.emplace_back("{");
+    for (int i = 1; i < 2999; i++) {
+      source.lines.emplace_back(i % 10 == 0 ? "  { begin x" : (i % 10 == 5 ? "  end } x" : "  x { x } x"));
+    }
+    source.lines.emplace_back("}");
+    auto lines = static_cast<int>(source.lines.size());
+
+    BaseEditor editor(&pf, &source);
+    BaseEditor expected(&pf, &source);
+    ParseCounter counter;
+    editor.addRegionHandler(&counter);
+    for (BaseEditor* e : {&editor, &expected}) {
+      e->setRegionCompact(compact);
+      e->setFileType(UnicodeString("pairs"));
+      e->lineCountEvent(lines);
+    }
+    editor.setDocumentRegions(true);
+
+    auto checkLine = [&](int lno) {
+      editor.visibleTextEvent(lno, 20);
+      expected.visibleTextEvent(lno, 20);
+      REQUIRE(dumpRegions(editor.getLineRegions(lno)) == dumpRegions(expected.getLineRegions(lno)));
+    };
+
+    checkLine(lines - 1);
+    REQUIRE_FALSE(editor.haveInvalidLine());
+    int parses = counter.parses;
+    for (int lno : {0, 1500, 15, 2990, 37, 1234}) {
+      checkLine(lno);
+    }
+    REQUIRE(counter.parses == parses);
+
+    // changed line is parsed again
+    source.lines[1505] = "  x";
+    editor.modifyLineEvent(1505);
+    expected.modifyLineEvent(1505);
+    checkLine(2000);
+    checkLine(1505);
+    checkLine(1600);
+    checkLine(20);
+    parses = counter.parses;
+    checkLine(1506);
+    REQUIRE(counter.parses == parses);
+
+    // regions of least recently used lines are dropped
+    editor.setDocumentRegions(true, 1000);
+    checkLine(2500);
+    REQUIRE(counter.parses > parses);
+    checkLine(0);
+    parses = counter.parses;
+    checkLine(2500);
+    REQUIRE(counter.parses == parses);
+    for (int lno = 0; lno < 1000; lno += 20) {
+      checkLine(lno);
+    }
+    parses = counter.parses;
+    checkLine(2500);
+    REQUIRE(counter.parses > parses);
+
+    editor.removeRegionHandler(&counter);
+  }
+}
+
+namespace {
+
+std::string itemText(Outliner& outliner, size_t idx)
+{
+  UnicodeString text = outliner.getItemText(idx);
+  return UStr::to_stdstr(&text);
+}
+
+std::string dumpOutline(Outliner& outliner)
+{
+  std::stringstream out;
+  for (size_t i = 0; i < outliner.itemCount(); i++) {
+    const OutlineItem* item = outliner.getItem(i);
+    out << item->lno << ":" << item->pos << ":" << item->level << " " << itemText(outliner, i) << ";";
+  }
+  return out.str();
+}
+
+std::string parseOutline(ParserFactory& pf, LinesSource& source)
+{
+  BaseEditor editor(&pf, &source);
+  editor.setFileType(UnicodeString("pairs"));
+  editor.lineCountEvent(static_cast<int>(source.lines.size()));
+  UnicodeString outlined("def:Outlined");
+  Outliner outliner(&editor, pf.getHrcLibrary().getRegion(&outlined));
+  while (editor.haveInvalidLine()) {
+    editor.idleJob(100);
+  }
+  return dumpOutline(outliner);
+}
+
+}  // namespace
+
+TEST_CASE("Outline items of parsed lines are replaced in place")
+{
+  HrcTestFactory hrc("type_pairs.hrc");
+  auto& pf = hrc.getFactory();
+
+  LinesSource source;
+  for (int i = 0; i < 2000; i++) {
+    std::string line = "  x";
+    if (i % 10 == 0) {
+      line = "func f" + std::to_string(i) + " : t {";
+    }
+    else if (i % 10 == 2) {
+      line = "  func g" + std::to_string(i) + " { }";
+    }
+    else if (i % 10 == 5) {
+      line = "}";
+    }
+    source.lines.emplace_back(line.c_str());
+  }
+
+  BaseEditor editor(&pf, &source);
+  editor.setFileType(UnicodeString("pairs"));
+  editor.lineCountEvent(static_cast<int>(source.lines.size()));
+  editor.visibleTextEvent(0, 20);
+  UnicodeString outlined("def:Outlined");
+  Outliner outliner(&editor, pf.getHrcLibrary().getRegion(&outlined));
+  auto parseAll = [&]() {
+    while (editor.haveInvalidLine()) {
+      editor.idleJob(100);
+    }
+  };
+  parseAll();
+
+  REQUIRE(outliner.itemCount() == 400);
+  REQUIRE(itemText(outliner, 0) == "f0t");
+  REQUIRE(outliner.getItem(1)->level == 1);
+  REQUIRE(itemText(outliner, 1) == "g2");
+  auto parsed = parseOutline(pf, source);
+  REQUIRE(dumpOutline(outliner) == parsed);
+
+  // parse of already parsed lines does not duplicate or change items
+  editor.visibleTextEvent(1000, 20);
+  REQUIRE(editor.getLineRegions(1000) != nullptr);
+  REQUIRE(outliner.itemCount() == 400);
+  REQUIRE(dumpOutline(outliner) == parsed);
+
+  // single line is parsed again
+  source.lines[500] = "func renamed : u {";
+  editor.modifyLineEvent(500);
+  REQUIRE(editor.getInvalidLine() == 2000);
+  REQUIRE(dumpOutline(outliner) == parseOutline(pf, source));
+  source.lines[502] = "  x";
+  editor.modifyLineEvent(502);
+  REQUIRE(dumpOutline(outliner) == parseOutline(pf, source));
+  REQUIRE(outliner.itemCount() == 399);
+
+  source.lines.insert(source.lines.begin() + 3, "  func inserted");
+  editor.lineCountEvent(static_cast<int>(source.lines.size()));
+  editor.modifyEvent(3);
+  REQUIRE(outliner.itemCount() == 2);
+  parseAll();
+  REQUIRE(dumpOutline(outliner) == parseOutline(pf, source));
+}
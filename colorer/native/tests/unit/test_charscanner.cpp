@@ -0,0 +1,39 @@
+#include <catch2/catch.hpp>
+#include "colorer/parsers/CharScanner.h"
+
+TEST_CASE("CharScanner finds the same position as simple search")
+{
+  SStartChars chars;
+  for (UChar c : {u'<', u'&', u'"', u'é', u'ÿ', u'\u0080'}) {
+    chars.chars.set(c);
+  }
+
+  unsigned int seed = 7;
+  auto next = [&seed]() {
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) & 0x7FFF;
+  };
+  const UChar alphabet[] = {u'a', u'b', u' ', u'<', u'&', u'"', u'é', u'ÿ', u'\u0080',
+                            u'ǩ', u'㰼', u'Ｂ', u'肀', u'Ā', u'þ', u'z'};
+
+  for (bool high : {false, true}) {
+    chars.high = high;
+    CharScanner scanner(chars);
+    for (int i = 0; i < 300; i++) {
+      UnicodeString line;
+      int length = static_cast<int>(next() % 100);
+      // mostly not interesting chars with rare ones from the set
+      for (int j = 0; j < length; j++) {
+        auto r = next();
+        line.append(r % 16 == 0 ? alphabet[(r >> 4) % 16] : (r % 5 == 0 ? u'ሴ' : u'x'));
+      }
+      for (int from = 0; from <= length; from += 3) {
+        int expected = from;
+        while (expected < length && !chars.contains(line[expected])) {
+          expected++;
+        }
+        REQUIRE(scanner.find(line, from, length) == expected);
+      }
+    }
+  }
+}
@@ -1,8 +1,89 @@
 #ifndef TEST_COMMON_H
 #define TEST_COMMON_H
 
+#include <catch2/catch.hpp>
+#include <fstream>
+#include <sstream>
+#include <vector>
 #include "TestLogger.h"
+#include "colorer/LineSource.h"
+#include "colorer/ParserFactory.h"
+#include "colorer/handlers/LineRegion.h"
+#include "colorer/handlers/LineRegionsFlatSupport.h"
+#include "colorer/utils/FileSystems.h"
+#include "colorer/xml/XmlInputSource.h"
 
 extern std::unique_ptr<TestLogger> logger;
 
+/** Source of text lines, kept in vector. */
+class LinesSource : public LineSource
+{
+ public:
+  std::vector<UnicodeString> lines;
+
+  UnicodeString* getLine(size_t lno) override
+  {
+    return lno < lines.size() ? &lines[lno] : nullptr;
+  }
+};
+
+/** Parser factory with types of one HRC file from the data directory. */
+class HrcTestFactory
+{
+ public:
+  explicit HrcTestFactory(const char* hrc_file)
+      : hrc_source(UnicodeString((fs::current_path() / "data" / hrc_file).c_str()), nullptr)
+  {
+    factory.getHrcLibrary().loadSource(&hrc_source);
+  }
+
+  ParserFactory& getFactory()
+  {
+    return factory;
+  }
+
+  HrcLibrary& getLibrary()
+  {
+    return factory.getHrcLibrary();
+  }
+
+  FileType* getFileType(const char* name)
+  {
+    auto* type = getLibrary().getFileType(UnicodeString(name));
+    REQUIRE(type != nullptr);
+    return type;
+  }
+
+ private:
+  // types are loaded from the source on the first use, so it outlives the factory
+  XmlInputSource hrc_source;
+  ParserFactory factory;
+};
+
+inline std::string dumpRegions(const LineRegion* lr)
+{
+  std::stringstream out;
+  for (; lr; lr = lr->next) {
+    out << lr->start << "-" << lr->end << (lr->special ? "*" : "") << " "
+        << (lr->region ? UStr::to_stdstr(&lr->region->getName()) : "") << ";";
+  }
+  return out.str();
+}
+
+inline std::string dumpRegions(const FlatLineRegions& regions)
+{
+  std::stringstream out;
+  for (auto lr : regions) {
+    out << lr.start() << "-" << lr.end() << (lr.special() ? "*" : "") << " "
+        << (lr.region() ? UStr::to_stdstr(&lr.region()->getName()) : "") << ";";
+  }
+  return out.str();
+}
+
+inline void writeFile(const fs::path& path, const std::string& content)
+{
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file << content;
+}
+
 #endif //TEST_COMMON_H
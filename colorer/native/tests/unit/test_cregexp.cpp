@@ -0,0 +1,304 @@
+#include <catch2/catch.hpp>
+#include <thread>
+#include "colorer/cregexp/cregexp.h"
+
+TEST_CASE("Regexp matches with brackets")
+{
+  CRegExp re;
+  UnicodeString pattern("/(\\w+)\\s*=\\s*(\\d+)/");
+  REQUIRE(re.setRE(&pattern));
+  re.setPositionMoves(true);
+
+  UnicodeString text("  width = 120;");
+  SMatches match {};
+  REQUIRE(re.parse(&text, &match));
+  REQUIRE(match.s[0] == 2);
+  REQUIRE(match.e[0] == 13);
+  REQUIRE(match.s[1] == 2);
+  REQUIRE(match.e[1] == 7);
+  REQUIRE(match.s[2] == 10);
+  REQUIRE(match.e[2] == 13);
+}
+
+TEST_CASE("Regexp bounds of match are changed only by this parse")
+{
+  CRegExp re;
+  UnicodeString pattern("/a\\Mb|c/");
+  REQUIRE(re.setRE(&pattern));
+
+  UnicodeString marked("ab");
+  SMatches match {};
+  REQUIRE(re.parse(&marked, &match));
+  REQUIRE(match.s[0] == 0);
+  REQUIRE(match.e[0] == 1);
+
+  // \M is not passed, end of match is the end of text
+  UnicodeString plain("c");
+  REQUIRE(re.parse(&plain, &match));
+  REQUIRE(match.s[0] == 0);
+  REQUIRE(match.e[0] == 1);
+}
+
+TEST_CASE("Regexp uses back trace of the caller")
+{
+  UnicodeString start_pattern("/<<(\\w+)/");
+  UnicodeString end_pattern("/^\\y1$/");
+  CRegExp start_re(&start_pattern);
+  CRegExp end_re;
+  end_re.setBackRE(&start_re);
+  REQUIRE(end_re.setRE(&end_pattern));
+  REQUIRE(end_re.hasBackTrace());
+  REQUIRE_FALSE(start_re.hasBackTrace());
+
+  MatchContext context;
+  UnicodeString start_line("cat <<EOF");
+  SMatches start_match {};
+  REQUIRE(start_re.parse(context, &start_line, 4, start_line.length(), &start_match));
+
+  UnicodeString end_line("EOF");
+  UnicodeString other_line("END");
+  SMatches end_match {};
+  REQUIRE(end_re.parse(context, &end_line, 0, end_line.length(), &end_match, 0, -1, &start_line, &start_match));
+  REQUIRE_FALSE(end_re.parse(context, &other_line, 0, other_line.length(), &end_match, 0, -1, &start_line, &start_match));
+  // without back trace \y never matches
+  REQUIRE_FALSE(end_re.parse(context, &end_line, 0, end_line.length(), &end_match));
+}
+
+TEST_CASE("Regexp is shared between threads")
+{
+  UnicodeString pattern("/\\b(a+b?){2,5}c\\b/");
+  CRegExp re(&pattern);
+  REQUIRE(re.isOk());
+
+  auto worker = [&re](const UnicodeString& text, int expected_end, bool* result) {
+    MatchContext context;
+    *result = true;
+    for (int i = 0; i < 2000; i++) {
+      SMatches match {};
+      bool ok = re.parse(context, &text, 0, text.length(), &match, 0, 1);
+      if (expected_end == -1 ? ok : (!ok || match.e[0] != expected_end)) {
+        *result = false;
+        return;
+      }
+    }
+  };
+
+  UnicodeString text1("xx aabaac yy");
+  UnicodeString text2("x abac y aaaaaaac");
+  UnicodeString text3("ac ab abc");
+  bool r1 = false;
+  bool r2 = false;
+  bool r3 = false;
+  std::thread t1(worker, std::cref(text1), 9, &r1);
+  std::thread t2(worker, std::cref(text2), 6, &r2);
+  std::thread t3(worker, std::cref(text3), -1, &r3);
+  t1.join();
+  t2.join();
+  t3.join();
+  REQUIRE(r1);
+  REQUIRE(r2);
+  REQUIRE(r3);
+}
+
+TEST_CASE("Regexp start chars")
+{
+  UnicodeString pattern1("/(if|\\d+)\\b/");
+  CRegExp re1(&pattern1);
+  auto* chars = re1.getStartChars();
+  REQUIRE(chars != nullptr);
+  REQUIRE(chars->contains('i'));
+  REQUIRE(chars->contains('7'));
+  REQUIRE_FALSE(chars->contains('f'));
+  REQUIRE_FALSE(chars->contains(' '));
+
+  UnicodeString pattern2("/x?[a-c]/i");
+  CRegExp re2(&pattern2);
+  chars = re2.getStartChars();
+  REQUIRE(chars != nullptr);
+  REQUIRE(chars->contains('X'));
+  REQUIRE(chars->contains('b'));
+  REQUIRE_FALSE(chars->contains('d'));
+
+  // can match empty string
+  UnicodeString pattern3("/a*/");
+  CRegExp re3(&pattern3);
+  REQUIRE(re3.getStartChars() == nullptr);
+
+  UnicodeString pattern4("/a/");
+  CRegExp re4(&pattern4);
+  re4.setPositionMoves(true);
+  REQUIRE(re4.getStartChars() == nullptr);
+}
+
+TEST_CASE("Regexp positions are rejected by DFA")
+{
+  UnicodeString pattern1("/[*#]\\//");
+  CRegExp re1(&pattern1);
+  re1.setPositionMoves(true);
+  REQUIRE(re1.hasDfa());
+
+  MatchContext context;
+  UnicodeString text("  comment text */ x");
+  SMatches match {};
+  REQUIRE(re1.parse(context, &text, 0, text.length(), &match));
+  REQUIRE(match.s[0] == 15);
+  REQUIRE(match.e[0] == 17);
+  const SRegStats& stats = context.getStats();
+  REQUIRE(stats.attempts == 16);
+  REQUIRE(stats.dfaRejected == 15);
+  REQUIRE(stats.noDfa == 0);
+
+  // look ahead is not a part of the DFA, so it passes the position to backtracking
+  UnicodeString pattern2("/\\b(if|for|while)\\s*\\(([^)]*)\\)?=/i");
+  CRegExp re2(&pattern2);
+  re2.setPositionMoves(true);
+  REQUIRE(re2.hasDfa());
+  UnicodeString text2("  For (x) = 1; if(y) ");
+  REQUIRE(re2.parse(context, &text2, 0, text2.length(), &match));
+  REQUIRE(match.s[0] == 2);
+  REQUIRE(match.e[0] == 8);
+  REQUIRE(match.s[2] == 7);
+  REQUIRE(match.e[2] == 8);
+  REQUIRE(re2.parse(context, &text2, 3, text2.length(), &match));
+  REQUIRE(match.s[0] == 15);
+  REQUIRE(match.e[0] == 19);
+
+  context.resetStats();
+  REQUIRE(context.getStats().attempts == 0);
+
+  // back references and patterns, which can match empty string, have no DFA
+  UnicodeString pattern3("/(\\w)\\1/");
+  CRegExp re3(&pattern3);
+  REQUIRE_FALSE(re3.hasDfa());
+  UnicodeString pattern4("/a*/");
+  CRegExp re4(&pattern4);
+  REQUIRE_FALSE(re4.hasDfa());
+  UnicodeString pattern5("/\\y1/");
+  CRegExp re5(&pattern5);
+  REQUIRE_FALSE(re5.hasDfa());
+}
+
+TEST_CASE("Regexp positions are found by literals")
+{
+  MatchContext context;
+  SMatches match {};
+  UnicodeString text("  comment <!-- text --> -- x");
+
+  // literal prefix
+  UnicodeString pattern1("/--\\s*>/");
+  CRegExp re1(&pattern1);
+  re1.setPositionMoves(true);
+  REQUIRE(re1.parse(context, &text, 0, text.length(), &match));
+  REQUIRE(match.s[0] == 20);
+  REQUIRE(match.e[0] == 23);
+  REQUIRE(context.getStats().attempts == 2);
+  REQUIRE_FALSE(re1.parse(context, &text, 21, text.length(), &match));
+  REQUIRE(context.getStats().attempts == 3);
+
+  // required literal inside of match
+  context.resetStats();
+  UnicodeString pattern2("/\\w+\\s*--/");
+  CRegExp re2(&pattern2);
+  re2.setPositionMoves(true);
+  REQUIRE(re2.parse(context, &text, 0, text.length(), &match));
+  REQUIRE(match.s[0] == 15);
+  REQUIRE(match.e[0] == 22);
+  REQUIRE_FALSE(re2.parse(context, &text, 24, text.length(), &match));
+
+  // text is shorter than minimal match
+  context.resetStats();
+  UnicodeString pattern3("/\\d{3}/");
+  CRegExp re3(&pattern3);
+  UnicodeString digits("x12");
+  REQUIRE_FALSE(re3.parse(context, &digits, 1, digits.length(), &match));
+  REQUIRE(re3.parse(context, &digits, 0, 2, &match) == false);
+  REQUIRE(context.getStats().attempts == 0);
+  UnicodeString digits3("x123");
+  REQUIRE(re3.parse(context, &digits3, 1, digits3.length(), &match));
+  REQUIRE(context.getStats().attempts == 1);
+
+  // ignore case patterns have no literals, but match
+  UnicodeString pattern4("/END\\b/i");
+  CRegExp re4(&pattern4);
+  re4.setPositionMoves(true);
+  UnicodeString text4("x = 1 end");
+  REQUIRE(re4.parse(context, &text4, 0, text4.length(), &match));
+  REQUIRE(match.s[0] == 6);
+}
+
+static std::string dumpMatches(const SMatches& match)
+{
+  std::string out;
+  for (int i = 0; i < match.cMatch; i++) {
+    out += std::to_string(i) + ":" + std::to_string(match.s[i]) + "-" + std::to_string(match.e[i]) + " ";
+  }
+  return out;
+}
+
+TEST_CASE("Regexp matches are the same for both engines")
+{
+  // Expected matches are the result of the tree walker. The table runs on the bytecode interpreter
+  // in the default build, and on the tree walker with COLORER_USE_REGEXP_BYTECODE=OFF.
+  struct MatchCase
+  {
+    const char* pattern;
+    const char* text;
+    int pos;
+    int soscheme;
+    bool moves;
+    const char* expected;
+  };
+  const MatchCase cases[] = {
+      {"/(\\w+)\\s*=\\s*(\\d+)/", "  width = 120;", 0, 0, true, "0:2-13 1:2-7 2:10-13 "},
+      {"/a\\Mb/", "xab", 0, 0, true, "0:1-2 "},
+      {"/a\\mbc/", "abc", 0, 0, false, "0:1-3 "},
+      {"/(\\w+)\\m\\s*\\(/", "call  (x)", 0, 0, false, "0:4-7 1:0-4 "},
+      {"/\\s*\\M(\\w+)$/", "  end", 0, 0, false, "0:0-2 1:2-5 "},
+      {"/~\\w+/", "  word", 2, 2, false, "0:2-6 "},
+      {"/~\\w+/", "  word", 2, 0, false, "none"},
+      {"/^\\y1$/", "EOF", 0, 0, false, "0:0-3 "},
+      {"/^\\y1$/", "END", 0, 0, false, "none"},
+      {"/^\\Y1/", "END", 0, 0, false, "none"},
+      {"/^\\Y1/", "eof", 0, 0, false, "0:0-3 "},
+      {"/(\\d)?#1px/", "a px 12px", 0, 0, true, "0:7-9 1:6-7 "},
+      {"/(\\d)?~1px/", "1px apx", 0, 0, true, "0:5-7 1:0-1 "},
+      {"/(\\w)\\1/", "abccd", 0, 0, true, "0:2-4 1:2-3 "},
+      {"/(a|b)(c)\\2\\1/", "xbccb acca", 0, 0, true, "0:1-5 1:1-2 2:2-3 "},
+      {"/\\bfoo\\b/", "foobar foo", 0, 0, true, "0:7-10 "},
+      {"/\\Bar\\B/", "ar bars", 0, 0, true, "0:4-6 "},
+      {"/\\b(a+b?){2,5}c\\b/", "xx aabaac yy", 0, 0, true, "0:3-9 1:6-8 "},
+      {"/(a|ab)(c|bcd)(d*)/", "abcd", 0, 0, false, "0:0-4 1:0-1 2:1-4 3:4-4 "},
+      {"/x*?y/", "xxxy", 0, 0, false, "0:0-4 "},
+      {"/<(.+?)>/", "<a><b>", 0, 0, false, "0:0-3 1:1-2 "},
+      {"/a{2,3}?/", "aaaa", 0, 0, false, "0:0-2 "},
+      {"/(\\d+)(px)?=/", "10em 20px", 0, 0, true, "0:5-7 1:5-7 2:7-9 "},
+      {"/(\\d+)(px)?!\\b/", "20px 30;", 0, 0, true, "0:5-7 1:5-7 2:2-4 "},
+      {"/(if|else|while)\\b/i", "x = 1; While", 0, 0, true, "0:7-12 1:7-12 "},
+      {"/[a-f\\d]+?h$/", "0ffh", 0, 0, true, "0:0-4 "},
+      {"/((a)|(b))+/", "abab", 0, 0, false, "0:0-4 1:3-4 2:2-3 3:3-4 "},
+      {"/^$/", "", 0, 0, false, "0:0-0 "},
+      {"/\\w+$/", "last word", 0, 0, true, "0:5-9 "},
+  };
+
+  UnicodeString back_pattern("/<<(\\w+)/");
+  CRegExp back_re(&back_pattern);
+  back_re.setPositionMoves(true);
+  UnicodeString back_line("cat <<EOF");
+  SMatches back_match {};
+  REQUIRE(back_re.parse(&back_line, &back_match));
+
+  MatchContext context;
+  for (const auto& c : cases) {
+    CRegExp re;
+    re.setBackRE(&back_re);
+    UnicodeString pattern(c.pattern);
+    REQUIRE(re.setRE(&pattern));
+    re.setPositionMoves(c.moves);
+
+    UnicodeString text(c.text);
+    SMatches match {};
+    bool found = re.parse(context, &text, c.pos, text.length(), &match, c.soscheme, -1, &back_line, &back_match);
+    INFO(c.pattern << " on '" << c.text << "'");
+    CHECK((found ? dumpMatches(match) : "none") == c.expected);
+  }
+}
@@ -1,5 +1,7 @@
 #include <catch2/catch.hpp>
 #include "colorer/parsers/HrcLibraryImpl.h"
+#include "colorer/TextParser.h"
+#include "colorer/handlers/LineRegionsSupport.h"
 #include "colorer/utils/FileSystems.h"
 
 TEST_CASE("Load hrc")
@@ -10,4 +12,137 @@ TEST_CASE("Load hrc")
   XmlInputSource file1(uwork_dir, nullptr);
   HrcLibrary lib;
   lib.loadSource(&file1);
-}
\ No newline at end of file
+}
+TEST_CASE("Same regexps of schemes are compiled once")
+{
+  auto hrc_path = fs::current_path() / "data/type_shared.hrc";
+  XmlInputSource hrc_source(UnicodeString(hrc_path.c_str()), nullptr);
+  HrcLibrary lib;
+  lib.setEagerCompile(true);
+  lib.loadSource(&hrc_source);
+  REQUIRE(lib.getFileType(UnicodeString("shared")) != nullptr);
+
+  auto stats = lib.getRegExpStats();
+  REQUIRE(stats.requested == 9);
+  // number regexp with and without entity, start and end of the same blocks
+  // are shared; flags and position moves make different regexps
+  REQUIRE(stats.compiled == 6);
+}
+
+namespace {
+class OneLineSource : public LineSource
+{
+ public:
+  UnicodeString line;
+
+  UnicodeString* getLine(size_t lno) override
+  {
+    return lno == 0 ? &line : nullptr;
+  }
+};
+}  // namespace
+
+TEST_CASE("Schemes are compiled on the first entry")
+{
+  auto hrc_path = fs::current_path() / "data/type_shared.hrc";
+  XmlInputSource hrc_source(UnicodeString(hrc_path.c_str()), nullptr);
+  HrcLibrary lib;
+  lib.loadSource(&hrc_source);
+  auto* type = lib.getFileType(UnicodeString("shared"));
+  REQUIRE(type != nullptr);
+  REQUIRE(lib.getRegExpStats().requested == 0);
+
+  OneLineSource source;
+  LineRegionsSupport regions;
+  regions.resize(1);
+  TextParser parser;
+  parser.setFileType(type);
+  parser.setLineSource(&source);
+  parser.setRegionHandler(&regions);
+
+  // only base scheme is compiled, block with "string" scheme is not entered
+  source.line = "1 2";
+  parser.parse(0, 1, TextParser::TextParseMode::TPM_CACHE_OFF);
+  auto stats = lib.getRegExpStats();
+  REQUIRE(stats.requested == 6);
+  REQUIRE(stats.compiled == 6);
+  REQUIRE(regions.getLineRegions(0)->next != nullptr);
+
+  source.line = "1 \"2\"";
+  parser.parse(0, 1, TextParser::TextParseMode::TPM_CACHE_OFF);
+  stats = lib.getRegExpStats();
+  REQUIRE(stats.requested == 9);
+  REQUIRE(stats.compiled == 6);
+}
+
+TEST_CASE("Parallel load of all types is the same as sequential load")
+{
+  std::vector<std::unique_ptr<XmlInputSource>> sources;
+  HrcLibrary parallel;
+  HrcLibrary sequential;
+  for (const char* name : {"data/type_blocks.hrc", "data/type_shared.hrc", "data/type_cue.hrc"}) {
+    auto hrc_path = fs::current_path() / name;
+    sources.push_back(std::make_unique<XmlInputSource>(UnicodeString(hrc_path.c_str()), nullptr));
+    parallel.loadProtoTypes(sources.back().get());
+    sequential.loadProtoTypes(sources.back().get());
+  }
+  REQUIRE(parallel.getRegionCount() == sequential.getRegionCount());
+
+  parallel.loadAllFileTypes(3);
+  for (unsigned int i = 0; auto* type = sequential.enumerateFileTypes(i); i++) {
+    sequential.loadFileType(type);
+  }
+
+  // regions are added, when types are loaded
+  REQUIRE(parallel.getRegionCount() > 0);
+  REQUIRE(parallel.getRegionCount() == sequential.getRegionCount());
+  for (unsigned int id = 0; id < parallel.getRegionCount(); id++) {
+    REQUIRE(parallel.getRegion(id)->getName() == sequential.getRegion(id)->getName());
+  }
+  REQUIRE(parallel.getFileTypesCount() == sequential.getFileTypesCount());
+  for (unsigned int i = 0; i < parallel.getFileTypesCount(); i++) {
+    auto* type = parallel.enumerateFileTypes(i);
+    auto* expected = sequential.enumerateFileTypes(i);
+    REQUIRE(type->getName() == expected->getName());
+    auto* scheme = type->getBaseScheme();
+    auto* expected_scheme = expected->getBaseScheme();
+    REQUIRE((scheme == nullptr) == (expected_scheme == nullptr));
+    if (scheme != nullptr) {
+      REQUIRE(*scheme->getName() == *expected_scheme->getName());
+    }
+  }
+}
+
+TEST_CASE("Region has all regions of parent chain as parents")
+{
+  auto hrc_path = fs::current_path() / "data/type_pairs.hrc";
+  XmlInputSource hrc_source(UnicodeString(hrc_path.c_str()), nullptr);
+  HrcLibrary lib;
+  lib.loadSource(&hrc_source);
+  UnicodeString start_name("pairs:PairStart");
+  UnicodeString def_start_name("def:PairStart");
+  UnicodeString def_end_name("def:PairEnd");
+  const Region* start = lib.getRegion(&start_name);
+  const Region* def_start = lib.getRegion(&def_start_name);
+  const Region* def_end = lib.getRegion(&def_end_name);
+  REQUIRE(start != nullptr);
+  REQUIRE(def_start != nullptr);
+  REQUIRE(def_end != nullptr);
+
+  for (unsigned int id = 0; id < lib.getRegionCount(); id++) {
+    const Region* region = lib.getRegion(id);
+    for (unsigned int parent_id = 0; parent_id < lib.getRegionCount(); parent_id++) {
+      const Region* parent = lib.getRegion(parent_id);
+      bool expected = false;
+      for (auto* elem = region; elem != nullptr; elem = elem->getParent()) {
+        expected = expected || elem == parent;
+      }
+      REQUIRE(region->hasParent(parent) == expected);
+    }
+    REQUIRE_FALSE(region->hasParent(nullptr));
+  }
+  REQUIRE(start->hasParent(def_start));
+  REQUIRE(start->hasParent(start));
+  REQUIRE_FALSE(start->hasParent(def_end));
+  REQUIRE_FALSE(def_start->hasParent(start));
+}
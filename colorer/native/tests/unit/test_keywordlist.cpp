@@ -0,0 +1,56 @@
+#include <catch2/catch.hpp>
+#include "colorer/parsers/KeywordList.h"
+
+static void addKeyword(KeywordList& list, const char* keyword)
+{
+  list.kwList[list.count].keyword = std::make_unique<UnicodeString>(keyword);
+  list.count++;
+}
+
+TEST_CASE("KeywordList trie finds the longest keyword")
+{
+  KeywordList list(4);
+  list.matchCase = true;
+  addKeyword(list, "get");
+  addKeyword(list, "getParam");
+  addKeyword(list, "getParameterName");
+  addKeyword(list, "set");
+  list.buildTrie();
+
+  UnicodeString text("x getParameter");
+  int node = list.walk(text, 2, text.length());
+  REQUIRE(list.trie[node].keyword == -1);
+  REQUIRE(list.trie[node].depth == 12);
+  while (list.trie[node].keyword == -1) {
+    node = list.trie[node].parent;
+  }
+  REQUIRE(list.trie[node].keyword == 1);
+  node = list.trie[node].parent;
+  while (list.trie[node].keyword == -1) {
+    node = list.trie[node].parent;
+  }
+  REQUIRE(list.trie[node].keyword == 0);
+
+  // end of text limits the walk
+  node = list.walk(text, 2, 8);
+  REQUIRE(list.trie[node].depth == 6);
+  REQUIRE(list.walk(text, 0, text.length()) == 0);
+  REQUIRE(list.trie[list.walk(UnicodeString("GET"), 0, 3)].depth == 0);
+}
+
+TEST_CASE("KeywordList trie of case insensitive list")
+{
+  KeywordList list(3);
+  list.matchCase = false;
+  addKeyword(list, "Select");
+  addKeyword(list, "FROM");
+  addKeyword(list, "from");
+  list.buildTrie();
+
+  UnicodeString text("SELECT * From");
+  int node = list.walk(text, 0, text.length());
+  REQUIRE(list.trie[node].keyword == 0);
+  node = list.walk(text, 9, text.length());
+  // duplicated keyword, the last is used
+  REQUIRE(list.trie[node].keyword == 2);
+}
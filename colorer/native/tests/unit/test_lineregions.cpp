@@ -0,0 +1,143 @@
+#include <catch2/catch.hpp>
+#include "colorer/TextParser.h"
+#include "colorer/handlers/LineRegionsCompactSupport.h"
+#include "colorer/handlers/LineRegionsFlatSupport.h"
+#include "colorer/handlers/StyledHRDMapper.h"
+#include "test_common.h"
+
+TEST_CASE("Flat line regions are the same as linked line regions")
+{
+  HrcTestFactory hrc("type_blocks.hrc");
+  auto* type = hrc.getFileType("blocks");
+  UnicodeString pair_start("blocks:PairStart");
+  const Region* special = hrc.getLibrary().getRegion(&pair_start);
+  REQUIRE(special != nullptr);
+
+  LinesSource source;
+  source.lines = {"while (1) { x = 1; /* TODO", "  FIXME */ if 42; cat <<EOF",
+                  "$HOME \"not string", "EOF", "s = \"a\\\"b\"; } // if else {",
+                  "{ { return 7; } }", "", "  /* a */ /* b */ \"c\" 1 + 2;"};
+  auto lines = source.lines.size();
+
+  for (bool compact : {false, true}) {
+    std::unique_ptr<LineRegionsSupport> linked(compact ? new LineRegionsCompactSupport() : new LineRegionsSupport());
+    LineRegionsFlatSupport flat(compact);
+    linked->resize(lines);
+    linked->setSpecialRegion(special);
+    flat.resize(lines);
+    flat.setSpecialRegion(special);
+
+    TextParser linked_parser;
+    linked_parser.setFileType(type);
+    linked_parser.setLineSource(&source);
+    linked_parser.setRegionHandler(linked.get());
+    linked_parser.parse(0, static_cast<int>(lines), TextParser::TextParseMode::TPM_CACHE_UPDATE);
+
+    TextParser flat_parser;
+    flat_parser.setFileType(type);
+    flat_parser.setLineSource(&source);
+    flat_parser.setRegionHandler(&flat);
+    flat_parser.parse(0, static_cast<int>(lines), TextParser::TextParseMode::TPM_CACHE_UPDATE);
+
+    // repeated parse of the part of text replaces regions of these lines
+    for (size_t from = 0; from + 2 <= lines; from += 3) {
+      linked_parser.parse(static_cast<int>(from), 2, TextParser::TextParseMode::TPM_CACHE_READ);
+      flat_parser.parse(static_cast<int>(from), 2, TextParser::TextParseMode::TPM_CACHE_READ);
+    }
+
+    for (size_t i = 0; i < lines; i++) {
+      REQUIRE(dumpRegions(linked->getLineRegions(i)) == dumpRegions(flat.getLineRegions(i)));
+    }
+    REQUIRE(flat.getLineRegions(lines).empty());
+
+    if (compact) {
+      auto regions = flat.getLineRegions(5);
+      REQUIRE(regions.size() > 1);
+      for (size_t i = 1; i < regions.size(); i++) {
+        if (!regions[i].special()) {
+          REQUIRE(regions[i - 1].end() <= regions[i].start());
+        }
+      }
+    }
+  }
+}
+
+namespace {
+
+const LineRegion* findRegion(const LineRegion* lr, const char* name)
+{
+  for (; lr; lr = lr->next) {
+    if (lr->region && UStr::to_stdstr(&lr->region->getName()) == name) {
+      return lr;
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace
+
+TEST_CASE("Regions of parsed line are taken from the pool")
+{
+  HrcTestFactory hrc("type_blocks.hrc");
+  auto* type = hrc.getFileType("blocks");
+  UnicodeString pair_start("blocks:PairStart");
+  const Region* special = hrc.getLibrary().getRegion(&pair_start);
+
+  StyledHRDMapper mapper;
+  StyledRegion comment(true, false, 0x808080, 0, 0);
+  StyledRegion keyword(true, false, 0xFF0000, 0, StyledRegion::RD_BOLD);
+  StyledRegion number(true, false, 0x00FF00, 0, 0);
+  mapper.setRegionDefine(UnicodeString("blocks:Comment"), &comment);
+  mapper.setRegionDefine(UnicodeString("blocks:Keyword"), &keyword);
+  mapper.setRegionDefine(UnicodeString("blocks:Number"), &number);
+
+  LinesSource source;
+  source.lines = {"while (1) {", "  x = 1; /* a TODO b */ 2;", "  { if 42; }", "  /* FIXME", "  */ return 7;", "}"};
+  auto lines = source.lines.size();
+
+  for (bool compact : {false, true}) {
+    std::unique_ptr<LineRegionsSupport> regions(compact ? new LineRegionsCompactSupport() : new LineRegionsSupport());
+    regions->resize(lines);
+    regions->setRegionMapper(&mapper);
+    regions->setSpecialRegion(special);
+    TextParser parser;
+    parser.setFileType(type);
+    parser.setLineSource(&source);
+    parser.setRegionHandler(regions.get());
+    parser.parse(0, static_cast<int>(lines), TextParser::TextParseMode::TPM_CACHE_UPDATE);
+
+    // parse of single line from the cache starts with empty background region
+    std::vector<std::string> parsed;
+    for (size_t i = 0; i < lines; i++) {
+      parser.parse(static_cast<int>(i), 1, TextParser::TextParseMode::TPM_CACHE_READ);
+      parsed.push_back(dumpRegions(regions->getLineRegions(i)));
+    }
+    if (compact) {
+      // keyword splits the comment into two regions
+      REQUIRE(parsed[1].find("9-14 blocks:Comment;14-18 blocks:Keyword;18-23 blocks:Comment;") != std::string::npos);
+    }
+
+    // regions of the same define and parent share the resolved define
+    const auto* todo = findRegion(regions->getLineRegions(1), "blocks:Keyword");
+    const auto* fixme = findRegion(regions->getLineRegions(3), "blocks:Keyword");
+    REQUIRE(todo != nullptr);
+    REQUIRE(fixme != nullptr);
+    REQUIRE(todo->styled() != nullptr);
+    REQUIRE(todo->styled()->fore == 0xFF0000);
+    REQUIRE(todo->rdef == fixme->rdef);
+    const RegionDefine* keyword_define = todo->rdef;
+
+    // cleared line returns its regions, the next parse takes them again,
+    // regions of other lines are not changed by the reuse
+    size_t pool_size = regions->getPoolSize();
+    REQUIRE(pool_size > 0);
+    for (int i = 0; i < 1000; i++) {
+      parser.parse(i % static_cast<int>(lines), 1, TextParser::TextParseMode::TPM_CACHE_READ);
+      for (size_t lno = 0; lno < lines; lno++) {
+        REQUIRE(dumpRegions(regions->getLineRegions(lno)) == parsed[lno]);
+      }
+    }
+    REQUIRE(regions->getPoolSize() == pool_size);
+    REQUIRE(findRegion(regions->getLineRegions(1), "blocks:Keyword")->rdef == keyword_define);
+  }
+}
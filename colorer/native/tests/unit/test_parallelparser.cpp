@@ -0,0 +1,163 @@
+#include <catch2/catch.hpp>
+#include <algorithm>
+#include <sstream>
+#include <thread>
+#include "colorer/ParallelTextParser.h"
+#include "colorer/TextParser.h"
+#include "test_common.h"
+
+class EventsWriter : public RegionHandler
+{
+ public:
+  std::stringstream out;
+
+  void startParsing(size_t lno) override
+  {
+    out << "start " << lno << "\n";
+  }
+  void endParsing(size_t lno) override
+  {
+    out << "end " << lno << "\n";
+  }
+  void clearLine(size_t lno, UnicodeString* /*line*/) override
+  {
+    out << "line " << lno << "\n";
+  }
+  void addRegion(size_t lno, UnicodeString* /*line*/, int sx, int ex, const Region* region) override
+  {
+    out << "region " << lno << " " << sx << " " << ex << " " << UStr::to_stdstr(&region->getName()) << "\n";
+  }
+  void enterScheme(size_t lno, UnicodeString* /*line*/, int sx, int ex, const Region* /*region*/,
+                   const Scheme* scheme) override
+  {
+    out << "enter " << lno << " " << sx << " " << ex << " " << UStr::to_stdstr(scheme->getName()) << "\n";
+  }
+  void leaveScheme(size_t lno, UnicodeString* /*line*/, int sx, int ex, const Region* /*region*/,
+                   const Scheme* scheme) override
+  {
+    out << "leave " << lno << " " << sx << " " << ex << " " << UStr::to_stdstr(scheme->getName()) << "\n";
+  }
+};
+
+/** Source of lines, which remembers lines read by the thread of the parse call. */
+class CallerLinesSource : public LinesSource
+{
+ public:
+  std::thread::id caller = std::this_thread::get_id();
+  std::vector<size_t> callerLines;
+
+  UnicodeString* getLine(size_t lno) override
+  {
+    if (std::this_thread::get_id() == caller) {
+      callerLines.push_back(lno);
+    }
+    return LinesSource::getLine(lno);
+  }
+};
+
+static void generateText(LinesSource& source, int count)
+{
+  unsigned int seed = 12345;
+  auto next = [&seed]() {
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) % 100;
+  };
+  int depth = 0;
+  while (static_cast<int>(source.lines.size()) < count) {
+    auto r = next();
+    if (r < 10) {
+      source.lines.emplace_back("/* comment TODO");
+      for (unsigned int i = next() % 30; i > 0; i--) source.lines.emplace_back(" * FIXME text 123 if");
+      source.lines.emplace_back(" */ x = 1;");
+    }
+    else if (r < 15) {
+      source.lines.emplace_back("cat <<EOF");
+      for (unsigned int i = next() % 20; i > 0; i--) source.lines.emplace_back("  $HOME \"not string");
+      source.lines.emplace_back("EOF");
+    }
+    else if (r < 30 && depth < 5) {
+      source.lines.emplace_back("while (1) {");
+      depth++;
+    }
+    else if (r < 45 && depth > 0) {
+      source.lines.emplace_back("} else {");
+    }
+    else if (r < 60 && depth > 0) {
+      source.lines.emplace_back("}");
+      depth--;
+    }
+    else if (r < 70) {
+      source.lines.emplace_back("s = \"text \\\" {\"; // if else");
+    }
+    else {
+      source.lines.emplace_back("  if x = 42 + y; return 7;");
+    }
+  }
+}
+
+TEST_CASE("Parallel parse gives the same events as sequential parse")
+{
+  HrcTestFactory hrc("type_blocks.hrc");
+  auto* type = hrc.getFileType("blocks");
+
+  LinesSource source;
+  generateText(source, 3000);
+  auto lines = static_cast<int>(source.lines.size());
+
+  EventsWriter sequential;
+  TextParser parser;
+  parser.setFileType(type);
+  parser.setLineSource(&source);
+  parser.setRegionHandler(&sequential);
+  int seq_end = parser.parse(0, lines, TextParser::TextParseMode::TPM_CACHE_UPDATE);
+  REQUIRE(sequential.out.str().find("leave") != std::string::npos);
+
+  for (int chunk_size : {1, 7, 64, 500}) {
+    EventsWriter parallel;
+    ParallelTextParser pparser(4);
+    pparser.setFileType(type);
+    pparser.setLineSource(&source);
+    pparser.setRegionHandler(&parallel);
+    pparser.setChunkSize(chunk_size);
+    int par_end = pparser.parse(0, lines);
+
+    REQUIRE(seq_end == par_end);
+    REQUIRE(sequential.out.str() == parallel.out.str());
+  }
+}
+
+TEST_CASE("Text inside of one root block is parsed sequentially once")
+{
+  HrcTestFactory hrc("type_blocks.hrc");
+  auto* type = hrc.getFileType("blocks");
+
+  CallerLinesSource source;
+  source.lines.emplace_back("while (1) {");
+  generateText(source, 3000);
+  source.lines.emplace_back("}");
+  auto lines = static_cast<int>(source.lines.size());
+
+  EventsWriter sequential;
+  TextParser parser;
+  parser.setFileType(type);
+  parser.setLineSource(&source);
+  parser.setRegionHandler(&sequential);
+  parser.parse(0, lines, TextParser::TextParseMode::TPM_CACHE_UPDATE);
+  source.callerLines.clear();
+
+  EventsWriter parallel;
+  ParallelTextParser pparser(4);
+  pparser.setFileType(type);
+  pparser.setLineSource(&source);
+  pparser.setRegionHandler(&parallel);
+  pparser.setChunkSize(100);
+  pparser.parse(0, lines);
+  REQUIRE(sequential.out.str() == parallel.out.str());
+
+  // every chunk starts inside of the block, the first one ends there too, so the text is parsed
+  // on the calling thread from the first line to the end, without a restart at the next chunks
+  REQUIRE(!source.callerLines.empty());
+  REQUIRE(source.callerLines.front() == 0);
+  REQUIRE(source.callerLines.back() == static_cast<size_t>(lines - 1));
+  REQUIRE(std::is_sorted(source.callerLines.begin(), source.callerLines.end()));
+}
@@ -0,0 +1,30 @@
+#include <catch2/catch.hpp>
+#include "colorer/viewer/TextLinesStore.h"
+#include "test_common.h"
+
+TEST_CASE("Text lines store reads lines of file")
+{
+  auto file_path = fs::temp_directory_path() / "colorer_textlines_test.txt";
+  UnicodeString file_name(file_path.c_str());
+  writeFile(file_path, "first\r\nsec\tond\rthird\n\nlast");
+
+  TextLinesStore store;
+  store.loadFile(&file_name, false);
+  REQUIRE(store.getLineCount() == 5);
+  REQUIRE(*store.getLine(0) == UnicodeString("first"));
+  REQUIRE(*store.getLine(1) == UnicodeString("sec\tond"));
+  REQUIRE(*store.getLine(2) == UnicodeString("third"));
+  REQUIRE(store.getLine(3)->isEmpty());
+  REQUIRE(*store.getLine(4) == UnicodeString("last"));
+  REQUIRE(store.getLine(5) == nullptr);
+  REQUIRE(*store.getFileName() == file_name);
+
+  // lines of previous file are dropped
+  writeFile(file_path, "a\tb\nc");
+  store.loadFile(&file_name, true);
+  REQUIRE(store.getLineCount() == 2);
+  REQUIRE(*store.getLine(0) == UnicodeString("a    b"));
+  REQUIRE(*store.getLine(1) == UnicodeString("c"));
+
+  fs::remove(file_path);
+}
@@ -0,0 +1,130 @@
+#include <catch2/catch.hpp>
+#include <sstream>
+#include "colorer/TextParser.h"
+#include "colorer/handlers/LineRegionsSupport.h"
+#include "test_common.h"
+
+namespace {
+
+// parse from the cached line starts with empty background region before the regions of open schemes
+std::string dumpNonEmptyRegions(const LineRegion* lr)
+{
+  std::stringstream out;
+  for (; lr; lr = lr->next) {
+    if (lr->start != lr->end) {
+      out << lr->start << "-" << lr->end << " " << (lr->region ? UStr::to_stdstr(&lr->region->getName()) : "") << ";";
+    }
+  }
+  return out.str();
+}
+
+// regions of each line, parsed with cache of the parser, are the same as regions of full parse
+void checkCachedParse(TextParser& parser, LinesSource& source, FileType* type)
+{
+  auto lines = source.lines.size();
+  LineRegionsSupport expected;
+  expected.resize(lines);
+  TextParser full_parser;
+  full_parser.setFileType(type);
+  full_parser.setLineSource(&source);
+  full_parser.setRegionHandler(&expected);
+  full_parser.parse(0, static_cast<int>(lines), TextParser::TextParseMode::TPM_CACHE_OFF);
+
+  LineRegionsSupport regions;
+  regions.resize(lines);
+  parser.setRegionHandler(&regions);
+  for (size_t i = 0; i < lines; i++) {
+    parser.parse(static_cast<int>(i), 1, TextParser::TextParseMode::TPM_CACHE_READ);
+    REQUIRE(dumpNonEmptyRegions(regions.getLineRegions(i)) == dumpNonEmptyRegions(expected.getLineRegions(i)));
+  }
+}
+
+}  // namespace
+
+TEST_CASE("Changed line is parsed alone, if blocks at its end are not changed")
+{
+  HrcTestFactory hrc("type_blocks.hrc");
+  auto* type = hrc.getFileType("blocks");
+
+  LinesSource source;
+  source.lines = {"while (1) {", "  x = 1; /* TODO", "  FIXME */ if 42;", "  cat <<EOF", "$HOME text",
+                  "EOF",         "  { return 7;",    "  }",                 "}",           "s = 2;"};
+  auto lines = static_cast<int>(source.lines.size());
+  LineRegionsSupport regions;
+  regions.resize(source.lines.size());
+  TextParser parser;
+  parser.setFileType(type);
+  parser.setLineSource(&source);
+  parser.setRegionHandler(&regions);
+  parser.parse(0, lines, TextParser::TextParseMode::TPM_CACHE_UPDATE);
+
+  auto change = [&](int lno, const char* text) {
+    source.lines[lno] = text;
+    parser.setRegionHandler(&regions);
+    return parser.tryParseLine(lno);
+  };
+
+  // text inside of blocks
+  REQUIRE(change(6, "  { return 8 + 1;"));
+  REQUIRE(dumpRegions(regions.getLineRegions(6)).find("8") == std::string::npos);
+  checkCachedParse(parser, source, type);
+  REQUIRE(change(2, "  FIXME */ if 43;"));
+  checkCachedParse(parser, source, type);
+  // start of block is moved, text of its match is the same
+  REQUIRE(change(3, "    cat <<EOF"));
+  checkCachedParse(parser, source, type);
+
+  // end of heredoc refers to the changed text of start
+  REQUIRE_FALSE(change(3, "  cat <<END"));
+  parser.parse(3, lines - 3, TextParser::TextParseMode::TPM_CACHE_UPDATE);
+  checkCachedParse(parser, source, type);
+  REQUIRE_FALSE(change(5, "END"));
+  parser.parse(5, lines - 5, TextParser::TextParseMode::TPM_CACHE_UPDATE);
+  checkCachedParse(parser, source, type);
+  // comment is not continued to the next line
+  REQUIRE_FALSE(change(1, "  x = 1; // TODO"));
+  parser.parse(1, lines - 1, TextParser::TextParseMode::TPM_CACHE_UPDATE);
+  checkCachedParse(parser, source, type);
+  // new block is opened
+  REQUIRE_FALSE(change(7, "  } {"));
+  parser.parse(7, lines - 7, TextParser::TextParseMode::TPM_CACHE_UPDATE);
+  checkCachedParse(parser, source, type);
+  // block is closed earlier
+  REQUIRE_FALSE(change(6, "  { return 8 + 1; }"));
+}
+
+TEST_CASE("Parse from cached line after partial update of cache")
+{
+  HrcTestFactory hrc("type_blocks.hrc");
+  auto* type = hrc.getFileType("blocks");
+
+  LinesSource source;
+  for (int i = 0; i < 50; i++) {
+    source.lines.emplace_back("while (1) {");
+    source.lines.emplace_back("  /* a");
+    source.lines.emplace_back("  b */ {");
+    source.lines.emplace_back("    return 1;");
+    source.lines.emplace_back("  } }");
+  }
+  auto lines = static_cast<int>(source.lines.size());
+  LineRegionsSupport regions;
+  regions.resize(source.lines.size());
+  TextParser parser;
+  parser.setFileType(type);
+  parser.setLineSource(&source);
+  parser.setRegionHandler(&regions);
+  parser.parse(0, lines, TextParser::TextParseMode::TPM_CACHE_UPDATE);
+  checkCachedParse(parser, source, type);
+
+  // cache is truncated from the changed line and is filled again by the next parse
+  source.lines[122] = "  b {";
+  parser.setRegionHandler(&regions);
+  parser.parse(122, 10, TextParser::TextParseMode::TPM_CACHE_UPDATE);
+  parser.parse(132, lines - 132, TextParser::TextParseMode::TPM_CACHE_UPDATE);
+  checkCachedParse(parser, source, type);
+
+  source.lines[122] = "  b */ {";
+  parser.setRegionHandler(&regions);
+  parser.parse(120, lines - 120, TextParser::TextParseMode::TPM_CACHE_UPDATE);
+  checkCachedParse(parser, source, type);
+}
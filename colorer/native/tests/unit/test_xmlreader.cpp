@@ -1,4 +1,7 @@
 #include <catch2/catch.hpp>
+#include <chrono>
+#include <map>
+#include "colorer/common/Features.h"
 #include "colorer/utils/Environment.h"
 #include "colorer/xml/XmlReader.h"
 #include "test_common.h"
@@ -73,4 +76,154 @@ TEST_CASE("Test read jar entity with env")
   REQUIRE(logger->message_print() == false);
 }
 
+TEST_CASE("Test read several entries of one jar")
+{
+  logger->clean_messages();
+
+  auto jar_path = fs::current_path() / "data" / "entries.zip";
+  UnicodeString jar = u"jar:" + UnicodeString(jar_path.c_str());
+  // sources of entries share the source of jar
+  XmlInputSource first(jar + u"!first.ent");
+  XmlInputSource second(jar + u"!second.ent");
+  XmlInputSource doc(jar + u"!doc.xml");
+
+  // entities are loaded from the same jar as the document
+  XmlReader reader(doc);
+  REQUIRE(reader.parse());
+  std::list<XMLNode> nodes;
+  reader.getNodes(nodes);
+  REQUIRE(nodes.size() == 1);
+  REQUIRE(nodes.front().children.size() == 2);
+  REQUIRE(nodes.front().children.front().attributes.at(u"name") == u"first");
+  REQUIRE(nodes.front().children.back().attributes.at(u"name") == u"second");
+
+  REQUIRE(logger->message_print() == false);
+}
+
 #endif
+
+namespace {
+
+// chars out of ASCII are written as character references, so dump does not depend on the string library
+std::string dumpString(const UnicodeString& str)
+{
+  std::string result;
+  for (int32_t i = 0; i < str.length(); i++) {
+    auto c = static_cast<unsigned int>(str[i]);
+    result += c < 0x80 ? std::string(1, static_cast<char>(c)) : "&#" + std::to_string(c) + ";";
+  }
+  return result;
+}
+
+std::string dumpNodes(const std::list<XMLNode>& nodes)
+{
+  std::string result;
+  for (const auto& node : nodes) {
+    result += "<" + dumpString(node.name);
+    std::map<std::string, std::string> attributes;
+    for (const auto& [name, value] : node.attributes) {
+      attributes[dumpString(name)] = dumpString(value);
+    }
+    for (const auto& [name, value] : attributes) {
+      result += " " + name + "='" + value + "'";
+    }
+    result += ">" + dumpString(node.text) + dumpNodes(node.children) + "</>";
+  }
+  return result;
+}
+
+std::string readNodes(const fs::path& path, const XmlCache* cache)
+{
+  XmlInputSource is(UnicodeString(path.c_str()));
+  XmlReader reader(is, cache);
+  REQUIRE(reader.parse());
+  std::list<XMLNode> nodes;
+  reader.getNodes(nodes);
+  return dumpNodes(nodes);
+}
+
+}  // namespace
+
+TEST_CASE("Test read xml from cache")
+{
+  logger->clean_messages();
+
+  auto work_dir = fs::temp_directory_path() / "colorer_xmlcache_test";
+  fs::remove_all(work_dir);
+  fs::create_directories(work_dir);
+  auto xml_path = work_dir / "doc.xml";
+  auto entity_path = work_dir / "part.ent";
+  writeFile(xml_path,
+            "<?xml version='1.0'?>\n<!DOCTYPE doc [<!ENTITY part SYSTEM 'part.ent'>]>\n"
+            "<doc a='1'><item name='x'>text</item>&part;</doc>");
+  writeFile(entity_path, "<item name='y'/>");
+
+  XmlCache cache(UnicodeString((work_dir / "cache").c_str()));
+  auto parsed = readNodes(xml_path, nullptr);
+  REQUIRE(readNodes(xml_path, &cache) == parsed);
+  REQUIRE(std::distance(fs::directory_iterator(work_dir / "cache"), fs::directory_iterator()) == 1);
+
+  std::list<XMLNode> nodes;
+  REQUIRE(cache.load(UnicodeString(xml_path.c_str()), nodes));
+  REQUIRE(dumpNodes(nodes) == parsed);
+  REQUIRE(readNodes(xml_path, &cache) == parsed);
+
+  // touched file with the same content keeps the cache valid
+  auto entity_time = fs::last_write_time(entity_path);
+  fs::last_write_time(entity_path, entity_time + std::chrono::seconds(1));
+  nodes.clear();
+  REQUIRE(cache.load(UnicodeString(xml_path.c_str()), nodes));
+  REQUIRE(dumpNodes(nodes) == parsed);
+
+  // change of external entity invalidates the cache, size is the same
+  writeFile(entity_path, "<item name='z'/>");
+  fs::last_write_time(entity_path, entity_time + std::chrono::seconds(2));
+  nodes.clear();
+  REQUIRE_FALSE(cache.load(UnicodeString(xml_path.c_str()), nodes));
+  auto changed = readNodes(xml_path, &cache);
+  REQUIRE(changed != parsed);
+  REQUIRE(changed == readNodes(xml_path, nullptr));
+  REQUIRE(cache.load(UnicodeString(xml_path.c_str()), nodes));
+
+  // cache file of other document with the same name is not used
+  auto other_path = work_dir / "other.xml";
+  writeFile(other_path, "<other/>");
+  XmlCache other_cache(UnicodeString((work_dir / "other_cache").c_str()));
+  REQUIRE(readNodes(other_path, &other_cache) == "<other></>");
+  auto other_file = fs::directory_iterator(work_dir / "other_cache")->path();
+  fs::copy_file(fs::directory_iterator(work_dir / "cache")->path(), other_file,
+                fs::copy_options::overwrite_existing);
+  nodes.clear();
+  REQUIRE_FALSE(other_cache.load(UnicodeString(other_path.c_str()), nodes));
+  REQUIRE(readNodes(other_path, &other_cache) == "<other></>");
+
+  fs::remove_all(work_dir);
+  REQUIRE(logger->message_print() == false);
+}
+
+TEST_CASE("Test read nodes of xml")
+{
+  logger->clean_messages();
+
+  auto work_dir = fs::temp_directory_path() / "colorer_xmlnodes_test";
+  fs::remove_all(work_dir);
+  fs::create_directories(work_dir);
+  auto xml_path = work_dir / "doc.xml";
+  writeFile(work_dir / "part.ent", "<item name='&amp;y'>  entity  </item>");
+  writeFile(xml_path,
+            "<?xml version='1.0'?>\n<!DOCTYPE doc [<!ENTITY part SYSTEM 'part.ent'><!ENTITY name 'n&#233;'>]>\n"
+            "<doc xmlns='urn:doc' xmlns:x='urn:x' x:a='1'>\n"
+            "  <!-- comment -->\n"
+            "  <item name='&name;'>\n    text \n  <empty/> tail</item>\n"
+            "  <item><![CDATA[ <cdata> ]]>text</item>\n"
+            "  <item>  <![CDATA[]]>text</item>\n"
+            "  &part;\n"
+            "</doc>");
+
+  REQUIRE(readNodes(xml_path, nullptr) ==
+          "<doc a='1'><item name='n&#233;'>text<empty></></><item> <cdata> </><item></>"
+          "<item name='&y'>entity</></>");
+
+  fs::remove_all(work_dir);
+  REQUIRE(logger->message_print() == false);
+}
@@ -314,7 +314,7 @@ void ConsoleTools::profile(int loopCount) const
 
   clock_t msecs = clock();
   while (loopCount--) {
-    baseEditor.modifyLineEvent(0);
+    baseEditor.modifyEvent(0);
     baseEditor.lineCountEvent((int) textLinesStore.getLineCount());
     baseEditor.validate(-1, false);
   }